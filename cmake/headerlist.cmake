@@ -8,4 +8,24 @@ set(headers ${headers}
 	include/Hooks.h
 	include/MCP.h
 	include/Serialization.h
+	include/ThreadPool.h
+	include/LibraryCache.h
+	include/LibraryScanner.h
+	include/ManagedManifest.h
+	include/LibraryWatcher.h
+	include/TagClassifier.h
+	include/Diagnostics.h
+	include/StringPool.h
+	include/AtomicFile.h
+	include/ConditionTemplate.h
+	include/ConfigRewriter.h
+	include/ConditionIR.h
+	include/StateKey.h
+	include/BinaryStream.h
+	include/StanceStore.h
+	include/ModNameIndex.h
+	include/LibraryId.h
+	include/Autosave.h
+	include/StanceJournal.h
+	include/ConditionEmitter.h
 )
@@ -7,4 +7,21 @@ set(sources ${sources}
 	src/Hooks.cpp
 	src/MCP.cpp
  	src/Serialization.cpp
+	src/ThreadPool.cpp
+	src/LibraryCache.cpp
+	src/LibraryScanner.cpp
+	src/ManagedManifest.cpp
+	src/LibraryWatcher.cpp
+	src/Diagnostics.cpp
+	src/StringPool.cpp
+	src/AtomicFile.cpp
+	src/ConditionTemplate.cpp
+	src/ConfigRewriter.cpp
+	src/ConditionIR.cpp
+	src/StateKey.cpp
+	src/StanceStore.cpp
+	src/ModNameIndex.cpp
+	src/Autosave.cpp
+	src/StanceJournal.cpp
+	src/ConditionEmitter.cpp
 )
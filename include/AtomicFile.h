@@ -0,0 +1,47 @@
+﻿#pragma once
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Escrita à prova de queda: o conteúdo vai para um temporário na mesma pasta e só depois substitui o
+// destino com um rename atômico. Quem lê o arquivo (o OAR, o próprio plugin) vê o conteúdo antigo ou o
+// novo inteiro, nunca um arquivo truncado.
+class AtomicFileBatch {
+public:
+    static constexpr std::string_view kTempSuffix = ".cmtmp";
+
+    AtomicFileBatch() = default;
+    ~AtomicFileBatch();  // Apaga temporários que não foram confirmados
+
+    AtomicFileBatch(const AtomicFileBatch&) = delete;
+    AtomicFileBatch& operator=(const AtomicFileBatch&) = delete;
+
+    // Grava `content` no temporário de `target`. Pode ser chamado de várias threads ao mesmo tempo.
+    bool Stage(const std::filesystem::path& target, std::string_view content, std::string& error);
+
+    // Leva os temporários ao disco e troca cada destino pelo seu temporário. A durabilidade é resolvida
+    // uma vez para o lote no fim do salvamento, e não a cada arquivo escrito.
+    // Retorna os destinos que não foram trocados, com o motivo; esses mantêm o conteúdo antigo.
+    std::vector<std::pair<std::filesystem::path, std::string>> Commit();
+
+    std::size_t GetStagedCount() const;
+
+    // Lote de um arquivo só, para quem não escreve em lote.
+    static bool Write(const std::filesystem::path& target, std::string_view content, std::string& error);
+
+private:
+    // Nenhum handle fica aberto entre o Stage e o Commit: um lote com milhares de arquivos não pode segurar um
+    // handle por arquivo. O Commit reabre cada temporário só para o FlushFileBuffers.
+    struct StagedFile {
+        std::filesystem::path target;
+        std::filesystem::path temp;
+    };
+
+    static void Discard(StagedFile& file);
+
+    mutable std::mutex _mutex;
+    std::vector<StagedFile> _staged;
+};
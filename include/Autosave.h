@@ -0,0 +1,68 @@
+﻿#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+
+// Gravação em segundo plano do estado do usuário (stances, movesets de usuário, configurações).
+// A thread da UI só monta o conteúdo em memória e entrega aqui; quem toca o disco é a thread do Autosave,
+// depois de um período sem mudanças. Rajadas de edições viram uma única escrita por arquivo, sempre com
+// o conteúdo mais recente.
+class Autosave {
+public:
+    static constexpr auto kQuietPeriod = std::chrono::seconds(2);  // Silêncio necessário para gravar
+    static constexpr auto kMaxDelay = std::chrono::seconds(15);    // Limite para edições que não param
+    static constexpr auto kRetryDelay = std::chrono::seconds(30);  // Depois de uma falha de escrita
+
+    static Autosave& GetSingleton();
+
+    Autosave(const Autosave&) = delete;
+    Autosave& operator=(const Autosave&) = delete;
+
+    // Substitui o conteúdo pendente de `path`. Não bloqueia: a escrita acontece na thread do Autosave.
+    void Submit(std::filesystem::path path, std::string content);
+    // Acrescenta `bytes` ao fim de `path` (o diário de stances). Se há uma substituição pendente para o mesmo
+    // arquivo, os bytes entram nela.
+    void Append(const std::filesystem::path& path, std::string_view bytes);
+
+    // Grava agora, na thread de quem chama, tudo o que está pendente. Chamado ao salvar o jogo e ao abrir os
+    // menus pelos quais o jogo é encerrado (GlobalControl::MenuOpen).
+    void Flush();
+
+    bool HasPending() const;
+    // Um acréscimo a `path` falhou, talvez no meio de um registro. Acréscimos novos são descartados até o
+    // próximo Submit de `path`: o dono precisa regravar o arquivo inteiro.
+    bool AppendFailed(const std::filesystem::path& path) const;
+
+private:
+    Autosave() = default;
+    // Nada de escrita na saída do processo (loader lock, threads já encerradas): o que importa foi gravado
+    // antes, pelo Flush. O singleton nem chega a ser destruído.
+    ~Autosave() = default;
+
+    struct PendingFile {
+        std::string content;
+        bool append = false;  // false: substitui o arquivo inteiro
+    };
+
+    void Run();
+    void Touch(bool firstChange);  // Registra uma mudança e garante a thread. Chamado com _mutex travado.
+    // Tira o conteúdo pendente e grava: substituições num único lote atômico, depois os acréscimos.
+    // Substituições que falharam voltam para a fila; acréscimos, não (AppendFailed).
+    void WritePending();
+
+    mutable std::mutex _mutex;  // Protege a fila e os horários
+    std::mutex _writeMutex;     // Uma escrita por vez, para uma versão antiga nunca sobrescrever a nova
+    std::condition_variable _wake;
+    std::map<std::filesystem::path, PendingFile> _pending;
+    std::chrono::steady_clock::time_point _firstChange;
+    std::chrono::steady_clock::time_point _lastChange;
+    std::chrono::steady_clock::time_point _retryAt;
+    std::thread _thread;
+    std::set<std::filesystem::path> _failedAppends;  // Ver AppendFailed
+};
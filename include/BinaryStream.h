@@ -0,0 +1,76 @@
+﻿#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Codificação binária dos arquivos do plugin (índice da biblioteca, stances): valores triviais copiados como
+// estão e strings com o tamanho em 32 bits na frente.
+class BinaryWriter {
+public:
+    template <class T>
+    void Write(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const auto* bytes = reinterpret_cast<const char*>(&value);
+        _buffer.insert(_buffer.end(), bytes, bytes + sizeof(T));
+    }
+    template <class CharT>
+    void WriteString(const std::basic_string<CharT>& value) {
+        Write(static_cast<std::uint32_t>(value.size()));
+        const auto* bytes = reinterpret_cast<const char*>(value.data());
+        _buffer.insert(_buffer.end(), bytes, bytes + value.size() * sizeof(CharT));
+    }
+    const std::vector<char>& Data() const { return _buffer; }
+
+private:
+    std::vector<char> _buffer;
+};
+
+// Lê de um buffer em memória; qualquer leitura além do fim marca o leitor como inválido.
+class BinaryReader {
+public:
+    explicit BinaryReader(const std::vector<char>& buffer) : _buffer(buffer) {}
+
+    template <class T>
+    T Read() {
+        T value{};
+        if (!Ensure(sizeof(T))) return value;
+        std::memcpy(&value, _buffer.data() + _offset, sizeof(T));
+        _offset += sizeof(T);
+        return value;
+    }
+    template <class CharT>
+    std::basic_string<CharT> ReadString() {
+        const auto length = Read<std::uint32_t>();
+        if (!Ensure(static_cast<std::size_t>(length) * sizeof(CharT))) return {};
+        std::basic_string<CharT> value(length, CharT{});
+        std::memcpy(value.data(), _buffer.data() + _offset, length * sizeof(CharT));
+        _offset += length * sizeof(CharT);
+        return value;
+    }
+    // Lê a contagem de uma lista cujos elementos ocupam pelo menos `minElementSize` bytes. Uma contagem que
+    // não cabe no resto do buffer marca o leitor como inválido e devolve 0, antes de qualquer alocação.
+    std::uint32_t ReadCount(std::size_t minElementSize) {
+        const auto count = Read<std::uint32_t>();
+        if (!Ensure(static_cast<std::size_t>(count) * minElementSize)) return 0;
+        return count;
+    }
+    bool Ok() const { return _ok; }
+    bool AtEnd() const { return _offset == _buffer.size(); }
+    std::size_t Offset() const { return _offset; }
+    std::size_t Remaining() const { return _buffer.size() - _offset; }
+
+private:
+    bool Ensure(std::size_t size) {
+        if (!_ok || _buffer.size() - _offset < size) {
+            _ok = false;
+            return false;
+        }
+        return true;
+    }
+
+    const std::vector<char>& _buffer;
+    std::size_t _offset = 0;
+    bool _ok = true;
+};
@@ -0,0 +1,71 @@
+﻿#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "ConditionIR.h"
+#include "ConditionTemplate.h"
+#include "ConfigRewriter.h"
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+// Serialização do bloco OAR_CYCLE_MANAGER_CONDITIONS a partir da árvore do ConditionIR e as verificações sobre
+// o config.json gerado. Não depende do jogo: o plugin e os testes em tests/ usam exatamente este código.
+namespace ConditionEmitter {
+    using CompactWriter = rapidjson::Writer<rapidjson::StringBuffer>;
+
+    // Condições do OAR montadas em DOM. São os protótipos dos templates.
+    // `comparison` é aplicada como "value <comparação> variável", na ordem do OAR (Value A, Value B).
+    void AddCompareValuesCondition(rapidjson::Value& conditionsArray, const std::string& graphVarName, int value,
+                                   rapidjson::Document::AllocatorType& allocator, const char* comparison = "==");
+    void AddNegatedCompareValuesCondition(rapidjson::Value& conditionsArray, const std::string& graphVarName, int value,
+                                          rapidjson::Document::AllocatorType& allocator);
+    void AddRandomCondition(rapidjson::Value& conditionsArray, int value,
+                            rapidjson::Document::AllocatorType& allocator);
+
+    // Fragmentos fixos das condições geradas, serializados uma vez. Cada conjunto existe na versão compacta
+    // (usada no hash) e na indentada, que recebe o recuo do writer ao ser emitida.
+    struct Templates {
+        ConditionTemplate actorBase;
+        ConditionTemplate equippedRight;     // Lacuna: tipo da arma
+        ConditionTemplate equippedLeft;      // Lacuna: tipo da arma
+        ConditionTemplate cycleInstance;     // Lacuna: instância
+        ConditionTemplate playlistOrder;     // Lacuna: ordem na playlist
+        ConditionTemplate negatedDirection;  // Lacuna: direção usada por uma filha
+        ConditionTemplate random;            // Lacunas: mínimo e máximo
+        ConditionTemplate direction;         // Lacuna: direção
+        ConditionTemplate killSwitch;        // Lacuna: valor de CycleMovesetDisable
+        ConditionTemplate stateEquals;       // Lacuna: chave de estado
+        ConditionTemplate stateNotEquals;    // Lacuna: chave de estado
+        ConditionTemplate stateAtLeast;      // Lacuna: início da faixa
+        ConditionTemplate stateAtMost;       // Lacuna: fim da faixa
+    };
+    struct TemplateSet {
+        Templates compact;
+        Templates pretty;
+    };
+    Templates BuildTemplates(bool pretty);
+    const TemplateSet& GetTemplates();
+
+    // Serializa a árvore de condições como o bloco gerenciado. A forma compacta é a do hash; a indentada é a
+    // que vai para o config.json, na profundidade em que o writer estiver.
+    void WriteManagedBlock(CompactWriter& writer, const ConditionIR::Node& root, std::string& scratch);
+    void WriteManagedBlock(ConfigRewriter::OutputWriter& writer, const ConditionIR::Node& root, std::string& scratch);
+
+    // Hash canônico de tudo que o manager decide num config.json: o bloco gerenciado (serializado sem
+    // formatação), a prioridade e se as condições externas são preservadas.
+    std::uint64_t HashManagedOutput(std::uint64_t blockHash, int priority, bool preserveConditions);
+
+    // O arquivo já está na forma que a escrita produziria? Prioridade e bloco gerenciado iguais, e as
+    // demais condições são só o bloco "Old Conditions" (preservando) ou nenhuma (substituindo).
+    bool MatchesManagedOutput(const ConfigRewriter::ExistingConfig& existing, std::uint64_t outputHash,
+                              bool preserveConditions);
+
+    // Propriedades de toda saída gerada, relendo o conteúdo recém-produzido: JSON válido com a prioridade pedida,
+    // no máximo um bloco gerenciado, condições de terceiros embrulhadas em "Old Conditions" quando preservadas, e
+    // o próximo salvamento reconhecendo o arquivo como inalterado. Vazio se tudo confere. O plugin confere em
+    // builds de debug; os testes, sempre.
+    std::string CheckGeneratedOutput(std::string_view content, const ConfigRewriter::ExistingConfig& existing,
+                                     int priority, bool hasManagedBlock, std::uint64_t outputHash,
+                                     bool preserveConditions);
+}
@@ -0,0 +1,51 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct FileSaveConfig;
+
+// Representação intermediária do bloco OAR_CYCLE_MANAGER_CONDITIONS de um config.json.
+// A geração monta a árvore ingênua (um AND completo por configuração, como sempre foi escrito) e o
+// otimizador fatora os termos repetidos antes da serialização, para o OAR avaliar menos nós por ataque.
+namespace ConditionIR {
+    enum class Kind : std::uint8_t {
+        And,
+        Or,
+        // Folhas, cada uma com um template em ConditionTemplates
+        ActorBase,
+        EquippedRight,
+        EquippedLeft,
+        CycleInstance,
+        PlaylistOrder,
+        NegatedDirection,
+        Random,
+        Direction,
+        KillSwitch,
+        // Modo de chave única (StateKey.h): comparações com CycleMovesetState
+        StateEquals,
+        StateNotEquals,
+        StateAtLeast,
+        StateAtMost,
+    };
+
+    struct Node {
+        Kind kind = Kind::And;
+        double value = 0.0;          // Valor da folha (tipo da arma, instância, ordem, direção...)
+        std::vector<Node> children;  // Só em And/Or
+
+        bool IsGroup() const { return kind == Kind::And || kind == Kind::Or; }
+        bool operator==(const Node& other) const;
+    };
+
+    // Raiz (o OR com o comentário do manager). Sem filhos quando nenhuma configuração gera condições.
+    // `packedStateKey` troca instância, ordem e direção por comparações com a chave de estado única.
+    Node BuildTree(const std::vector<FileSaveConfig>& configs, bool packedStateKey = false);
+
+    // Fatora prefixos comuns (ator, tipo de arma, instância, ordem), junta conjuntos de direções e remove
+    // grupos redundantes. O resultado é logicamente equivalente à árvore de entrada.
+    Node Optimize(const Node& root);
+
+    // Nós que o OAR avalia no pior caso: grupos e folhas, incluindo a raiz.
+    std::size_t CountNodes(const Node& node);
+}
@@ -0,0 +1,51 @@
+﻿#pragma once
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+#include <vector>
+#include "rapidjson/document.h"
+
+// Fragmento de condição do OAR já serializado, com lacunas para os valores numéricos.
+// O texto é gerado uma vez pelo próprio rapidjson a partir de um protótipo; depois cada condição emitida é
+// só uma cópia dos pedaços fixos com os números escritos nas lacunas, sem montar nenhum Value.
+class ConditionTemplate {
+public:
+    // Valor que marca uma lacuna no protótipo. Não pode aparecer em nenhum outro lugar do fragmento.
+    static constexpr double kSlot = 987654321.0;
+
+    // Indentação do ponto onde o fragmento entra: contêineres abertos em volta dele e o recuo de cada nível.
+    struct Indent {
+        std::size_t nesting = 0;
+        char character = ' ';
+        unsigned count = 4;
+    };
+
+    ConditionTemplate() = default;
+
+    // `pretty` gera o fragmento com uma linha por membro; a indentação só é decidida ao renderizar.
+    static ConditionTemplate FromPrototype(const rapidjson::Value& prototype, bool pretty);
+
+    // Texto do fragmento com `values` nas lacunas, na ordem em que aparecem. Substitui o conteúdo de `out`.
+    // `indent` só se aplica a fragmentos indentados.
+    void Render(std::string& out, std::initializer_list<double> values, const Indent& indent = {}) const;
+
+    // Emite o fragmento como um valor do writer. Um writer que informa a própria profundidade
+    // (ConfigRewriter::OutputWriter) recebe o fragmento indentado exatamente onde ele está; os demais recebem o
+    // texto sem recuo extra. `scratch` é reaproveitado entre chamadas para não alocar a cada condição.
+    template <class Writer>
+    void Emit(Writer& writer, std::string& scratch, std::initializer_list<double> values = {}) const {
+        if constexpr (requires { writer.GetNesting(); }) {
+            Render(scratch, values, {writer.GetNesting(), writer.GetIndentChar(), writer.GetIndentCharCount()});
+        } else {
+            Render(scratch, values);
+        }
+        writer.RawValue(scratch.data(), scratch.size(), rapidjson::kObjectType);
+    }
+
+    std::size_t GetSlotCount() const { return _literals.empty() ? 0 : _literals.size() - 1; }
+
+private:
+    // Texto entre as lacunas. Nos fragmentos indentados, cada linha começa com um espaço por nível.
+    std::vector<std::string> _literals;
+    bool _pretty = false;
+};
@@ -0,0 +1,60 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "rapidjson/prettywriter.h"
+#include "rapidjson/stringbuffer.h"
+
+// Reescrita de um config.json do OAR em streaming (SAX), sem montar o documento na memória.
+// Todo o conteúdo de terceiros passa direto do leitor para o writer; só "priority" e o nosso bloco
+// OAR_CYCLE_MANAGER_CONDITIONS são trocados, e as condições de terceiros são embrulhadas no bloco
+// "Old Conditions" conforme passam. A memória usada não depende do tamanho da árvore de condições.
+namespace ConfigRewriter {
+    enum class ConditionKind : std::uint8_t { Foreign, OldConditions, Managed };
+
+    // Resultado da primeira passada: o que o arquivo atual tem, sem guardar o conteúdo.
+    struct ExistingConfig {
+        bool exists = false;
+        bool valid = false;  // JSON válido com objeto na raiz; senão o arquivo é recriado do zero
+        std::string error;   // Erro de parse, se houver
+        std::uint64_t bytesRead = 0;
+        std::optional<int> priority;            // "priority" da raiz, se for inteiro
+        bool hasConditions = false;             // "conditions" da raiz existe e é um array
+        std::vector<ConditionKind> conditions;  // Tipo de cada elemento de "conditions"
+        std::size_t managedBlocks = 0;
+        std::uint64_t managedBlockHash = 0;  // Fnv1a64 da forma compacta do primeiro bloco gerenciado
+    };
+
+    // PrettyWriter que informa em que ponto da saída está: quantos contêineres estão abertos e qual indentação
+    // usa. Os fragmentos pré-serializados (ConditionTemplate) se indentam a partir disso em qualquer profundidade.
+    class OutputWriter : public rapidjson::PrettyWriter<rapidjson::StringBuffer> {
+    public:
+        using PrettyWriter::PrettyWriter;
+
+        std::size_t GetNesting() const { return level_stack_.GetSize() / sizeof(Level); }
+        char GetIndentChar() const { return indentChar_; }
+        unsigned GetIndentCharCount() const { return indentCharCount_; }
+    };
+    // Escreve o bloco gerenciado no fim de "conditions". Vazio: o arquivo fica sem bloco.
+    using BlockWriter = std::function<void(OutputWriter&)>;
+
+    // Primeira passada: classifica as condições de topo e calcula o hash do bloco gerenciado atual.
+    ExistingConfig Scan(const std::filesystem::path& path);
+    // A mesma passada sobre um conteúdo já em memória (a saída recém-gerada, nas verificações de consistência).
+    ExistingConfig ScanContent(std::string_view content);
+
+    // Segunda passada: copia o arquivo para `out` com a nova prioridade e o novo bloco. Se `existing` não é
+    // válido, escreve um documento novo só com "priority" e "conditions", sem ler o arquivo.
+    bool Rewrite(const std::filesystem::path& path, const ExistingConfig& existing, int priority,
+                 bool preserveConditions, const BlockWriter& writeManagedBlock, rapidjson::StringBuffer& out,
+                 std::string& error);
+    // A mesma passada sobre um conteúdo em memória, que tem que ser o mesmo lido pelo ScanContent (testes).
+    bool RewriteContent(std::string_view content, const ExistingConfig& existing, int priority,
+                        bool preserveConditions, const BlockWriter& writeManagedBlock, rapidjson::StringBuffer& out,
+                        std::string& error);
+}
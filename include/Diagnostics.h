@@ -0,0 +1,84 @@
+﻿#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Medições das operações pesadas do plugin (escaneamento, manifesto, geração de condições, stances).
+// Cada fase guarda o resultado da última execução; a aba "Diagnóstico" do menu e o log mostram os números.
+namespace Diagnostics {
+    enum class Phase { LibraryScan, ManagedFiles, ConditionGeneration, StanceLoad, StanceSave, Count };
+    inline constexpr std::size_t kPhaseCount = static_cast<std::size_t>(Phase::Count);
+
+    const char* PhaseName(Phase phase);
+
+    struct PhaseReport {
+        std::uint64_t runs = 0;
+        double wallMs = 0.0;
+        std::uint64_t fsCalls = 0;  // Listagens, stats e aberturas de arquivo
+        std::uint64_t filesRead = 0;
+        std::uint64_t bytesRead = 0;
+        std::uint64_t filesWritten = 0;
+        std::uint64_t bytesWritten = 0;
+        std::int64_t workingSetDelta = 0;  // Memória residente ao fim menos no início
+        std::uint64_t peakWorkingSet = 0;  // Pico do processo inteiro ao fim da fase
+    };
+
+    // E/S feita pelo código que toca o disco. Soma na fase ativa da thread atual e nas fases que a envolvem; fora
+    // de qualquer fase, não conta. Fases concorrentes em threads diferentes não se misturam.
+    void CountFsCalls(std::uint64_t calls = 1);
+    void CountRead(std::uint64_t bytes, std::uint64_t files = 1);
+    void CountWrite(std::uint64_t bytes, std::uint64_t files = 1);
+
+    // Memória residente atual e pico do processo, em bytes (0 se a plataforma não informar).
+    std::uint64_t CurrentWorkingSet();
+    std::uint64_t PeakWorkingSet();
+
+    PhaseReport GetReport(Phase phase);
+    void LogReport();
+
+    // Mede a fase do construtor ao destrutor e a torna a fase ativa da thread. Fases podem ser aninhadas na mesma
+    // thread (cada uma registra o seu total) e precisam terminar na ordem inversa em que começaram.
+    class ScopedPhase {
+    public:
+        explicit ScopedPhase(Phase phase);
+        ~ScopedPhase();
+
+        ScopedPhase(const ScopedPhase&) = delete;
+        ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+    private:
+        friend void CountFsCalls(std::uint64_t calls);
+        friend void CountRead(std::uint64_t bytes, std::uint64_t files);
+        friend void CountWrite(std::uint64_t bytes, std::uint64_t files);
+
+        Phase _phase;
+        ScopedPhase* _parent;  // A fase ativa nesta thread antes desta
+        std::chrono::steady_clock::time_point _start;
+        std::uint64_t _startWorkingSet;
+        // Somados também pelas tarefas do pool que a fase criou, em outras threads
+        std::atomic<std::uint64_t> _fsCalls{0};
+        std::atomic<std::uint64_t> _filesRead{0};
+        std::atomic<std::uint64_t> _bytesRead{0};
+        std::atomic<std::uint64_t> _filesWritten{0};
+        std::atomic<std::uint64_t> _bytesWritten{0};
+    };
+
+    // Fase ativa na thread atual (nullptr fora de qualquer fase).
+    ScopedPhase* ActivePhase();
+
+    // Empresta uma fase a outra thread enquanto existir. O ThreadPool guarda a fase ativa no Submit e a empresta
+    // ao worker durante a tarefa, para que a E/S da tarefa conte para a fase que a criou. A fase tem que
+    // sobreviver a todas as tarefas (o pool termina antes do fim do escopo da fase).
+    class ScopedAttribution {
+    public:
+        explicit ScopedAttribution(ScopedPhase* phase);
+        ~ScopedAttribution();
+
+        ScopedAttribution(const ScopedAttribution&) = delete;
+        ScopedAttribution& operator=(const ScopedAttribution&) = delete;
+
+    private:
+        ScopedPhase* _previous;
+    };
+}
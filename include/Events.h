@@ -1,25 +1,56 @@
 #pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <set>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include "AtomicFile.h"
+#include "ConditionIR.h"
+#include "LibraryCache.h"
+#include "LibraryScanner.h"
+#include "LibraryWatcher.h"
+#include "ManagedManifest.h"
+#include "ModNameIndex.h"
 #include "Settings.h"  // Inclui as novas definies
+#include "StanceJournal.h"
+#include "StanceStore.h"
 #include "rapidjson/document.h"
 
-struct FileSaveConfig;
-
 class AnimationManager {
 public:
     static AnimationManager& GetSingleton();
     void ScanAnimationMods();
+    // Roda o ScanAnimationMods numa thread separada. A biblioteca s  lida pela UI depois de publicada.
+    void StartLibraryScan();
+    bool IsLibraryReady() const { return _libraryReady.load(std::memory_order_acquire); }
+    std::shared_future<void> WhenLibraryReady() const { return _libraryReadyFuture; }
     void DrawMainMenu();
 
 private:
     std::map<std::string, WeaponCategory> _categories;
     std::vector<AnimationModDef> _allMods;
 
+    // Progresso do escaneamento em segundo plano, lido pela thread da UI.
+    struct ScanProgress : LibraryScanner::Progress {
+        std::chrono::steady_clock::time_point start;
+    };
+    ScanProgress _scanProgress;
+    std::atomic<bool> _libraryReady{false};
+    std::shared_future<void> _libraryReadyFuture;
+
     // Armazena os caminhos de todos os config.json que nosso manager j tocou.
-    std::set<std::filesystem::path> _managedFiles; 
+    // Junto do hash do bloco escrito e do carimbo do arquivo (persistido no manifesto).
+    ManagedFileMap _managedFiles;
     bool _preserveConditions = false;
+    bool _optimizeConditions = true;  // Fatora os termos comuns do bloco gerado (ConditionIR::Optimize)
     bool _isAddModModalOpen = false;
     CategoryInstance* _instanceToAddTo = nullptr;
     ModInstance* _modInstanceToAddTo = nullptr;
@@ -27,23 +58,142 @@ private:
     ModInstance* _modInstanceToSaveAsCustom = nullptr;
     char _newMovesetNameBuffer[128] = "";
 
-    void ProcessTopLevelMod(const std::filesystem::path& modPath);
     void DrawAddModModal();
+    void DrawScanProgress();
+    void DrawDiagnostics();
+
+    // Uso de memria da biblioteca: formato atual (StringPool) contra o mesmo contedo no formato antigo.
+    struct LibraryMemoryReport {
+        std::size_t mods = 0;
+        std::size_t submods = 0;      // Inclui as cpias nos movesets de usurio
+        std::size_t legacyBytes = 0;  // std::string + std::filesystem::path por submod
+        std::size_t recordBytes = 0;  // Vetores de AnimationModDef/SubAnimationDef
+        std::size_t poolBytes = 0;    // Textos, ns de caminho e tabelas do StringPool
+    };
+    std::optional<LibraryMemoryReport> _memoryReport;
+    LibraryMemoryReport ComputeLibraryMemoryReport() const;
     void SaveAllSettings();
-    void UpdateOrCreateJson(const std::filesystem::path& jsonPath, const std::vector<FileSaveConfig>& configs);
-    void AddCompareValuesCondition(rapidjson::Value& conditionsArray, const std::string& graphVarName, int value,
-                                   rapidjson::Document::AllocatorType& allocator);
+    // Roda a gerao inteira em memria e mostra o que o salvamento faria, sem escrever nada.
+    void PlanAllSettings();
+
+    // --- Rastreamento de edies ---
+    // Uma aba de stance: nome da categoria e ndice da instncia (0-3).
+    using InstanceKey = std::pair<std::string, int>;
+    // O que mudou desde o ltimo salvamento. S o que est marcado  regenerado.
+    struct DirtyState {
+        bool all = true;  // Opes, biblioteca ou manifesto mudaram: tudo  regenerado
+        std::set<InstanceKey> instances;
+        std::set<std::filesystem::path> files;  // config.json que falharam ou ficaram de fora do ltimo salvamento
+    };
+    DirtyState _dirty;
+    // config.json que cada instncia gerou no ltimo salvamento. Um arquivo compartilhado por vrias instncias
+    // precisa de todas elas para ser regenerado.
+    std::map<InstanceKey, std::set<std::filesystem::path>> _filesByInstance;
+    // Mudana fora do editor (referncias reapontadas, movesets removidos da biblioteca): no cabe no dirio,
+    // ento pede um snapshot novo do store e invalida o histrico de desfazer.
+    void MarkInstanceDirty(const WeaponCategory& category, int instanceIndex);
+    // Edio registrada no dirio: s marca a instncia para o prximo salvamento e a prxima compactao.
+    void MarkInstanceEdited(const InstanceKey& key);
+    void MarkAllDirty() { _dirty.all = true; }
+    // Instncias que mudaram desde o ltimo snapshot do store. Independe de _dirty: o store  salvo sozinho, os
+    // config.json s quando o usurio pede.
+    std::set<InstanceKey> _unsavedStances;
+    bool _snapshotRequested = false;  // Houve mudana fora do dirio: o store precisa ser regravado
+    // Instncias em que a UI deixou de fora itens do store que no resolvem mais: as posies da UI no so as
+    // do store. A primeira edio nelas pede um snapshot em vez de ir para o dirio.
+    std::set<InstanceKey> _divergedInstances;
+    // O store  de uma verso mais nova ou ficou ilegvel sem poder ser movido: nada de stance  gravado nesta
+    // sesso, nem store nem dirio.
+    bool _stanceStoreLocked = false;
+    // Compacta quando pedido ou quando o dirio passou de StanceJournal::kCompactThreshold. Chamado uma vez
+    // por quadro.
+    void QueueStanceAutosave();
+    // Remonta no store as instncias mudadas e entrega store + dirio vazio ao Autosave.
+    void CompactStanceJournal();
+
+    // --- Dirio de edies (StanceJournal.h) e desfazer/refazer ---
+    std::vector<StanceJournal::Op> _undoStack;
+    std::vector<StanceJournal::Op> _redoStack;
+    std::size_t _journalRecords = 0;  // Registros no dirio desde a ltima compactao
+    // Operao sobre o moveset `movesetIndex` da instncia, com o ID dele j preenchido.
+    StanceJournal::Op StanceEditOp(StanceJournal::OpType type, const InstanceKey& key, size_t movesetIndex) const;
+    // Registra uma edio que a UI j aplicou no lugar: vai para o dirio e para a pilha de desfazer.
+    void RecordStanceEdit(StanceJournal::Op op);
+    // Acrescenta `op` ao dirio, a no ser que o store esteja travado.
+    void AppendStanceRecord(const StanceJournal::Op& op);
+    // Aplica uma operao ao estado da UI (desfazer, refazer) por StanceJournal::Apply. false se ela no cabe
+    // mais: posio fora da lista, outro moveset nela ou algo que no resolve na biblioteca.
+    bool ApplyStanceOp(const StanceJournal::Op& op);
+    void UndoStanceEdit();
+    void RedoStanceEdit();
+    // Instncia aberta quando o modal de adicionar foi chamado a partir de uma stance.
+    std::optional<InstanceKey> _modalInstanceKey;
+
+    struct ConditionFileSelection {
+        std::map<std::filesystem::path, std::vector<FileSaveConfig>> fileUpdates;
+        std::map<InstanceKey, std::set<std::filesystem::path>> filesByInstance;  // Das instncias percorridas
+        bool full = true;
+    };
+    // Configuraes de uma instncia, agrupadas pelo config.json. `files` recebe os caminhos usados.
+    void CollectInstanceConfigs(WeaponCategory& category, int instanceIndex,
+                                std::map<std::filesystem::path, std::vector<FileSaveConfig>>& fileUpdates,
+                                std::set<std::filesystem::path>& files);
+    ConditionFileSelection CollectConditionFileUpdates();
+    enum class ConditionFileChange : std::uint8_t {
+        Unchanged,  // J tem exatamente o contedo gerado
+        Create,     // config.json ainda no existe
+        Modify,
+        KillSwitch,  // Nenhuma configurao usa mais o arquivo: recebe a condio que nunca passa
+    };
+    // Plano de um arquivo de condio, e depois o resultado da execuo dele. Roda nas threads do pool: erros
+    // voltam aqui em vez de s irem pro log.
+    struct ConditionFileResult {
+        std::optional<std::uint64_t> blockHash;  // Hash do contedo gerenciado; nullopt em falha
+        ConditionFileChange change = ConditionFileChange::Unchanged;
+        std::optional<int> oldPriority;  // Prioridade lida do arquivo atual, se havia uma
+        int newPriority = 0;
+        std::uint64_t oldBytes = 0;
+        std::uint64_t newBytes = 0;
+        std::uint64_t bytesWritten = 0;        // S depois de executado
+        std::size_t conditionNodesBefore = 0;  // Ns do bloco gerado sem otimizao
+        std::size_t conditionNodesAfter = 0;   // Ns efetivamente escritos
+        std::string content;                   // Arquivo gerado, at ir para o lote
+        std::string error;
+    };
+    // Opes do salvamento, copiadas da UI no incio do trabalho.
+    struct ConditionWriteOptions {
+        bool preserveConditions = false;
+        bool optimizeConditions = true;
+        bool packedStateKey = false;  // Compara a chave de estado nica (StateKey.h)
+    };
+    // Gera o config.json em memria e decide o que muda; no escreve nada. Simulao e salvamento passam por aqui.
+    // `knownRecord`  o registro do manifesto, se houver: com hash, tamanho e data iguais nem abre o arquivo.
+    ConditionFileResult PlanConditionFile(const std::filesystem::path& jsonPath,
+                                          const std::vector<FileSaveConfig>& configs,
+                                          const ConditionWriteOptions& options,
+                                          const ManagedFileRecord* knownRecord = nullptr);
+    // Executa o plano: o contedo vai para `batch` e o config.json s muda no Commit do lote.
+    static void ExecuteConditionFilePlan(const std::filesystem::path& jsonPath, ConditionFileResult& plan,
+                                         AtomicFileBatch& batch);
+    void LoadManagedFiles();
+    // Varredura completa na thread de quem chama (o escaneamento, na primeira execuo).
+    void RebuildManagedManifest();
+    // A mesma varredura pelo boto da UI, em segundo plano como o SaveJob. Nenhum salvamento roda junto.
+    struct ManifestRebuildJob {
+        std::vector<std::filesystem::path> candidates;  // config.json de todos os submods
+        ManagedFileMap managedFiles;                    // Resultado, j gravado no manifesto
+        std::atomic<bool> finished{false};
+    };
+    std::shared_ptr<ManifestRebuildJob> _manifestRebuildJob;
+    std::future<void> _manifestRebuildFuture;
+    std::vector<std::filesystem::path> CollectManifestCandidates() const;
+    static ManagedFileMap ScanManagedFiles(const std::vector<std::filesystem::path>& candidates);
+    void StartManifestRebuild();
+    void FinishManifestRebuild();
     // NOVA FUNO HELPER: Para adicionar condies booleanas (checkboxes)
     void AddCompareBoolCondition(rapidjson::Value& conditionsArray, const std::string& graphVarName, bool value,
                                  rapidjson::Document::AllocatorType& allocator);
 
-    // Funo do random aqui
-    void AddRandomCondition(rapidjson::Value& conditionsArray, int value,
-                                              rapidjson::Document::AllocatorType& allocator);
-    // Para colocar direcionais no pai
-    void AddNegatedCompareValuesCondition(rapidjson::Value& conditionsArray, const std::string& graphVarName, int value,
-                                          rapidjson::Document::AllocatorType& allocator);
-
     // --- NOVAS VARIVEIS PARA GERENCIAR MOVESETS DO USURIO ---
 
     // Estrutura para manter um moveset de usurio em memria
@@ -80,31 +230,108 @@ private:
     void LoadStateForSubAnimation(size_t modIdx, size_t subAnimIdx);
 
     // --- NOVAS FUNES DE CARREGAMENTO/SALVAMENTO DA UI ---
+    // Todas as stances ficam num nico arquivo (StanceStore.h); os Instance*_Cycle.json antigos so importados
+    // uma vez.
     void LoadStanceConfigurations();
-    void SaveStanceConfigurations();
+    // `onlyInstances` limita a remontagem s instncias listadas (nullptr: todas). A gravao fica com o Autosave.
+    void SaveStanceConfigurations(const std::set<InstanceKey>* onlyInstances = nullptr);
+    StanceStore::Instance BuildStoredInstance(const WeaponCategory& category, int instanceIndex) const;
+    StanceStore::Moveset StoreMoveset(const ModInstance& modInstance) const;
+    StanceStore::Animation StoreAnimation(const SubAnimationInstance& subInstance) const;
+    // Caminho inverso, resolvendo pelo ID e depois pelo nome. nullopt se o moveset no existe mais.
+    std::optional<ModInstance> InstantiateMoveset(const StanceStore::Moveset& moveset);
+    std::optional<SubAnimationInstance> InstantiateAnimation(const StanceStore::Animation& animation);
+    void ExportStances();
+    StanceStore::StanceMap _storedStances;  // Contedo do store, atualizado a cada salvamento
 
     // Funo auxiliar para encontrar um mod pelo nome
-    std::optional<size_t> FindModIndexByName(const std::string& name);
+    std::optional<size_t> FindModIndexByName(std::string_view name);
     // Funo auxiliar para encontrar uma sub-animao pelo nome dentro de um mod
-    std::optional<size_t> FindSubAnimIndexByName(size_t modIdx, const std::string& name);
-};
+    std::optional<size_t> FindSubAnimIndexByName(size_t modIdx, std::string_view name);
+    // Liga a instncia ao registro de _allMods: ndices (cache), LibraryIds (identidade) e nomes.
+    void LinkSubAnimation(SubAnimationInstance& subInstance, size_t modIdx, size_t subIdx);
+    // Pelo LibraryId quando h um; seno (formato antigo, pasta renomeada) pelo nome.
+    std::optional<size_t> ResolveMod(LibraryId::Id id, std::string_view name);
+    bool ResolveSubAnimation(SubAnimationInstance& subInstance);
+    // Depois que mods trocam de lugar em _allMods: reaponta pelo ID s as referncias que mudaram.
+    void RelinkInstances();
+    // ndice das duas buscas acima. Mods acrescentados a _allMods entram sozinhos na prxima busca; quem troca
+    // um mod no lugar chama Reindex.
+    ModNameIndex _nameIndex;
+
+    // --- Atualizao da biblioteca com o jogo aberto ---
+    // Posio de cada mod de topo em _allMods, pelo nome da pasta.
+    std::unordered_map<std::u8string, size_t> _modIndexByFolder;
 
-struct FileSaveConfig {
-    int instance_index;
-    int order_in_playlist;
-    const WeaponCategory* category;
-    // Campos adicionados para carregar o estado das checkboxes
-    bool isParent = false;
-
-
-    bool pFront = false;
-    bool pBack = false;
-    bool pLeft = false;
-    bool pRight = false;
-    bool pFrontRight = false;
-    bool pFrontLeft = false;
-    bool pBackRight = false;
-    bool pBackLeft = false;
-    bool pRandom = false;
-    bool pDodge = false;
+    // Montado na thread do watcher e aplicado na thread da UI (DrawMainMenu).
+    struct LibraryUpdateBatch {
+        std::vector<LibraryIndexEntry> entries;  // Sem `mod` quando a pasta sumiu ou deixou de ser um mod
+        bool fullRescan = false;                 // Eventos perdidos: pastas ausentes do lote tambm sumiram
+    };
+    std::mutex _libraryUpdateMutex;
+    std::vector<LibraryUpdateBatch> _pendingLibraryUpdates;
+    // Arquivos que o prprio manager escreve (os gerenciados e os do SaveJob em andamento), na forma
+    // lexically_normal: o watcher ignora os eventos deles e dos temporrios do AtomicFileBatch. Refeito na
+    // thread da UI sempre que _managedFiles ou o SaveJob mudam; lido na thread do watcher.
+    std::mutex _selfWrittenMutex;
+    std::set<std::filesystem::path> _selfWrittenPaths;
+    void UpdateSelfWrittenPaths();
+    bool IsSelfWrittenPath(const std::filesystem::path& relative);
+    // --- Escrita dos arquivos de condio em segundo plano ---
+    // Montado na thread da UI; cada tarefa do pool escreve s no seu ndice de `results`.
+    struct SaveJob {
+        std::vector<std::pair<std::filesystem::path, std::vector<FileSaveConfig>>> files;
+        std::vector<ConditionFileResult> results;
+        std::vector<std::optional<ManagedFileRecord>> knownRecords;  // Cpia do manifesto no incio do trabalho
+        // Registros novos (hash do bloco + carimbo), feitos e gravados no manifesto pela thread do trabalho; a
+        // thread da UI s os copia para _managedFiles.
+        std::vector<std::optional<ManagedFileRecord>> records;
+        ManagedFileMap manifest;  // Cpia de _managedFiles, mais os registros novos
+        std::vector<char> notStarted;  // Cancelados antes de comear
+        AtomicFileBatch batch;         // Temporrios dos arquivos gerados, trocados juntos no fim
+        ConditionWriteOptions options;
+        bool dryRun = false;  // Simulao: os planos no so executados
+        std::atomic<std::size_t> completed{0};
+        std::atomic<bool> cancelRequested{false};
+        std::atomic<bool> finished{false};
+        double elapsedMs = 0.0;
+    };
+    struct SaveSummary {
+        std::size_t written = 0;
+        std::size_t failed = 0;
+        std::size_t unchanged = 0;
+        std::size_t notStarted = 0;
+        std::uint64_t bytesWritten = 0;
+        std::size_t conditionNodesBefore = 0;  // Soma de todos os arquivos, com e sem a otimizao
+        std::size_t conditionNodesAfter = 0;
+        std::int64_t bytesDelta = 0;  // Tamanho novo menos o antigo, nos arquivos que mudam
+        double elapsedMs = 0.0;
+        bool cancelled = false;
+        bool dryRun = false;
+        std::vector<std::pair<std::filesystem::path, std::string>> errors;
+        // Arquivos que mudam (ou mudariam, na simulao), sem o contedo gerado.
+        std::vector<std::pair<std::filesystem::path, ConditionFileResult>> changes;
+    };
+    std::shared_ptr<SaveJob> _saveJob;
+    std::future<void> _saveJobFuture;
+    std::optional<SaveSummary> _lastSaveSummary;
+    void StartConditionFileJobs(std::map<std::filesystem::path, std::vector<FileSaveConfig>> fileUpdates,
+                                bool dryRun);
+    void FinishConditionFileJobs();
+    void DrawSaveStatus();
+    void DrawSavePlan(const SaveSummary& summary);
+    static const char* ChangeLabel(ConditionFileChange change);  // Texto da UI
+    static const char* ChangeId(ConditionFileChange change);     // Valor no JSON exportado
+    static constexpr const char* kSavePlanPath = "Data/SKSE/Plugins/CycleMoveset_SavePlan.json";
+    static bool ExportSavePlan(const SaveSummary& summary);
+
+    // Declarado por ltimo:  destrudo (e a thread parada) antes dos membros que o callback usa.
+    std::unique_ptr<LibraryWatcher> _libraryWatcher;
+
+    void StartLibraryWatcher();
+    void OnLibraryChanged(const std::set<std::u8string>& changedMods, bool fullRescan);
+    void ApplyLibraryUpdates();
+    // false quando nada que a UI ou as stances enxergam mudou (conjunto, nomes, tags e disponibilidade).
+    static bool MergeModDefinition(AnimationModDef& target, AnimationModDef&& source);
 };
+
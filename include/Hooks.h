@@ -141,5 +141,8 @@ namespace MyMenu {
      * @param dx_key_ptr Um ponteiro para o inteiro onde o scan code da tecla ser armazenado.
      */
     void Keybind(const char* label, int* dx_key_ptr);
+
+    // Grava as hotkeys e opes em CycleMoveset_Settings.json.
+    void SaveSettings();
     
 }
@@ -0,0 +1,40 @@
+﻿#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Settings.h"
+
+// Carimbo de uma pasta dentro de um mod OAR. Se o mtime de alguma pasta mudar
+// (arquivo/pasta criado, removido ou renomeado dentro dela), o mod inteiro é re-escaneado.
+// Só o mtime é guardado: conferir o número de entradas exigiria listar a pasta, que é o que o cache evita.
+struct DirectoryStamp {
+    std::u8string relativePath;  // Relativo à pasta do mod ("" = a própria pasta do mod)
+    std::int64_t mtime = 0;
+};
+
+// Resultado do escaneamento de uma pasta de topo do OAR, junto com os carimbos usados para validar o cache.
+struct LibraryIndexEntry {
+    std::u8string folderName;
+    bool hasConfig = false;
+    std::int64_t configMtime = 0;
+    std::uint64_t configSize = 0;
+    std::vector<DirectoryStamp> directories;
+    std::optional<AnimationModDef> mod;  // nullopt = pasta sem config.json válido (também é cacheado)
+};
+
+namespace LibraryCache {
+    // Fica ao lado do CycleMoveset_Settings.json.
+    inline constexpr const char* kIndexPath = "Data/SKSE/Plugins/CycleMoveset_LibraryIndex.bin";
+
+    std::int64_t ToStamp(std::filesystem::file_time_type time);
+
+    // Carrega o índice. Arquivo ausente, de outra versão ou corrompido retorna um mapa vazio.
+    std::unordered_map<std::u8string, LibraryIndexEntry> Load(const std::filesystem::path& oarRootPath);
+    bool Save(const std::vector<LibraryIndexEntry>& entries, const std::filesystem::path& oarRootPath);
+
+    // Confere apenas os carimbos (um stat por pasta), sem listar nenhum diretório.
+    bool IsUpToDate(const std::filesystem::path& modPath, const LibraryIndexEntry& entry);
+}
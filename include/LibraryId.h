@@ -0,0 +1,33 @@
+﻿#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+// Identificador estável de um mod ou sub-animação: hash de 64 bits do caminho relativo à pasta do OAR
+// ("Mod/sub/pasta"). Não depende da ordem do escaneamento nem da posição em _allMods, então sobrevive a
+// re-escaneamentos e à reconstrução dos movesets de usuário. 0 significa "sem ID" (formatos antigos).
+namespace LibraryId {
+    using Id = std::uint64_t;
+
+    // FNV-1a sobre o caminho normalizado: '/' como separador e letras ASCII minúsculas, como o Windows compara.
+    constexpr Id Append(Id hash, std::string_view utf8) {
+        for (const char c : utf8) {
+            char normalized = c == '\\' ? '/' : c;
+            if (normalized >= 'A' && normalized <= 'Z') normalized = static_cast<char>(normalized - 'A' + 'a');
+            hash ^= static_cast<unsigned char>(normalized);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+    constexpr Id FromUtf8(std::string_view relativeUtf8) { return Append(14695981039346656037ull, relativeUtf8); }
+
+    inline Id FromRelativePath(const std::filesystem::path& relative) {
+        const auto utf8 = relative.generic_u8string();
+        return FromUtf8(std::string_view(reinterpret_cast<const char*>(utf8.data()), utf8.size()));
+    }
+
+    // Movesets de usuário não têm pasta: o prefixo não pode ser nome de pasta no Windows.
+    constexpr Id ForUserMoveset(std::string_view name) { return Append(FromUtf8("<user>/"), name); }
+
+    static_assert(FromUtf8("Mod/Sub") == FromUtf8("mod\\sub"));
+}
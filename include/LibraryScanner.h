@@ -0,0 +1,83 @@
+﻿#pragma once
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "LibraryCache.h"
+#include "Settings.h"
+
+// Motor de travessia da biblioteca OAR: cada pasta é listada exatamente uma vez, e dessa
+// única listagem saem o config.json, as tags dos arquivos .hkx e as subpastas.
+namespace LibraryScanner {
+    // Contadores de chamadas ao sistema de arquivos, acumulados entre todas as threads do scan.
+    struct ScanStats {
+        std::atomic<std::uint64_t> directoriesListed{0};  // Um FindFirstFile/opendir por pasta
+        std::atomic<std::uint64_t> entriesVisited{0};     // Entradas devolvidas pelas listagens
+        std::atomic<std::uint64_t> statCalls{0};          // Consultas avulsas (exists/status/last_write_time)
+        std::atomic<std::uint64_t> filesRead{0};          // Arquivos abertos para leitura
+        std::atomic<std::uint64_t> bytesRead{0};          // Bytes consumidos desses arquivos
+        std::atomic<std::uint64_t> submodsFound{0};
+
+        void Reset();
+        std::uint64_t TotalCalls() const;
+    };
+
+    ScanStats& GetStats();
+
+    struct DirectoryListing {
+        bool hasConfig = false;
+        std::uint64_t configSize = 0;
+        std::int64_t configMtime = 0;
+        std::uint32_t entryCount = 0;
+        std::vector<std::filesystem::directory_entry> subdirectories;
+    };
+
+    // Lista `dir` uma vez. As tags dos arquivos encontrados são contadas em `tags`.
+    // No MSVC o directory_entry já vem com tipo, tamanho e data da própria listagem, sem stat extra.
+    DirectoryListing ListDirectory(const std::filesystem::path& dir, SubAnimationDef& tags);
+
+    struct ModHeader {
+        bool valid = false;  // "name" e "author" encontrados como strings no objeto raiz
+        std::string name;
+        std::string author;
+        std::uint64_t bytesRead = 0;  // Quanto do arquivo foi lido até parar
+    };
+
+    // Lê só "name" e "author" do config.json de um mod de topo, em streaming, parando assim que os dois
+    // aparecem. Árvores de condições grandes depois deles nunca são lidas. Aceita BOM.
+    ModHeader ReadModHeader(const std::filesystem::path& configPath);
+
+    // Percorre as subpastas em pré-ordem (mesma ordem do recursive_directory_iterator),
+    // carimbando cada pasta e criando um SubAnimationDef para cada uma que tenha config.json. Links de pasta
+    // (symlinks, junctions) são listados mas não percorridos.
+    // `parentFolder` é o nó de `modPath` no StringPool.
+    void CollectSubAnimations(const std::filesystem::path& modPath, const PathNode* parentFolder,
+                              const std::vector<std::filesystem::directory_entry>& subdirectories,
+                              std::vector<DirectoryStamp>& stamps, std::vector<SubAnimationDef>& subAnimations);
+
+    // Escaneia uma pasta de topo do OAR: listagem, cabeçalho do config.json e submods. Não toca em estado
+    // nenhum além do StringPool, então roda em qualquer thread (scan inicial e watcher).
+    LibraryIndexEntry ProcessTopLevelMod(const std::filesystem::directory_entry& modEntry);
+
+    // Progresso de ScanLibrary, lido por outra thread.
+    struct Progress {
+        std::atomic<std::size_t> modsTotal{0};
+        std::atomic<std::size_t> modsScanned{0};
+    };
+
+    struct LibraryScan {
+        // Um por pasta de topo, na ordem dos caminhos: os índices em _allMods não dependem de qual thread
+        // termina primeiro. Pastas que falharam ficam de fora.
+        std::vector<LibraryIndexEntry> entries;
+        std::size_t rescanned = 0;  // Pastas escaneadas de fato; as outras vieram do índice
+        std::size_t fromIndex = 0;
+    };
+
+    // Escaneia a biblioteca inteira, um mod de topo por tarefa num ThreadPool de `threads` threads (0: uma por
+    // núcleo). Mods do índice salvo (LibraryCache) com os carimbos em dia são reaproveitados sem listar nada, e o
+    // índice só é regravado se algo mudou. Zera GetStats() no início e soma os contadores à fase de diagnóstico
+    // ativa no fim.
+    LibraryScan ScanLibrary(const std::filesystem::path& oarRootPath, std::size_t threads = 0,
+                            Progress* progress = nullptr);
+}
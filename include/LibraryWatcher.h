@@ -0,0 +1,64 @@
+﻿#pragma once
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Observa a pasta do OAR com o jogo aberto e agrupa as mudanças por mod de topo.
+// Rajadas de eventos (um gerenciador de mods instalando milhares de arquivos) viram um único lote.
+class LibraryWatcher {
+public:
+    // Fonte dos eventos do sistema de arquivos. Uma implementação por plataforma.
+    class Backend {
+    public:
+        virtual ~Backend() = default;
+        virtual bool Open(const std::filesystem::path& root) = 0;
+        // Espera até `timeout` e acrescenta em `changed` os caminhos (relativos à raiz) que mudaram.
+        // Se o sistema perdeu eventos (buffer estourado), marca `overflow`.
+        virtual void Poll(std::chrono::milliseconds timeout, std::vector<std::filesystem::path>& changed,
+                          bool& overflow) = 0;
+        virtual void Close() = 0;
+    };
+
+    // Recebe os nomes das pastas de topo afetadas. `fullRescan` indica que eventos foram perdidos.
+    using BatchCallback = std::function<void(const std::set<std::u8string>& changedMods, bool fullRescan)>;
+    // true para caminhos (relativos à raiz) cujos eventos não contam, como os arquivos que o próprio plugin
+    // escreve. Roda na thread do watcher.
+    using IgnoreFilter = std::function<bool(const std::filesystem::path& relative)>;
+
+    static constexpr auto kDebounce = std::chrono::milliseconds(750);  // Silêncio necessário para fechar o lote
+    static constexpr auto kMaxBatchDelay = std::chrono::seconds(10);   // Limite para rajadas que não param
+    static constexpr auto kPollInterval = std::chrono::milliseconds(200);
+
+    // ReadDirectoryChangesW no Windows, inotify no Linux; nullptr em plataformas sem suporte.
+    static std::unique_ptr<Backend> CreateDefaultBackend();
+
+    LibraryWatcher(std::filesystem::path root, BatchCallback callback,
+                   std::unique_ptr<Backend> backend = CreateDefaultBackend());
+    ~LibraryWatcher();
+
+    LibraryWatcher(const LibraryWatcher&) = delete;
+    LibraryWatcher& operator=(const LibraryWatcher&) = delete;
+
+    // Deve ser chamado antes de Start.
+    void SetIgnoreFilter(IgnoreFilter filter) { _ignore = std::move(filter); }
+
+    bool Start();
+    void Stop();
+
+private:
+    void Run();
+
+    std::filesystem::path _root;
+    BatchCallback _callback;
+    IgnoreFilter _ignore;
+    std::unique_ptr<Backend> _backend;
+    std::thread _thread;
+    std::atomic<bool> _stopRequested{false};
+};
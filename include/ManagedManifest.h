@@ -0,0 +1,44 @@
+﻿#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string_view>
+
+// FNV-1a de 64 bits. Usado para identificar o conteúdo do bloco OAR_CYCLE_MANAGER_CONDITIONS que escrevemos.
+inline std::uint64_t Fnv1a64(std::string_view data, std::uint64_t hash = 14695981039346656037ull) {
+    for (const unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// O que sabemos de um config.json que o manager já escreveu.
+struct ManagedFileRecord {
+    std::uint64_t blockHash = 0;  // Hash do bloco gerenciado, da prioridade e do modo de preservação; 0 = desconhecido
+    std::uint64_t size = 0;       // Tamanho e data do arquivo logo após a escrita
+    std::int64_t mtime = 0;
+};
+
+using ManagedFileMap = std::map<std::filesystem::path, ManagedFileRecord>;
+
+// Manifesto dos arquivos gerenciados. Evita ler todos os config.json da biblioteca a cada inicialização.
+namespace ManagedManifest {
+    inline constexpr const char* kManifestPath = "Data/SKSE/Plugins/CycleMovesets/ManagedFiles.json";
+    inline constexpr std::string_view kMarker = "OAR_CYCLE_MANAGER_CONDITIONS";
+
+    // nullopt se o manifesto não existe ou é inválido (nesse caso é preciso reconstruir).
+    std::optional<ManagedFileMap> Load();
+    bool Save(const ManagedFileMap& files);
+
+    // Atualiza tamanho e data do registro a partir do arquivo em disco.
+    bool Stamp(const std::filesystem::path& path, ManagedFileRecord& record);
+
+    // Se tamanho e data batem com o manifesto, confia no registro sem abrir o arquivo.
+    // Caso contrário, lê o arquivo e procura o marcador.
+    bool Verify(const std::filesystem::path& path, ManagedFileRecord& record);
+
+    // Leitura completa do arquivo procurando o marcador (caminho lento, usado na reconstrução).
+    bool ContainsMarker(const std::filesystem::path& path);
+}
@@ -0,0 +1,46 @@
+﻿#pragma once
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "LibraryId.h"
+#include "Settings.h"
+
+// Busca de mods e sub-animações pelo nome ou pelo LibraryId, por hash, para resolver as stances e os movesets
+// de usuário sem percorrer _allMods a cada referência. Aceita std::string_view direto (hash transparente).
+class ModNameIndex {
+public:
+    void Clear();
+    // Indexa os mods acrescentados ao fim de `mods` desde a última chamada. Barato quando nada mudou.
+    void Append(const std::vector<AnimationModDef>& mods);
+    // O mod `modIdx` foi trocado no lugar (merge do watcher, moveset de usuário refeito).
+    void Reindex(const std::vector<AnimationModDef>& mods, std::size_t modIdx);
+
+    // Mesmo resultado da busca linear: o primeiro mod com o nome (ou ID).
+    std::optional<std::size_t> FindMod(std::string_view name) const;
+    std::optional<std::size_t> FindSubAnim(std::size_t modIdx, std::string_view name) const;
+    std::optional<std::size_t> FindModById(LibraryId::Id id) const;
+    std::optional<std::size_t> FindSubAnimById(std::size_t modIdx, LibraryId::Id id) const;
+
+private:
+    struct TransparentHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view text) const { return std::hash<std::string_view>{}(text); }
+    };
+    template <class Key>
+    using NameMap = std::unordered_map<Key, std::size_t, TransparentHash, std::equal_to<>>;
+    using IdMap = std::unordered_map<LibraryId::Id, std::size_t>;  // O ID já é um hash
+
+    void IndexSubAnimations(const AnimationModDef& mod, std::size_t modIdx);
+
+    NameMap<std::string> _modByName;
+    IdMap _modById;
+    std::vector<std::string> _indexedNames;  // Nome com que cada mod entrou no índice
+    std::vector<LibraryId::Id> _indexedIds;
+    // Por mod. As chaves de nome apontam para o StringPool, que nunca libera nem move os textos.
+    std::vector<NameMap<std::string_view>> _subAnimByName;
+    std::vector<IdMap> _subAnimById;
+};
@@ -1,21 +1,46 @@
 #pragma once
 #include <array>
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
 #include <string>
 #include <vector>
+#include "StringPool.h"
 
 // --- Definies da Biblioteca ---
+// Tags reconhecidas no nome dos arquivos de um submod (padres em TagClassifier.h).
+enum class AnimationTag : std::uint8_t {
+    Attack,       // BFCO_Attack*
+    PowerAttack,  // BFCO_PowerAttack*
+    SprintAttack,
+    Idle,
+    Dodge,
+    Block,
+    Bash,
+    Equip,
+    Unequip,
+    Count
+};
+inline constexpr std::size_t kAnimationTagCount = static_cast<std::size_t>(AnimationTag::Count);
+
+// Registro compacto: nome e pasta vivem no StringPool, ento copiar um SubAnimationDef (ex.: para os
+// movesets de usurio) no aloca nada. O caminho do config.json  montado sob demanda.
 struct SubAnimationDef {
-    std::string name;
-    std::filesystem::path path;
-    int attackCount = 0;       // Contagem de arquivos BFCO_Attack
-    int powerAttackCount = 0;  // Contagem de arquivos BFCO_PowerAttack
-    bool hasIdle = false;      // Presena de arquivos "idle"
+    InternedString name;
+    const PathNode* folder = nullptr;
+    std::filesystem::path ConfigPath() const { return StringPool::BuildPath(folder) / "config.json"; }
+    std::array<std::uint32_t, kAnimationTagCount> tagCounts{};  // Quantos arquivos tm cada tag
+    std::uint32_t TagCount(AnimationTag tag) const { return tagCounts[static_cast<std::size_t>(tag)]; }
+    bool available = true;  // false quando a pasta foi removida com o jogo aberto
+    std::uint64_t id = 0;   // LibraryId do caminho da pasta
 };
 struct AnimationModDef {
     std::string name;
     std::string author;
     std::vector<SubAnimationDef> subAnimations;
+    // Mods removidos continuam no vetor (marcados) para que os ndices das instncias continuem vlidos.
+    bool available = true;
+    std::uint64_t id = 0;  // LibraryId da pasta do mod (LibraryId::ForUserMoveset nos movesets de usurio)
 };
 
 // --- Estruturas de Configurao do Usurio ---
@@ -25,6 +50,9 @@ struct SubAnimationInstance {
     std::string sourceSubName;  // Nome da sub-animao de origem (e.g., "700036")
     size_t sourceModIndex;
     size_t sourceSubAnimIndex;
+    // Identidade persistida (LibraryId). Os ndices acima so s o cache dela em _allMods.
+    std::uint64_t sourceModId = 0;
+    std::uint64_t sourceSubId = 0;
     bool isSelected = true;
     bool pFront = false;
     bool pBack = false;
@@ -40,6 +68,7 @@ struct SubAnimationInstance {
 
 struct ModInstance {
     size_t sourceModIndex;
+    std::uint64_t sourceModId = 0;
     bool isSelected = true;
     std::vector<SubAnimationInstance> subAnimationInstances;
 };
@@ -56,6 +85,26 @@ struct WeaponCategory {
     std::array<CategoryInstance, 4> instances;
 };
 
+struct FileSaveConfig {
+    int instance_index;
+    int order_in_playlist;
+    const WeaponCategory* category;
+    // Campos adicionados para carregar o estado das checkboxes
+    bool isParent = false;
+
+
+    bool pFront = false;
+    bool pBack = false;
+    bool pLeft = false;
+    bool pRight = false;
+    bool pFrontRight = false;
+    bool pFrontLeft = false;
+    bool pBackRight = false;
+    bool pBackLeft = false;
+    bool pRandom = false;
+    bool pDodge = false;
+};
+
 struct UserMoveset {
     std::string name;
     std::vector<SubAnimationInstance> subAnimations;
@@ -0,0 +1,77 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+#include "StanceStore.h"
+
+// Diário das edições feitas no editor de stances. Cada edição vira um registro pequeno acrescentado ao fim do
+// arquivo; o store (StanceStore.h) só é regravado inteiro na compactação. Ao carregar, os registros são
+// reaplicados sobre o snapshot cujo Fnv1a64 está no cabeçalho do diário. Se o snapshot mudou depois disso (a
+// compactação gravou o store e não chegou a zerar o diário), o diário é ignorado: o store já contém tudo.
+//
+// Os índices são posições na lista da UI, que inclui os itens desmarcados (por isso o store também os guarda).
+// A reaplicação é feita sobre o snapshot, antes de montar a UI: ele guarda também os movesets e sub-animações que
+// não resolvem mais na biblioteca, então as posições continuam valendo depois que um mod é desinstalado.
+namespace StanceJournal {
+    inline constexpr const char* kJournalPath = "Data/SKSE/Plugins/CycleMovesets/Stances.journal";
+    inline constexpr std::size_t kCompactThreshold = 4096;  // Registros no diário antes de regravar o store
+
+    enum class OpType : std::uint8_t {
+        SwapMovesets,          // moveset <-> target
+        SwapAnimations,        // animation <-> target, dentro de moveset; animationId/targetId antes da troca
+        SetMovesetSelected,    // before/after: 0 ou 1
+        SetAnimationSelected,  // before/after: 0 ou 1; animationId
+        SetAnimationFlags,     // before/after: StanceStore::PackFlags; animationId
+        InsertMoveset,         // movesetData na posição moveset
+        RemoveMoveset,         // movesetData é o que foi removido da posição moveset
+        InsertAnimation,       // animationData na posição animation de moveset (o ID é animationData.sourceSubId)
+        RemoveAnimation,
+    };
+
+    struct Op {
+        OpType type = OpType::SwapMovesets;
+        std::string category;
+        std::uint8_t instance = 0;
+        std::uint32_t moveset = 0;
+        std::uint32_t animation = 0;
+        std::uint32_t target = 0;
+        // ID do moveset na posição `moveset` quando a edição foi feita. Na reaplicação, um ID diferente quer
+        // dizer que a biblioteca mudou e o resto do diário não vale mais.
+        std::uint64_t movesetId = 0;
+        // Da mesma forma, sourceSubId da sub-animação em `animation` e do item em `target` (moveset ou
+        // sub-animação, conforme a troca). 0 = não gravado (diário da versão 1), sem conferência.
+        std::uint64_t animationId = 0;
+        std::uint64_t targetId = 0;
+        std::uint16_t before = 0;
+        std::uint16_t after = 0;
+        StanceStore::Moveset movesetData;
+        StanceStore::Animation animationData;
+    };
+
+    // A operação que desfaz `op`.
+    Op Inverse(const Op& op);
+
+    // Cabeçalho de um diário vazio sobre o snapshot de hash `snapshotHash`.
+    std::string Header(std::uint64_t snapshotHash);
+    // Um registro, já com o tamanho na frente, pronto para ser acrescentado ao arquivo.
+    std::string Encode(const Op& op);
+
+    // Aplica `op` a uma instância no formato do store. false se ela não cabe mais: posição fora da lista ou outro
+    // moveset/sub-animação nela. Nesse caso a instância fica como estava.
+    bool Apply(StanceStore::Instance& movesets, const Op& op);
+    // O mesmo, na instância (op.category, op.instance) de um snapshot inteiro.
+    bool Apply(StanceStore::StanceMap& stances, const Op& op);
+    // Reaplica `ops` em ordem sobre o snapshot e devolve as que foram aplicadas. Uma operação que não cabe
+    // descarta só o resto da sua instância (categoria, instância); as outras continuam. `brokenInstances` recebe
+    // quantas instâncias pararam assim.
+    std::vector<Op> Replay(StanceStore::StanceMap& stances, std::vector<Op> ops,
+                           std::size_t* brokenInstances = nullptr);
+
+    // Registros gravados sobre o snapshot `snapshotHash`. nullopt: sem diário ou de outro snapshot.
+    // Um registro cortado no fim (queda durante a escrita) encerra a leitura sem invalidar os anteriores.
+    // `outdated` indica um diário de versão anterior: ele precisa ser fechado por um snapshot antes de receber
+    // registros novos.
+    std::optional<std::vector<Op>> Load(std::uint64_t snapshotHash, bool* outdated = nullptr);
+}
@@ -0,0 +1,73 @@
+﻿#pragma once
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+#include "Settings.h"
+
+// Todas as stances (categoria x instância) num único arquivo binário versionado: uma leitura para carregar e
+// uma escrita atômica para salvar. Guarda LibraryIds e nomes, nunca índices de _allMods: quem carrega resolve
+// pelo ID e, se ele não existir mais (pasta renomeada, arquivo da versão 1), pelo nome.
+namespace StanceStore {
+    inline constexpr const char* kStorePath = "Data/SKSE/Plugins/CycleMovesets/Stances.bin";
+    // Para onde vai um store ilegível antes que qualquer coisa seja gravada no lugar dele.
+    inline constexpr const char* kQuarantinePath = "Data/SKSE/Plugins/CycleMovesets/Stances.bin.bad";
+    // Cópia legível, gerada sob demanda. Nunca é lida de volta.
+    inline constexpr const char* kExportPath = "Data/SKSE/Plugins/CycleMovesets/Stances_Export.json";
+    // Formato antigo: Stances/<Categoria>/Instance<N>_Cycle.json. Importado uma vez, enquanto não há store.
+    inline constexpr const char* kLegacyRoot = "Data/SKSE/Plugins/CycleMovesets/Stances";
+    inline constexpr int kInstanceCount = 4;
+
+    // Um bit por checkbox de condição, na ordem dos campos de SubAnimationInstance.
+    enum Flag : std::uint16_t {
+        kFront = 1 << 0,
+        kBack = 1 << 1,
+        kLeft = 1 << 2,
+        kRight = 1 << 3,
+        kFrontRight = 1 << 4,
+        kFrontLeft = 1 << 5,
+        kBackRight = 1 << 6,
+        kBackLeft = 1 << 7,
+        kRandom = 1 << 8,
+        kDodge = 1 << 9,
+    };
+    std::uint16_t PackFlags(const SubAnimationInstance& subInstance);
+    void UnpackFlags(std::uint16_t flags, SubAnimationInstance& subInstance);
+
+    struct Animation {
+        std::string sourceModName;
+        std::string sourceSubName;
+        std::uint64_t sourceModId = 0;  // 0: sem ID (formato antigo)
+        std::uint64_t sourceSubId = 0;
+        std::uint16_t flags = 0;
+        bool selected = true;  // Desmarcada na UI: continua no store, mas não gera condições
+    };
+    struct Moveset {
+        std::string name;
+        std::uint64_t id = 0;
+        bool userMoveset = false;
+        bool selected = true;
+        std::vector<Animation> animations;
+    };
+    using Instance = std::vector<Moveset>;
+    using StanceMap = std::map<std::string, std::array<Instance, kInstanceCount>>;  // Pelo nome da categoria
+
+    enum class LoadError {
+        Missing,       // Não há store: primeira execução, ou ainda no formato antigo
+        Unreadable,    // Existe, mas não abre ou está corrompido
+        NewerVersion,  // Gravado por uma versão mais nova do plugin; não pode ser sobrescrito
+    };
+    // nullopt em caso de erro, com o motivo em `error`. `contentHash` recebe o Fnv1a64 do arquivo lido, que
+    // identifica o snapshot sobre o qual o diário (StanceJournal.h) foi gravado.
+    std::optional<StanceMap> Load(std::uint64_t* contentHash = nullptr, LoadError* error = nullptr);
+    // Move o store para kQuarantinePath, substituindo um anterior. false se ele continua em kStorePath.
+    bool Quarantine();
+    // Conteúdo do arquivo do store. Quem grava é o Autosave, fora da thread da UI.
+    std::string Serialize(const StanceMap& stances);
+    bool ExportJson(const StanceMap& stances, const std::filesystem::path& path = kExportPath);
+    // Lê os arquivos do formato antigo das categorias informadas. nullopt se a pasta antiga não existe.
+    std::optional<StanceMap> ImportLegacy(const std::vector<std::string>& categories);
+}
@@ -0,0 +1,38 @@
+﻿#pragma once
+
+// Chave de estado única: instância do ciclo, posição na playlist e direção empacotadas numa só variável
+// float do behavior graph. Com o modo ligado, o bloco gerado compara só essa variável (igualdade ou faixa)
+// em vez de cycle_instance, testarone e DirecionalCycleMoveset separadas.
+// O tipo de arma continua no IsEquippedType, que o OAR resolve sem variável de grafo.
+namespace StateKey {
+    // Precisa existir no behavior, como as outras variáveis do ciclo.
+    inline constexpr const char* kGraphVariable = "CycleMovesetState";
+
+    // chave = (instância * kOrderSlots + ordem) * kDirectionSlots + direção. Em decimal os componentes
+    // continuam legíveis no log: instância 2, ordem 3, direção 5 -> 20035.
+    inline constexpr int kDirectionSlots = 10;  // 0 = parado, 1..8 = direções
+    inline constexpr int kOrderSlots = 1000;
+    inline constexpr int kMaxDirection = 8;
+
+    constexpr int Pack(int instance, int order, int direction) {
+        return (instance * kOrderSlots + order) * kDirectionSlots + direction;
+    }
+    // A posição na playlist cabe na chave? Fora disso a geração volta às comparações separadas.
+    constexpr bool CanPack(int instance, int order) {
+        return instance >= 0 && instance < 100 && order > 0 && order < kOrderSlots;
+    }
+    static_assert(Pack(99, kOrderSlots - 1, kMaxDirection) < (1 << 24), "A chave precisa ser exata num float");
+
+    void SetEnabled(bool enabled);
+    bool IsEnabled();
+
+    // Chamados quando o plugin muda o componente; publicam a chave se ela mudou.
+    void SetDirection(int direction);
+    void SetPlaylistOrder(int order);
+    // Relê cycle_instance (escrita fora do plugin) e publica de novo, mesmo que a chave pareça igual:
+    // o grafo é recriado ao carregar o jogo.
+    void Refresh();
+    // Relê cycle_instance e publica só se a chave mudou: uma leitura de variável do grafo por chamada. Chamado
+    // a cada quadro de input, para que a chave não fique velha quando só cycle_instance muda.
+    void Poll();
+}
@@ -0,0 +1,71 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+// Texto guardado uma única vez no StringPool. Cópias são só um ponteiro e um tamanho, a memória nunca
+// é liberada nem movida, e dois InternedString iguais apontam para o mesmo lugar (comparação por ponteiro).
+class InternedString {
+public:
+    InternedString() = default;
+
+    std::string_view View() const { return {_data, _size}; }
+    const char* c_str() const { return _data; }  // O pool guarda o '\0' final
+    std::size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+    operator std::string_view() const { return View(); }
+
+    friend bool operator==(InternedString a, InternedString b) {
+        return a._size == b._size && (a._data == b._data || a._size == 0);
+    }
+    friend bool operator==(InternedString a, std::string_view b) { return a.View() == b; }
+
+private:
+    friend class StringPool;
+    InternedString(const char* data, std::uint32_t size) : _data(data), _size(size) {}
+
+    const char* _data = "";
+    std::uint32_t _size = 0;
+};
+
+// Um segmento de caminho ligado à pasta pai. Pastas com o mesmo pai compartilham o prefixo inteiro.
+struct PathNode {
+    const PathNode* parent = nullptr;
+    InternedString segment;  // UTF-8
+};
+
+// Pool global de textos e de nós de caminho da biblioteca. Dividido em fatias com mutex próprio para
+// que as threads do escaneamento não disputem uma trava única.
+class StringPool {
+public:
+    static StringPool& GetSingleton();
+
+    InternedString Intern(std::string_view text);
+    const PathNode* InternSegment(const PathNode* parent, std::string_view segmentUtf8);
+    // Um nó por componente de `path`, a partir de `parent` (nullptr = raiz).
+    const PathNode* InternPath(const std::filesystem::path& path, const PathNode* parent = nullptr);
+
+    // Caminho completo montado sob demanda a partir dos segmentos.
+    static std::filesystem::path BuildPath(const PathNode* node);
+
+    struct MemoryStats {
+        std::size_t strings = 0;
+        std::size_t pathNodes = 0;
+        std::size_t arenaBytes = 0;  // Blocos alocados para textos e nós
+        std::size_t indexBytes = 0;  // Estimativa das tabelas de busca
+    };
+    MemoryStats GetMemoryStats() const;
+
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+
+private:
+    StringPool();
+    ~StringPool();
+
+    struct Shard;
+    static constexpr std::size_t kShardCount = 16;
+    Shard* _shards;
+};
@@ -0,0 +1,158 @@
+﻿#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <type_traits>
+#include "Settings.h"
+
+// Classificador dos nomes de arquivo de um submod. O autômato (Aho-Corasick já convertido em tabela de
+// transições) é montado em tempo de compilação; classificar um nome é uma leitura de tabela por caractere,
+// sem cópia, sem minúsculas temporárias e sem alocação.
+namespace TagClassifier {
+    struct Pattern {
+        std::string_view text;  // Em minúsculas; a comparação ignora maiúsculas/minúsculas (ASCII)
+        AnimationTag tag;
+        bool prefix;  // true: só no início do nome. false: em qualquer posição
+    };
+
+    inline constexpr Pattern kPatterns[] = {
+        {"bfco_attack", AnimationTag::Attack, true},
+        {"bfco_powerattack", AnimationTag::PowerAttack, true},
+        {"sprintattack", AnimationTag::SprintAttack, false},
+        {"sprint_attack", AnimationTag::SprintAttack, false},
+        {"sprintpowerattack", AnimationTag::SprintAttack, false},
+        {"idle", AnimationTag::Idle, false},
+        {"dodge", AnimationTag::Dodge, false},
+        {"evade", AnimationTag::Dodge, false},
+        {"block", AnimationTag::Block, false},
+        {"bash", AnimationTag::Bash, false},
+        {"equip", AnimationTag::Equip, false},
+        {"unequip", AnimationTag::Unequip, false},
+        {"sheathe", AnimationTag::Unequip, false},
+    };
+
+    using TagMask = std::uint16_t;
+    static_assert(kAnimationTagCount <= sizeof(TagMask) * 8);
+
+    constexpr TagMask Bit(AnimationTag tag) { return static_cast<TagMask>(1u << static_cast<unsigned>(tag)); }
+
+    namespace detail {
+        // Alfabeto reduzido: 26 letras (sem distinção de caixa), '_', início do nome e "qualquer outro".
+        inline constexpr std::size_t kUnderscoreSymbol = 26;
+        inline constexpr std::size_t kStartSymbol = 27;
+        inline constexpr std::size_t kOtherSymbol = 28;
+        inline constexpr std::size_t kAlphabetSize = 29;
+
+        constexpr std::array<std::uint8_t, 256> BuildSymbolTable() {
+            std::array<std::uint8_t, 256> table{};
+            for (std::size_t c = 0; c < 256; ++c) {
+                if (c >= 'a' && c <= 'z') {
+                    table[c] = static_cast<std::uint8_t>(c - 'a');
+                } else if (c >= 'A' && c <= 'Z') {
+                    table[c] = static_cast<std::uint8_t>(c - 'A');
+                } else if (c == '_') {
+                    table[c] = kUnderscoreSymbol;
+                } else {
+                    table[c] = kOtherSymbol;
+                }
+            }
+            return table;
+        }
+        inline constexpr auto kSymbols = BuildSymbolTable();
+
+        constexpr std::size_t CountStates() {
+            std::size_t states = 2;  // Raiz + estado após o símbolo de início
+            for (const auto& pattern : kPatterns) states += pattern.text.size();
+            return states;
+        }
+        inline constexpr std::size_t kMaxStates = CountStates();
+        static_assert(kMaxStates <= 256, "Estados do autômato precisam caber em uint8_t");
+
+        struct Automaton {
+            std::array<std::array<std::uint8_t, kAlphabetSize>, kMaxStates> next{};
+            std::array<TagMask, kMaxStates> output{};
+        };
+
+        constexpr Automaton Build() {
+            Automaton automaton;
+            std::size_t stateCount = 1;
+            auto step = [&](std::size_t state, std::size_t symbol) {
+                if (automaton.next[state][symbol] == 0) {
+                    automaton.next[state][symbol] = static_cast<std::uint8_t>(stateCount++);
+                }
+                return static_cast<std::size_t>(automaton.next[state][symbol]);
+            };
+
+            // 1. Trie dos padrões. Prefixos começam pelo símbolo de início, que só aparece na posição 0.
+            for (const auto& pattern : kPatterns) {
+                std::size_t state = pattern.prefix ? step(0, kStartSymbol) : 0;
+                for (const char c : pattern.text) state = step(state, kSymbols[static_cast<unsigned char>(c)]);
+                automaton.output[state] |= Bit(pattern.tag);
+            }
+
+            // 2. Links de falha em largura, já embutidos na tabela: toda transição ausente aponta para onde
+            //    o autômato iria a partir do link de falha, então a busca nunca volta atrás.
+            std::array<std::uint8_t, kMaxStates> fail{};
+            std::array<std::uint8_t, kMaxStates> queue{};
+            std::size_t head = 0, tail = 0;
+            for (std::size_t symbol = 0; symbol < kAlphabetSize; ++symbol) {
+                if (automaton.next[0][symbol] != 0) queue[tail++] = automaton.next[0][symbol];
+            }
+            while (head < tail) {
+                const std::size_t state = queue[head++];
+                for (std::size_t symbol = 0; symbol < kAlphabetSize; ++symbol) {
+                    const std::size_t child = automaton.next[state][symbol];
+                    if (child != 0) {
+                        fail[child] = automaton.next[fail[state]][symbol];
+                        automaton.output[child] |= automaton.output[fail[child]];
+                        queue[tail++] = static_cast<std::uint8_t>(child);
+                    } else {
+                        automaton.next[state][symbol] = automaton.next[fail[state]][symbol];
+                    }
+                }
+            }
+            return automaton;
+        }
+        inline constexpr Automaton kAutomaton = Build();
+    }
+
+    // Tags presentes no nome do arquivo (cada tag conta uma vez por arquivo). Aceita o nome nativo
+    // (wchar_t no Windows) direto, sem conversão; caracteres fora do ASCII caem em "qualquer outro".
+    template <class CharT>
+    constexpr TagMask Classify(std::basic_string_view<CharT> filename) {
+        const auto& automaton = detail::kAutomaton;
+        std::size_t state = automaton.next[0][detail::kStartSymbol];
+        TagMask mask = automaton.output[state];
+        for (const CharT c : filename) {
+            const auto code = static_cast<std::make_unsigned_t<CharT>>(c);
+            state = automaton.next[state][code < 256 ? detail::kSymbols[code] : detail::kOtherSymbol];
+            mask |= automaton.output[state];
+        }
+        // "unequip" contém "equip".
+        if (mask & Bit(AnimationTag::Unequip)) mask &= ~Bit(AnimationTag::Equip);
+        return mask;
+    }
+
+    constexpr TagMask Classify(std::string_view filename) { return Classify<char>(filename); }
+
+    template <class CharT>
+    void Accumulate(std::basic_string_view<CharT> filename, SubAnimationDef& tags) {
+        const TagMask mask = Classify(filename);
+        for (std::size_t tag = 0; tag < kAnimationTagCount; ++tag) {
+            // Satura em vez de dar a volta: um contador estourado viraria 0 e esconderia a tag.
+            auto& count = tags.tagCounts[tag];
+            if ((mask & (1u << tag)) && count != std::numeric_limits<std::uint32_t>::max()) ++count;
+        }
+    }
+
+    static_assert(Classify("BFCO_Attack1.hkx") == Bit(AnimationTag::Attack));
+    static_assert(Classify("bfco_powerattack2.HKX") == Bit(AnimationTag::PowerAttack));
+    static_assert(Classify("x_BFCO_Attack1.hkx") == 0);
+    static_assert(Classify("mco_SprintAttack.hkx") == Bit(AnimationTag::SprintAttack));
+    static_assert(Classify("1hm_Idle.hkx") == Bit(AnimationTag::Idle));
+    static_assert(Classify("1hm_unequip.hkx") == Bit(AnimationTag::Unequip));
+    static_assert(Classify("1hm_equip.hkx") == Bit(AnimationTag::Equip));
+    static_assert(Classify("BlockBash.hkx") == (Bit(AnimationTag::Block) | Bit(AnimationTag::Bash)));
+}
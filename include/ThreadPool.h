@@ -0,0 +1,60 @@
+﻿#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Diagnostics.h"
+
+// Pool de threads com roubo de tarefas (work-stealing).
+// Cada worker tem sua própria fila: consome do fim (LIFO, melhor localidade) e,
+// quando ela esvazia, rouba do início da fila dos outros workers.
+class ThreadPool {
+public:
+    // threadCount == 0 usa std::thread::hardware_concurrency().
+    explicit ThreadPool(std::size_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Enfileira uma tarefa. Se chamada de dentro de um worker deste pool, vai para a fila dele.
+    // A E/S da tarefa conta para a fase de diagnóstico ativa em quem a enfileirou.
+    void Submit(std::function<void()> task);
+
+    // Bloqueia até todas as tarefas enfileiradas terminarem. A thread que chama também executa tarefas.
+    void Wait();
+
+    std::size_t GetThreadCount() const { return _threads.size(); }
+
+private:
+    struct Task {
+        std::function<void()> run;
+        Diagnostics::ScopedPhase* phase = nullptr;
+    };
+
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool TryPopLocal(std::size_t index, Task& out);
+    bool TrySteal(std::size_t thief, Task& out);
+    void RunTask(Task& task);
+    void WorkerLoop(std::size_t index);
+
+    std::vector<std::unique_ptr<WorkerQueue>> _queues;
+    std::vector<std::thread> _threads;
+
+    std::atomic<std::size_t> _pending{0};  // Enfileiradas + em execução
+    std::atomic<std::size_t> _queued{0};   // Apenas enfileiradas
+    std::atomic<std::size_t> _nextQueue{0};
+
+    std::mutex _waitMutex;
+    std::condition_variable _workAvailable;
+    std::condition_variable _allDone;
+    bool _stopping = false;
+};
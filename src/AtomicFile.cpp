@@ -0,0 +1,176 @@
+﻿#include "AtomicFile.h"
+
+#include <algorithm>
+#include <format>
+#include <system_error>
+#include "Diagnostics.h"
+
+#ifdef _WIN32
+    #include <Windows.h>
+#else
+    #include <cerrno>
+    #include <cstdio>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+namespace {
+    std::string LastErrorMessage(std::string_view action) {
+#ifdef _WIN32
+        const int code = static_cast<int>(GetLastError());
+#else
+        const int code = errno;
+#endif
+        return std::format("Falha ao {}: {}", action, std::system_category().message(code));
+    }
+
+#ifndef _WIN32
+    // Um syncfs cobre o sistema de arquivos inteiro: um por lote em vez de um fsync por arquivo.
+    bool SyncFileSystemOf(const std::filesystem::path& directory) {
+        const int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0) return false;
+        const bool synced = syncfs(fd) == 0;
+        close(fd);
+        return synced;
+    }
+#endif
+}
+
+AtomicFileBatch::~AtomicFileBatch() {
+    for (auto& file : _staged) Discard(file);
+}
+
+bool AtomicFileBatch::Stage(const std::filesystem::path& target, std::string_view content, std::string& error) {
+    StagedFile file;
+    file.target = target;
+    file.temp = target;
+    file.temp += kTempSuffix;
+    const auto totalSize = content.size();
+    Diagnostics::CountFsCalls();
+
+#ifdef _WIN32
+    HANDLE handle = CreateFileW(file.temp.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL,
+                                nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        error = LastErrorMessage("criar o arquivo temporário");
+        return false;
+    }
+    while (!content.empty()) {
+        const auto chunk = static_cast<DWORD>(std::min<std::size_t>(content.size(), 1u << 30));
+        DWORD written = 0;
+        if (!WriteFile(handle, content.data(), chunk, &written, nullptr) || written == 0) {
+            error = LastErrorMessage("gravar o arquivo temporário");
+            CloseHandle(handle);
+            Discard(file);
+            return false;
+        }
+        content.remove_prefix(written);
+    }
+    CloseHandle(handle);
+#else
+    const int fd = open(file.temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        error = LastErrorMessage("criar o arquivo temporário");
+        return false;
+    }
+    while (!content.empty()) {
+        const auto written = write(fd, content.data(), content.size());
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) {
+            error = LastErrorMessage("gravar o arquivo temporário");
+            close(fd);
+            Discard(file);
+            return false;
+        }
+        content.remove_prefix(static_cast<std::size_t>(written));
+    }
+    close(fd);
+#endif
+    Diagnostics::CountWrite(totalSize);
+
+    std::lock_guard lock(_mutex);
+    _staged.push_back(std::move(file));
+    return true;
+}
+
+std::vector<std::pair<std::filesystem::path, std::string>> AtomicFileBatch::Commit() {
+    std::vector<StagedFile> staged;
+    {
+        std::lock_guard lock(_mutex);
+        staged.swap(_staged);
+    }
+    std::vector<std::pair<std::filesystem::path, std::string>> failures;
+    if (staged.empty()) return failures;
+
+    // 1. Conteúdo dos temporários no disco antes de qualquer troca. Sem isso, uma queda de energia logo
+    //    após o rename pode deixar o destino apontando para dados que nunca foram gravados.
+#ifdef _WIN32
+    for (auto& file : staged) {
+        Diagnostics::CountFsCalls();
+        // O FlushFileBuffers leva ao disco o cache do arquivo, não só o que passou por este handle.
+        HANDLE handle = CreateFileW(file.temp.c_str(), GENERIC_WRITE, 0, nullptr, OPEN_EXISTING,
+                                    FILE_ATTRIBUTE_NORMAL, nullptr);
+        const bool flushed = handle != INVALID_HANDLE_VALUE && FlushFileBuffers(handle);
+        if (!flushed) {
+            failures.emplace_back(file.target, LastErrorMessage("gravar o arquivo temporário no disco"));
+            if (handle != INVALID_HANDLE_VALUE) CloseHandle(handle);
+            Discard(file);
+            continue;
+        }
+        CloseHandle(handle);
+    }
+#else
+    Diagnostics::CountFsCalls();
+    if (!SyncFileSystemOf(staged.front().temp.parent_path())) {
+        sync();
+    }
+#endif
+
+    // 2. Troca atômica de cada destino pelo seu temporário.
+    for (auto& file : staged) {
+        if (file.temp.empty()) continue;  // Já descartado acima
+        Diagnostics::CountFsCalls();
+#ifdef _WIN32
+        const bool renamed = MoveFileExW(file.temp.c_str(), file.target.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+        const bool renamed = std::rename(file.temp.c_str(), file.target.c_str()) == 0;
+#endif
+        if (!renamed) {
+            failures.emplace_back(file.target, LastErrorMessage("substituir o arquivo"));
+            Discard(file);
+            continue;
+        }
+        file.temp.clear();
+    }
+
+    // 3. As trocas em si. O NTFS registra o rename no journal de metadados; no Linux, um segundo syncfs.
+#ifndef _WIN32
+    Diagnostics::CountFsCalls();
+    SyncFileSystemOf(staged.front().target.parent_path());
+#endif
+    return failures;
+}
+
+std::size_t AtomicFileBatch::GetStagedCount() const {
+    std::lock_guard lock(_mutex);
+    return _staged.size();
+}
+
+bool AtomicFileBatch::Write(const std::filesystem::path& target, std::string_view content, std::string& error) {
+    AtomicFileBatch batch;
+    if (!batch.Stage(target, content, error)) return false;
+    const auto failures = batch.Commit();
+    if (!failures.empty()) {
+        error = failures.front().second;
+        return false;
+    }
+    return true;
+}
+
+void AtomicFileBatch::Discard(StagedFile& file) {
+    if (!file.temp.empty()) {
+        std::error_code ec;
+        std::filesystem::remove(file.temp, ec);
+        file.temp.clear();
+    }
+}
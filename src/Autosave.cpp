@@ -0,0 +1,148 @@
+﻿#include "Autosave.h"
+
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include <utility>
+#include "AtomicFile.h"
+
+Autosave& Autosave::GetSingleton() {
+    // Nunca destruído: a thread pode estar dormindo quando o processo sai, e nada do Autosave pode depender da
+    // ordem de destruição dos estáticos.
+    static Autosave* singleton = new Autosave();
+    return *singleton;
+}
+
+void Autosave::Submit(std::filesystem::path path, std::string content) {
+    {
+        std::lock_guard lock(_mutex);
+        const bool wasEmpty = _pending.empty();
+        _failedAppends.erase(path);  // O arquivo inteiro vai ser regravado
+        _pending[std::move(path)] = PendingFile{std::move(content), false};
+        Touch(wasEmpty);
+    }
+    _wake.notify_one();
+}
+
+void Autosave::Append(const std::filesystem::path& path, std::string_view bytes) {
+    {
+        std::lock_guard lock(_mutex);
+        if (_failedAppends.contains(path)) return;  // Cairia depois de um registro cortado
+        const bool wasEmpty = _pending.empty();
+        auto [it, inserted] = _pending.try_emplace(path);
+        if (inserted) it->second.append = true;
+        it->second.content.append(bytes);
+        Touch(wasEmpty);
+    }
+    _wake.notify_one();
+}
+
+void Autosave::Touch(bool firstChange) {
+    const auto now = std::chrono::steady_clock::now();
+    if (firstChange) _firstChange = now;
+    _lastChange = now;
+    // A thread só existe depois da primeira edição.
+    if (!_thread.joinable()) _thread = std::thread(&Autosave::Run, this);
+}
+
+void Autosave::Flush() {
+    if (!HasPending()) return;
+    WritePending();
+}
+
+bool Autosave::HasPending() const {
+    std::lock_guard lock(_mutex);
+    return !_pending.empty();
+}
+
+bool Autosave::AppendFailed(const std::filesystem::path& path) const {
+    std::lock_guard lock(_mutex);
+    return _failedAppends.contains(path);
+}
+
+void Autosave::Run() {
+    std::unique_lock lock(_mutex);
+    while (true) {
+        if (_pending.empty()) {
+            _wake.wait(lock);
+            continue;
+        }
+        const auto deadline = std::max(std::min(_lastChange + kQuietPeriod, _firstChange + kMaxDelay), _retryAt);
+        if (std::chrono::steady_clock::now() < deadline) {
+            _wake.wait_until(lock, deadline);
+            continue;
+        }
+        lock.unlock();
+        WritePending();
+        lock.lock();
+    }
+}
+
+void Autosave::WritePending() {
+    std::lock_guard writeLock(_writeMutex);
+    std::map<std::filesystem::path, PendingFile> snapshot;
+    {
+        std::lock_guard lock(_mutex);
+        snapshot.swap(_pending);
+    }
+    if (snapshot.empty()) return;
+
+    AtomicFileBatch batch;
+    std::map<std::filesystem::path, std::string> failed;
+    std::set<std::filesystem::path> failedAppends;
+    for (const auto& [path, file] : snapshot) {
+        std::error_code ec;
+        std::filesystem::create_directories(path.parent_path(), ec);
+        if (file.append) continue;
+        std::string error;
+        if (!batch.Stage(path, file.content, error)) failed.emplace(path, std::move(error));
+    }
+    for (auto& [path, error] : batch.Commit()) failed.emplace(std::move(path), std::move(error));
+
+    // Acréscimos depois das trocas: um diário zerado na compactação já está no lugar quando os registros chegam.
+    for (const auto& [path, file] : snapshot) {
+        if (!file.append) continue;
+        std::ofstream stream(path, std::ios::binary | std::ios::app);
+        stream.write(file.content.data(), static_cast<std::streamsize>(file.content.size()));
+        stream.flush();
+        if (!stream) {
+            failed.emplace(path, "falha ao acrescentar ao arquivo");
+            failedAppends.insert(path);
+        }
+    }
+
+    for (const auto& [path, error] : failed) {
+        SKSE::log::error("Falha no salvamento automático de {}: {}", path.string(), error);
+    }
+    SKSE::log::info("Salvamento automático: {} de {} arquivos gravados.", snapshot.size() - failed.size(),
+                    snapshot.size());
+    if (failed.empty()) return;
+
+    std::lock_guard lock(_mutex);
+    // Um acréscimo que falhou pode ter gravado parte dos bytes: repeti-lo duplicaria registros. Ele não volta para
+    // a fila, e os acréscimos seguintes ao mesmo arquivo são descartados até que o dono o substitua inteiro
+    // (AppendFailed). Uma substituição que chegou no meio já resolve.
+    for (const auto& path : failedAppends) {
+        failed.erase(path);
+        const auto newer = _pending.find(path);
+        if (newer != _pending.end() && !newer->second.append) continue;
+        if (newer != _pending.end()) _pending.erase(newer);
+        _failedAppends.insert(path);
+    }
+    if (failed.empty()) return;
+
+    // O que falhou volta para a fila, na frente do que chegou depois. Uma substituição mais nova vence.
+    const auto now = std::chrono::steady_clock::now();
+    if (_pending.empty()) _firstChange = _lastChange = now;
+    _retryAt = now + kRetryDelay;
+    for (const auto& [path, error] : failed) {
+        auto& retry = snapshot[path];
+        const auto newer = _pending.find(path);
+        if (newer == _pending.end()) {
+            _pending.emplace(path, std::move(retry));
+        } else if (newer->second.append) {
+            retry.content += newer->second.content;
+            newer->second = std::move(retry);
+        }
+    }
+}
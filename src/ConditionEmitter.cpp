@@ -0,0 +1,271 @@
+﻿#include "ConditionEmitter.h"
+
+#include <algorithm>
+#include <format>
+#include "ManagedManifest.h"
+#include "StateKey.h"
+
+// ATUALIZADO: Apenas uma pequena modificação para garantir que o 'value' é tratado como double.
+void ConditionEmitter::AddCompareValuesCondition(rapidjson::Value& conditionsArray, const std::string& graphVarName,
+                                                 int value, rapidjson::Document::AllocatorType& allocator,
+                                                 const char* comparison) {
+    rapidjson::Value newCompare(rapidjson::kObjectType);
+    newCompare.AddMember("condition", "CompareValues", allocator);
+    newCompare.AddMember("requiredVersion", "1.0.0.0", allocator);
+    rapidjson::Value valueA(rapidjson::kObjectType);
+    valueA.AddMember("value", static_cast<double>(value), allocator);  // Garante que o valor é float/double no JSON
+    newCompare.AddMember("Value A", valueA, allocator);
+    newCompare.AddMember("Comparison", rapidjson::StringRef(comparison), allocator);
+    rapidjson::Value valueB(rapidjson::kObjectType);
+    valueB.AddMember("graphVariable", rapidjson::Value(graphVarName.c_str(), allocator), allocator);
+    valueB.AddMember("graphVariableType", "Float", allocator);
+    newCompare.AddMember("Value B", valueB, allocator);
+    conditionsArray.PushBack(newCompare, allocator);
+}
+
+void ConditionEmitter::AddNegatedCompareValuesCondition(rapidjson::Value& conditionsArray,
+                                                        const std::string& graphVarName, int value,
+                                                        rapidjson::Document::AllocatorType& allocator) {
+    rapidjson::Value newCompare(rapidjson::kObjectType);
+    newCompare.AddMember("condition", "CompareValues", allocator);
+
+    // ---> A ÚNICA DIFERENÇA ESTÁ AQUI <---
+    newCompare.AddMember("negated", true, allocator);
+
+    newCompare.AddMember("requiredVersion", "1.0.0.0", allocator);
+    rapidjson::Value valueA(rapidjson::kObjectType);
+    valueA.AddMember("value", static_cast<double>(value), allocator);
+    newCompare.AddMember("Value A", valueA, allocator);
+    newCompare.AddMember("Comparison", "==", allocator);
+    rapidjson::Value valueB(rapidjson::kObjectType);
+    valueB.AddMember("graphVariable", rapidjson::Value(graphVarName.c_str(), allocator), allocator);
+    valueB.AddMember("graphVariableType", "Float", allocator);
+    newCompare.AddMember("Value B", valueB, allocator);
+    conditionsArray.PushBack(newCompare, allocator);
+}
+
+void ConditionEmitter::AddRandomCondition(rapidjson::Value& conditionsArray, int value,
+                                          rapidjson::Document::AllocatorType& allocator) {
+    rapidjson::Value newRandom(rapidjson::kObjectType);
+    newRandom.AddMember("condition", "Random", allocator);
+    newRandom.AddMember("requiredVersion", "2.3.0.0", allocator);
+
+    rapidjson::Value state(rapidjson::kObjectType);
+    state.AddMember("scope", "Local", allocator);
+    state.AddMember("shouldResetOnLoopOrEcho", true, allocator);
+    newRandom.AddMember("State", state, allocator);
+
+    rapidjson::Value minVal(rapidjson::kObjectType);
+    minVal.AddMember("value", static_cast<double>(value), allocator);
+    newRandom.AddMember("Minimum random value", minVal, allocator);
+
+    rapidjson::Value maxVal(rapidjson::kObjectType);
+    maxVal.AddMember("value", static_cast<double>(value), allocator);
+    newRandom.AddMember("Maximum random value", maxVal, allocator);
+
+    newRandom.AddMember("Comparison", "==", allocator);
+
+    rapidjson::Value numVal(rapidjson::kObjectType);
+    numVal.AddMember("graphVariable", "CycleMovesetsRandom", allocator);
+    numVal.AddMember("graphVariableType", "Float", allocator);
+    newRandom.AddMember("Numeric value", numVal, allocator);
+
+    conditionsArray.PushBack(newRandom, allocator);
+}
+
+// Protótipos dos fragmentos, montados com as mesmas funções que a geração em DOM usava.
+ConditionEmitter::Templates ConditionEmitter::BuildTemplates(bool pretty) {
+    const int slot = static_cast<int>(ConditionTemplate::kSlot);
+
+    rapidjson::Document doc;
+    auto& allocator = doc.GetAllocator();
+    rapidjson::Value prototypes(rapidjson::kArrayType);
+    auto take = [&] {
+        auto result = ConditionTemplate::FromPrototype(prototypes[prototypes.Size() - 1], pretty);
+        prototypes.PopBack();
+        return result;
+    };
+
+    Templates templates;
+    {
+        rapidjson::Value actorBase(rapidjson::kObjectType);
+        actorBase.AddMember("condition", "IsActorBase", allocator);
+        rapidjson::Value actorBaseParams(rapidjson::kObjectType);
+        actorBaseParams.AddMember("pluginName", "Skyrim.esm", allocator);
+        actorBaseParams.AddMember("formID", "7", allocator);
+        actorBase.AddMember("Actor base", actorBaseParams, allocator);
+        prototypes.PushBack(actorBase, allocator);
+        templates.actorBase = take();
+    }
+    for (const bool leftHand : {false, true}) {
+        rapidjson::Value equippedType(rapidjson::kObjectType);
+        equippedType.AddMember("condition", "IsEquippedType", allocator);
+        rapidjson::Value typeVal(rapidjson::kObjectType);
+        typeVal.AddMember("value", ConditionTemplate::kSlot, allocator);
+        equippedType.AddMember("Type", typeVal, allocator);
+        equippedType.AddMember("Left hand", leftHand, allocator);
+        prototypes.PushBack(equippedType, allocator);
+        (leftHand ? templates.equippedLeft : templates.equippedRight) = take();
+    }
+    AddCompareValuesCondition(prototypes, "cycle_instance", slot, allocator);
+    templates.cycleInstance = take();
+    AddCompareValuesCondition(prototypes, "testarone", slot, allocator);
+    templates.playlistOrder = take();
+    AddNegatedCompareValuesCondition(prototypes, "DirecionalCycleMoveset", slot, allocator);
+    templates.negatedDirection = take();
+    AddRandomCondition(prototypes, slot, allocator);
+    templates.random = take();
+    AddCompareValuesCondition(prototypes, "DirecionalCycleMoveset", slot, allocator);
+    templates.direction = take();
+    AddCompareValuesCondition(prototypes, "CycleMovesetDisable", slot, allocator);
+    templates.killSwitch = take();
+    AddCompareValuesCondition(prototypes, StateKey::kGraphVariable, slot, allocator);
+    templates.stateEquals = take();
+    AddNegatedCompareValuesCondition(prototypes, StateKey::kGraphVariable, slot, allocator);
+    templates.stateNotEquals = take();
+    // Início <= chave e fim >= chave.
+    AddCompareValuesCondition(prototypes, StateKey::kGraphVariable, slot, allocator, "<=");
+    templates.stateAtLeast = take();
+    AddCompareValuesCondition(prototypes, StateKey::kGraphVariable, slot, allocator, ">=");
+    templates.stateAtMost = take();
+    return templates;
+}
+
+const ConditionEmitter::TemplateSet& ConditionEmitter::GetTemplates() {
+    static const TemplateSet templates{BuildTemplates(false), BuildTemplates(true)};
+    return templates;
+}
+
+namespace {
+    using ConditionIR::Kind;
+
+    // As folhas indentadas pegam a profundidade do próprio writer, então grupos podem se aninhar à vontade.
+    template <class Writer>
+    void WriteConditionNode(Writer& writer, const ConditionIR::Node& node, const ConditionEmitter::Templates& leaves,
+                            std::string& scratch) {
+        if (node.IsGroup()) {
+            writer.StartObject();
+            writer.Key("condition");
+            writer.String(node.kind == Kind::And ? "AND" : "OR");
+            writer.Key("Conditions");
+            writer.StartArray();
+            for (const auto& child : node.children) {
+                WriteConditionNode(writer, child, leaves, scratch);
+            }
+            writer.EndArray();
+            writer.EndObject();
+            return;
+        }
+
+        switch (node.kind) {
+            case Kind::ActorBase:
+                leaves.actorBase.Emit(writer, scratch);
+                break;
+            case Kind::EquippedRight:
+                leaves.equippedRight.Emit(writer, scratch, {node.value});
+                break;
+            case Kind::EquippedLeft:
+                leaves.equippedLeft.Emit(writer, scratch, {node.value});
+                break;
+            case Kind::CycleInstance:
+                leaves.cycleInstance.Emit(writer, scratch, {node.value});
+                break;
+            case Kind::PlaylistOrder:
+                leaves.playlistOrder.Emit(writer, scratch, {node.value});
+                break;
+            case Kind::NegatedDirection:
+                leaves.negatedDirection.Emit(writer, scratch, {node.value});
+                break;
+            case Kind::Random:
+                leaves.random.Emit(writer, scratch, {node.value, node.value});
+                break;
+            case Kind::Direction:
+                leaves.direction.Emit(writer, scratch, {node.value});
+                break;
+            case Kind::KillSwitch:
+                leaves.killSwitch.Emit(writer, scratch, {node.value});
+                break;
+            case Kind::StateEquals:
+                leaves.stateEquals.Emit(writer, scratch, {node.value});
+                break;
+            case Kind::StateNotEquals:
+                leaves.stateNotEquals.Emit(writer, scratch, {node.value});
+                break;
+            case Kind::StateAtLeast:
+                leaves.stateAtLeast.Emit(writer, scratch, {node.value});
+                break;
+            case Kind::StateAtMost:
+                leaves.stateAtMost.Emit(writer, scratch, {node.value});
+                break;
+            default:
+                break;
+        }
+    }
+
+    // A estrutura (OR, AND) sai pelas chamadas do writer; as condições folha saem prontas dos templates.
+    template <class Writer>
+    void WriteBlock(Writer& writer, const ConditionIR::Node& root, const ConditionEmitter::Templates& leaves,
+                    std::string& scratch) {
+        writer.StartObject();
+        writer.Key("condition");
+        writer.String("OR");
+        writer.Key("comment");
+        writer.String("OAR_CYCLE_MANAGER_CONDITIONS");
+        writer.Key("Conditions");
+        writer.StartArray();
+        for (const auto& child : root.children) {
+            WriteConditionNode(writer, child, leaves, scratch);
+        }
+        writer.EndArray();
+        writer.EndObject();
+    }
+}
+
+void ConditionEmitter::WriteManagedBlock(CompactWriter& writer, const ConditionIR::Node& root, std::string& scratch) {
+    WriteBlock(writer, root, GetTemplates().compact, scratch);
+}
+
+void ConditionEmitter::WriteManagedBlock(ConfigRewriter::OutputWriter& writer, const ConditionIR::Node& root,
+                                         std::string& scratch) {
+    WriteBlock(writer, root, GetTemplates().pretty, scratch);
+}
+
+std::uint64_t ConditionEmitter::HashManagedOutput(std::uint64_t blockHash, int priority, bool preserveConditions) {
+    std::uint64_t hash = Fnv1a64(std::to_string(priority), blockHash);
+    return Fnv1a64(preserveConditions ? "preserve" : "replace", hash);
+}
+
+bool ConditionEmitter::MatchesManagedOutput(const ConfigRewriter::ExistingConfig& existing, std::uint64_t outputHash,
+                                            bool preserveConditions) {
+    if (!existing.valid || !existing.priority || !existing.hasConditions || existing.managedBlocks > 1) return false;
+    for (std::size_t i = 0; i < existing.conditions.size(); ++i) {
+        const auto kind = existing.conditions[i];
+        if (kind == ConfigRewriter::ConditionKind::Managed) continue;
+        if (!(preserveConditions && i == 0 && kind == ConfigRewriter::ConditionKind::OldConditions)) return false;
+    }
+    return HashManagedOutput(existing.managedBlockHash, *existing.priority, preserveConditions) == outputHash;
+}
+
+std::string ConditionEmitter::CheckGeneratedOutput(std::string_view content,
+                                                   const ConfigRewriter::ExistingConfig& existing, int priority,
+                                                   bool hasManagedBlock, std::uint64_t outputHash,
+                                                   bool preserveConditions) {
+    using ConfigRewriter::ConditionKind;
+    const auto output = ConfigRewriter::ScanContent(content);
+    if (!output.valid) return "saída gerada não é um JSON válido: " + output.error;
+    if (output.priority != priority) return "saída gerada com prioridade diferente da pedida";
+    if (output.managedBlocks != (hasManagedBlock ? 1u : 0u)) {
+        return std::format("saída gerada com {} blocos gerenciados", output.managedBlocks);
+    }
+    const bool hadForeign = existing.valid && std::ranges::any_of(existing.conditions, [](ConditionKind kind) {
+        return kind != ConditionKind::Managed;
+    });
+    if (preserveConditions && hadForeign &&
+        (output.conditions.empty() || output.conditions.front() != ConditionKind::OldConditions)) {
+        return "condições de terceiros não foram preservadas";
+    }
+    if (!MatchesManagedOutput(output, outputHash, preserveConditions)) {
+        return "saída gerada não seria reconhecida como inalterada no próximo salvamento";
+    }
+    return {};
+}
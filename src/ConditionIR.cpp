@@ -0,0 +1,220 @@
+﻿#include "ConditionIR.h"
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include "Settings.h"
+#include "StateKey.h"
+
+namespace {
+    using ConditionIR::Kind;
+    using ConditionIR::Node;
+
+    Node Leaf(Kind kind, double value = 0.0) { return Node{kind, value, {}}; }
+    Node Group(Kind kind, std::vector<Node> children) { return Node{kind, 0.0, std::move(children)}; }
+
+    // Um AND sem filhos é sempre verdadeiro: é o que sobra de um ramo cujos termos foram todos fatorados.
+    bool IsTrue(const Node& node) { return node.kind == Kind::And && node.children.empty(); }
+
+    // Fatoração por prefixo: os ramos que começam pelo mesmo termo viram AND(termo, OR(restos)).
+    // A ordem de primeira aparição é mantida, então a avaliação continua na ordem em que os ramos foram escritos.
+    std::vector<Node> Factor(std::vector<std::vector<Node>> branches) {
+        std::vector<Node> alternatives;
+        std::vector<bool> taken(branches.size(), false);
+        for (std::size_t i = 0; i < branches.size(); ++i) {
+            if (taken[i]) continue;
+            if (branches[i].empty()) {
+                // Ramo vazio é verdadeiro e absorve todos os outros deste OR.
+                return {Group(Kind::And, {})};
+            }
+            std::vector<std::vector<Node>> rests;
+            for (std::size_t j = i; j < branches.size(); ++j) {
+                if (taken[j] || branches[j].empty() || !(branches[j].front() == branches[i].front())) continue;
+                taken[j] = true;
+                rests.emplace_back(std::make_move_iterator(branches[j].begin() + 1),
+                                   std::make_move_iterator(branches[j].end()));
+            }
+
+            Node head = branches[i].front();
+            if (rests.size() == 1) {
+                std::vector<Node> terms;
+                terms.push_back(std::move(head));
+                terms.insert(terms.end(), std::make_move_iterator(rests.front().begin()),
+                             std::make_move_iterator(rests.front().end()));
+                alternatives.push_back(Group(Kind::And, std::move(terms)));
+                continue;
+            }
+            auto rest = Factor(std::move(rests));
+            std::vector<Node> terms;
+            terms.push_back(std::move(head));
+            if (rest.size() == 1) {
+                terms.push_back(std::move(rest.front()));
+            } else {
+                terms.push_back(Group(Kind::Or, std::move(rest)));
+            }
+            alternatives.push_back(Group(Kind::And, std::move(terms)));
+        }
+        return alternatives;
+    }
+
+    // Achata AND dentro de AND e OR dentro de OR (é assim que os conjuntos de direções se juntam), remove
+    // filhos repetidos e desfaz grupos de um filho só.
+    Node Simplify(Node node) {
+        if (!node.IsGroup()) return node;
+        std::vector<Node> children;
+        for (auto& child : node.children) {
+            auto simplified = Simplify(std::move(child));
+            if (IsTrue(simplified)) {
+                if (node.kind == Kind::Or) return Group(Kind::And, {});  // OR com um ramo verdadeiro
+                continue;                                                 // AND ignora o termo verdadeiro
+            }
+            if (simplified.kind == node.kind) {
+                for (auto& grandChild : simplified.children) {
+                    if (std::ranges::find(children, grandChild) == children.end()) {
+                        children.push_back(std::move(grandChild));
+                    }
+                }
+            } else if (std::ranges::find(children, simplified) == children.end()) {
+                children.push_back(std::move(simplified));
+            }
+        }
+        if (children.size() == 1) return std::move(children.front());
+        node.children = std::move(children);
+        return node;
+    }
+}
+
+bool ConditionIR::Node::operator==(const Node& other) const {
+    return kind == other.kind && value == other.value && children == other.children;
+}
+
+ConditionIR::Node ConditionIR::BuildTree(const std::vector<FileSaveConfig>& configs, bool packedStateKey) {
+    Node root = Group(Kind::Or, {});
+
+    // Se a lista de configs ESTIVER VAZIA, geramos uma condição "kill switch".
+    // Assumindo que a variável "CycleMovesetDisable" nunca será 1.0 no seu behavior graph.
+    if (configs.empty()) {
+        root.children.push_back(Group(Kind::And, {Leaf(Kind::KillSwitch, 1.0)}));
+        return root;
+    }
+
+    // Mapear todas as direções usadas pelas "filhas" para cada "mãe" (playlist).
+    // A chave do mapa é o 'order_in_playlist', o valor é um set com os números das direções.
+    std::map<int, std::set<int>> childDirectionsByPlaylist;
+    for (const auto& config : configs) {
+        if (config.isParent || config.order_in_playlist <= 0) continue;
+        const bool directions[] = {config.pFront, config.pFrontRight, config.pRight, config.pBackRight,
+                                   config.pBack,  config.pBackLeft,   config.pLeft,  config.pFrontLeft};
+        for (int dirValue = 1; dirValue <= 8; ++dirValue) {
+            if (directions[dirValue - 1]) childDirectionsByPlaylist[config.order_in_playlist].insert(dirValue);
+        }
+    }
+
+    for (const auto& config : configs) {
+        // Apenas configurações com posição na playlist geram um bloco
+        if (config.order_in_playlist <= 0) continue;
+        const double order = config.order_in_playlist;
+
+        Node branch = Group(Kind::And, {});
+        auto& terms = branch.children;
+        terms.push_back(Leaf(Kind::ActorBase));
+        terms.push_back(Leaf(Kind::EquippedRight, config.category->equippedTypeValue));
+        if (config.category->isDualWield) {
+            terms.push_back(Leaf(Kind::EquippedLeft, config.category->equippedTypeValue));
+        }
+        const bool directions[] = {config.pFront, config.pFrontRight, config.pRight, config.pBackRight,
+                                   config.pBack,  config.pBackLeft,   config.pLeft,  config.pFrontLeft};
+        const auto childDirs = childDirectionsByPlaylist.find(config.order_in_playlist);
+
+        if (packedStateKey && StateKey::CanPack(config.instance_index, config.order_in_playlist)) {
+            // Instância, ordem e direção numa comparação só: a faixa cobre todas as direções desta posição.
+            auto key = [&](int direction) {
+                return static_cast<double>(
+                    StateKey::Pack(config.instance_index, config.order_in_playlist, direction));
+            };
+            auto addRange = [&] {
+                terms.push_back(Leaf(Kind::StateAtLeast, key(0)));
+                terms.push_back(Leaf(Kind::StateAtMost, key(StateKey::kMaxDirection)));
+            };
+            if (config.isParent) {
+                addRange();
+                if (childDirs != childDirectionsByPlaylist.end()) {
+                    for (int dirValue : childDirs->second) terms.push_back(Leaf(Kind::StateNotEquals, key(dirValue)));
+                }
+            } else {
+                if (config.pRandom) {
+                    terms.push_back(Leaf(Kind::Random, order));
+                }
+                Node directional = Group(Kind::Or, {});
+                for (int dirValue = 1; dirValue <= 8; ++dirValue) {
+                    if (!directions[dirValue - 1]) continue;
+                    directional.children.push_back(Leaf(Kind::StateEquals, key(dirValue)));
+                }
+                if (directional.children.empty()) {
+                    addRange();
+                } else {
+                    terms.push_back(std::move(directional));
+                }
+            }
+            root.children.push_back(std::move(branch));
+            continue;
+        }
+
+        terms.push_back(Leaf(Kind::CycleInstance, static_cast<double>(config.instance_index)));
+        terms.push_back(Leaf(Kind::PlaylistOrder, order));
+
+        if (config.isParent) {
+            // LÓGICA DA MÃE: Adicionar condições negadas para cada direção de filha.
+            if (childDirs != childDirectionsByPlaylist.end()) {
+                for (int dirValue : childDirs->second) {
+                    terms.push_back(Leaf(Kind::NegatedDirection, static_cast<double>(dirValue)));
+                }
+            }
+        } else {
+            if (config.pRandom) {
+                terms.push_back(Leaf(Kind::Random, order));
+            }
+            // Condições direcionais num bloco OR, independentemente da condição Random.
+            Node directional = Group(Kind::Or, {});
+            for (int dirValue = 1; dirValue <= 8; ++dirValue) {
+                if (directions[dirValue - 1]) directional.children.push_back(Leaf(Kind::Direction, dirValue));
+            }
+            if (!directional.children.empty()) terms.push_back(std::move(directional));
+        }
+        root.children.push_back(std::move(branch));
+    }
+    return root;
+}
+
+ConditionIR::Node ConditionIR::Optimize(const Node& root) {
+    std::vector<std::vector<Node>> branches;
+    branches.reserve(root.children.size());
+    for (const auto& child : root.children) {
+        branches.push_back(child.kind == Kind::And ? child.children : std::vector<Node>{child});
+    }
+
+    // A raiz carrega o comentário do manager e nunca é desfeita. Os filhos dela continuam sendo grupos AND,
+    // como na árvore original; uma folha solta vira um AND de um termo.
+    Node result = Group(Kind::Or, {});
+    auto addBranch = [&](Node branch) {
+        if (!branch.IsGroup()) branch = Group(Kind::And, {std::move(branch)});
+        if (std::ranges::find(result.children, branch) == result.children.end()) {
+            result.children.push_back(std::move(branch));
+        }
+    };
+    for (auto& alternative : Factor(std::move(branches))) {
+        auto simplified = Simplify(std::move(alternative));
+        if (simplified.kind == Kind::Or) {
+            for (auto& grandChild : simplified.children) addBranch(std::move(grandChild));
+        } else {
+            addBranch(std::move(simplified));
+        }
+    }
+    return result;
+}
+
+std::size_t ConditionIR::CountNodes(const Node& node) {
+    std::size_t count = 1;
+    for (const auto& child : node.children) count += CountNodes(child);
+    return count;
+}
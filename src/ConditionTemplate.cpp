@@ -0,0 +1,70 @@
+﻿#include "ConditionTemplate.h"
+
+#include <string_view>
+#include "rapidjson/internal/dtoa.h"
+#include "rapidjson/prettywriter.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+namespace {
+    // Mesma formatação do Writer::Double do rapidjson, para a saída ser idêntica à do DOM.
+    std::string_view FormatDouble(double value, char (&buffer)[32]) {
+        const char* end = rapidjson::internal::dtoa(value, buffer);
+        return std::string_view(buffer, static_cast<std::size_t>(end - buffer));
+    }
+
+    // Copia um trecho indentado com um espaço por nível, trocando o recuo de cada linha pelo do writer.
+    // Strings são escapadas pelo rapidjson, então toda quebra de linha do trecho é de formatação.
+    void AppendIndented(std::string& out, std::string_view text, const ConditionTemplate::Indent& indent) {
+        for (auto newline = text.find('\n'); newline != std::string_view::npos; newline = text.find('\n')) {
+            out += text.substr(0, newline + 1);
+            text.remove_prefix(newline + 1);
+            std::size_t level = 0;
+            while (level < text.size() && text[level] == ' ') ++level;
+            text.remove_prefix(level);
+            out.append((indent.nesting + level) * indent.count, indent.character);
+        }
+        out += text;
+    }
+}
+
+ConditionTemplate ConditionTemplate::FromPrototype(const rapidjson::Value& prototype, bool pretty) {
+    rapidjson::StringBuffer buffer;
+    if (pretty) {
+        // Um espaço por nível: o recuo real sai do writer onde o fragmento é emitido.
+        rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+        writer.SetIndent(' ', 1);
+        prototype.Accept(writer);
+    } else {
+        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+        prototype.Accept(writer);
+    }
+    std::string_view text(buffer.GetString(), buffer.GetSize());
+
+    char sentinelBuffer[32];
+    const auto sentinel = FormatDouble(kSlot, sentinelBuffer);
+    ConditionTemplate result;
+    result._pretty = pretty;
+    for (auto slot = text.find(sentinel); slot != std::string_view::npos; slot = text.find(sentinel)) {
+        result._literals.emplace_back(text.substr(0, slot));
+        text.remove_prefix(slot + sentinel.size());
+    }
+    result._literals.emplace_back(text);
+    return result;
+}
+
+void ConditionTemplate::Render(std::string& out, std::initializer_list<double> values, const Indent& indent) const {
+    out.clear();
+    auto value = values.begin();
+    for (std::size_t i = 0; i < _literals.size(); ++i) {
+        if (_pretty) {
+            AppendIndented(out, _literals[i], indent);
+        } else {
+            out += _literals[i];
+        }
+        if (i + 1 < _literals.size()) {
+            char numberBuffer[32];
+            out += FormatDouble(value != values.end() ? *value++ : 0.0, numberBuffer);
+        }
+    }
+}
@@ -0,0 +1,423 @@
+﻿#include "ConfigRewriter.h"
+
+#include <climits>
+#include <cstdio>
+#include <format>
+#include <string_view>
+#include <utility>
+#include "Diagnostics.h"
+#include "ManagedManifest.h"
+#include "rapidjson/error/en.h"
+#include "rapidjson/filereadstream.h"
+#include "rapidjson/memorystream.h"
+#include "rapidjson/reader.h"
+#include "rapidjson/writer.h"
+
+namespace {
+    constexpr std::string_view kManagedComment = "OAR_CYCLE_MANAGER_CONDITIONS";
+    constexpr std::string_view kOldConditionsComment = "Old Conditions";
+    // Parse iterativo: a profundidade do arquivo não vira profundidade de pilha, nem num config.json malformado.
+    constexpr unsigned kParseFlags = rapidjson::kParseIterativeFlag;
+
+    // Stream de saída do rapidjson que só acumula o Fnv1a64 dos bytes, sem guardá-los.
+    struct HashStream {
+        using Ch = char;
+        void Put(char c) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ull;
+        }
+        void Flush() {}
+        std::uint64_t hash = Fnv1a64({});
+    };
+
+    // Lê o arquivo inteiro pelo handler, com um buffer fixo.
+    template <class Handler>
+    rapidjson::ParseResult ParseFile(const std::filesystem::path& path, Handler& handler, std::uint64_t& bytesRead,
+                                     bool& opened) {
+        FILE* fp = nullptr;
+        fopen_s(&fp, path.string().c_str(), "rb");
+        opened = fp != nullptr;
+        if (!fp) return rapidjson::ParseResult(rapidjson::kParseErrorDocumentEmpty, 0);
+        char readBuffer[16384];
+        rapidjson::FileReadStream input(fp, readBuffer, sizeof(readBuffer));
+        rapidjson::Reader reader;
+        const auto result = reader.Parse<kParseFlags>(input, handler);
+        bytesRead = input.Tell();
+        fclose(fp);
+        Diagnostics::CountRead(bytesRead);
+        return result;
+    }
+
+    // Primeira passada. Marca o tipo de cada condição de topo pelo primeiro "comment" dela e passa cada
+    // uma por um Writer compacto sobre o HashStream, para ter o hash do bloco gerenciado sem copiá-lo.
+    class ScanHandler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, ScanHandler> {
+    public:
+        explicit ScanHandler(ConfigRewriter::ExistingConfig& config) : _config(config), _hashWriter(_hashStream) {}
+
+        bool Null() { return Scalar([&] { _hashWriter.Null(); }); }
+        bool Bool(bool b) { return Scalar([&] { _hashWriter.Bool(b); }); }
+        bool Int(int i) {
+            if (_pending == Pending::Priority) _config.priority = i;
+            return Scalar([&] { _hashWriter.Int(i); });
+        }
+        bool Uint(unsigned u) {
+            if (_pending == Pending::Priority && u <= INT_MAX) _config.priority = static_cast<int>(u);
+            return Scalar([&] { _hashWriter.Uint(u); });
+        }
+        bool Int64(std::int64_t i) { return Scalar([&] { _hashWriter.Int64(i); }); }
+        bool Uint64(std::uint64_t u) { return Scalar([&] { _hashWriter.Uint64(u); }); }
+        bool Double(double d) { return Scalar([&] { _hashWriter.Double(d); }); }
+        bool String(const char* str, rapidjson::SizeType length, bool copy) {
+            if (_pending == Pending::Comment) {
+                const std::string_view comment(str, length);
+                if (comment == kManagedComment) {
+                    _kind = ConfigRewriter::ConditionKind::Managed;
+                } else if (comment == kOldConditionsComment) {
+                    _kind = ConfigRewriter::ConditionKind::OldConditions;
+                }
+            }
+            return Scalar([&] { _hashWriter.String(str, length, copy); });
+        }
+        bool Key(const char* str, rapidjson::SizeType length, bool copy) {
+            const std::string_view key(str, length);
+            if (_depth == 1) {
+                if (key == "priority" && !_prioritySeen) {
+                    _prioritySeen = true;
+                    _pending = Pending::Priority;
+                } else if (key == "conditions" && !_conditionsSeen) {
+                    _conditionsSeen = true;
+                    _pending = Pending::Conditions;
+                }
+            } else if (_inElement && _depth == _conditionsDepth + 1 && key == "comment" && !_commentSeen) {
+                _commentSeen = true;
+                _pending = Pending::Comment;
+            }
+            if (_inElement) _hashWriter.Key(str, length, copy);
+            return true;
+        }
+        bool StartObject() {
+            if (_depth == 0) _rootIsObject = true;
+            BeginValue();
+            if (_inElement) _hashWriter.StartObject();
+            _depth++;
+            return true;
+        }
+        bool StartArray() {
+            if (_depth == 0) return false;  // A raiz precisa ser um objeto
+            const bool isConditions = _pending == Pending::Conditions;
+            BeginValue();
+            if (_inElement) _hashWriter.StartArray();
+            _depth++;
+            if (isConditions) {
+                _conditionsDepth = _depth;
+                _config.hasConditions = true;
+            }
+            return true;
+        }
+        bool EndObject(rapidjson::SizeType) {
+            _depth--;
+            if (_inElement) _hashWriter.EndObject();
+            EndValue();
+            return true;
+        }
+        bool EndArray(rapidjson::SizeType) {
+            if (_depth == _conditionsDepth) _conditionsDepth = 0;
+            _depth--;
+            if (_inElement) _hashWriter.EndArray();
+            EndValue();
+            return true;
+        }
+
+        bool RootIsObject() const { return _rootIsObject; }
+
+    private:
+        enum class Pending { None, Priority, Conditions, Comment };
+
+        // Início de qualquer valor: abre um elemento de "conditions" se estiver no nível dele.
+        void BeginValue() {
+            _pending = Pending::None;
+            if (!_inElement && _conditionsDepth != 0 && _depth == _conditionsDepth) {
+                _inElement = true;
+                _commentSeen = false;
+                _kind = ConfigRewriter::ConditionKind::Foreign;
+                _hashStream = HashStream();
+                _hashWriter.Reset(_hashStream);
+            }
+        }
+        // Fim de qualquer valor: fecha o elemento se voltou ao nível do array.
+        void EndValue() {
+            if (!_inElement || _depth != _conditionsDepth) return;
+            _inElement = false;
+            _config.conditions.push_back(_kind);
+            if (_kind == ConfigRewriter::ConditionKind::Managed && _config.managedBlocks++ == 0) {
+                _config.managedBlockHash = _hashStream.hash;
+            }
+        }
+        template <class Write>
+        bool Scalar(Write write) {
+            BeginValue();
+            if (_inElement) write();
+            EndValue();
+            return true;
+        }
+
+        ConfigRewriter::ExistingConfig& _config;
+        HashStream _hashStream;
+        rapidjson::Writer<HashStream> _hashWriter;
+        int _depth = 0;
+        int _conditionsDepth = 0;  // Profundidade dentro do array "conditions" da raiz; 0 fora dele
+        Pending _pending = Pending::None;
+        bool _rootIsObject = false;
+        bool _prioritySeen = false;
+        bool _conditionsSeen = false;
+        bool _inElement = false;
+        bool _commentSeen = false;
+        ConfigRewriter::ConditionKind _kind = ConfigRewriter::ConditionKind::Foreign;
+    };
+
+    // Segunda passada. Copia os eventos para o PrettyWriter, trocando a prioridade, descartando o bloco
+    // gerenciado antigo (e as condições de terceiros, se não forem preservadas) e abrindo o bloco
+    // "Old Conditions" antes da primeira condição de terceiros.
+    class RewriteHandler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, RewriteHandler> {
+    public:
+        RewriteHandler(ConfigRewriter::OutputWriter& writer, const ConfigRewriter::ExistingConfig& existing,
+                       int priority, bool preserveConditions, const ConfigRewriter::BlockWriter& writeManagedBlock)
+            : _writer(writer),
+              _existing(existing),
+              _priority(priority),
+              _preserveConditions(preserveConditions),
+              _writeManagedBlock(writeManagedBlock) {}
+
+        bool Null() { return Scalar([&] { return _writer.Null(); }); }
+        bool Bool(bool b) { return Scalar([&] { return _writer.Bool(b); }); }
+        bool Int(int i) { return Scalar([&] { return _writer.Int(i); }); }
+        bool Uint(unsigned u) { return Scalar([&] { return _writer.Uint(u); }); }
+        bool Int64(std::int64_t i) { return Scalar([&] { return _writer.Int64(i); }); }
+        bool Uint64(std::uint64_t u) { return Scalar([&] { return _writer.Uint64(u); }); }
+        bool Double(double d) { return Scalar([&] { return _writer.Double(d); }); }
+        bool String(const char* str, rapidjson::SizeType length, bool copy) {
+            return Scalar([&] { return _writer.String(str, length, copy); });
+        }
+        bool Key(const char* str, rapidjson::SizeType length, bool copy) {
+            if (_skipDepth > 0) return true;
+            if (_depth == 1) {
+                const std::string_view key(str, length);
+                if (key == "priority" && !_priorityWritten) {
+                    _writer.Key(str, length, copy);
+                    _writer.Int(_priority);
+                    _priorityWritten = true;
+                    _next = Next::Skip;  // O valor antigo é descartado
+                    return true;
+                }
+                if (key == "conditions" && !_conditionsWritten) {
+                    _writer.Key(str, length, copy);
+                    _conditionsWritten = true;
+                    _next = Next::Conditions;
+                    return true;
+                }
+            }
+            return _writer.Key(str, length, copy);
+        }
+        bool StartObject() {
+            if (!BeginValue(true, false)) return true;
+            _depth++;
+            return _writer.StartObject();
+        }
+        bool StartArray() {
+            const bool isConditions = _next == Next::Conditions;
+            if (!BeginValue(true, true)) return true;
+            _depth++;
+            if (isConditions) {
+                _conditionsDepth = _depth;
+                _conditionIndex = 0;
+            }
+            return _writer.StartArray();
+        }
+        bool EndObject(rapidjson::SizeType) {
+            if (_skipDepth > 0) {
+                _skipDepth--;
+                return true;
+            }
+            if (_depth == 1) {
+                // Membros que o arquivo não tinha entram no fim, como o AddMember fazia.
+                if (!_priorityWritten) {
+                    _writer.Key("priority");
+                    _writer.Int(_priority);
+                }
+                if (!_conditionsWritten) {
+                    _writer.Key("conditions");
+                    WriteConditionsArray();
+                }
+            }
+            _depth--;
+            return _writer.EndObject();
+        }
+        bool EndArray(rapidjson::SizeType) {
+            if (_skipDepth > 0) {
+                _skipDepth--;
+                return true;
+            }
+            if (_depth == _conditionsDepth) {
+                if (_oldConditionsOpen) {
+                    _writer.EndArray();
+                    _writer.EndObject();
+                }
+                if (_writeManagedBlock) _writeManagedBlock(_writer);
+                _conditionsDepth = 0;
+            }
+            _depth--;
+            return _writer.EndArray();
+        }
+
+    private:
+        enum class Next { Normal, Skip, Conditions };
+
+        void WriteConditionsArray() {
+            _writer.StartArray();
+            if (_writeManagedBlock) _writeManagedBlock(_writer);
+            _writer.EndArray();
+        }
+
+        // Decide o destino do valor que começa agora. false: o valor é descartado (e, se for um contêiner,
+        // tudo dentro dele até o fechamento correspondente).
+        bool BeginValue(bool container, bool isArray) {
+            if (_skipDepth > 0) {
+                if (container) _skipDepth++;
+                return false;
+            }
+            const Next next = std::exchange(_next, Next::Normal);
+            bool keep = true;
+            if (next == Next::Skip) {
+                keep = false;
+            } else if (next == Next::Conditions && !isArray) {
+                // "conditions" que não é array: vira um array só com o nosso bloco.
+                WriteConditionsArray();
+                keep = false;
+            } else if (_conditionsDepth != 0 && _depth == _conditionsDepth) {
+                const auto kind = _conditionIndex < _existing.conditions.size()
+                                      ? _existing.conditions[_conditionIndex]
+                                      : ConfigRewriter::ConditionKind::Foreign;
+                _conditionIndex++;
+                if (kind == ConfigRewriter::ConditionKind::Managed || !_preserveConditions) {
+                    keep = false;
+                } else if (!_oldConditionsOpen) {
+                    _writer.StartObject();
+                    _writer.Key("condition");
+                    _writer.String("OR");
+                    _writer.Key("comment");
+                    _writer.String("Old Conditions");
+                    _writer.Key("Conditions");
+                    _writer.StartArray();
+                    _oldConditionsOpen = true;
+                }
+            }
+            if (!keep && container) _skipDepth = 1;
+            return keep;
+        }
+        template <class Write>
+        bool Scalar(Write write) {
+            if (!BeginValue(false, false)) return true;
+            return write();
+        }
+
+        ConfigRewriter::OutputWriter& _writer;
+        const ConfigRewriter::ExistingConfig& _existing;
+        int _priority;
+        bool _preserveConditions;
+        const ConfigRewriter::BlockWriter& _writeManagedBlock;
+
+        int _depth = 0;
+        int _skipDepth = 0;        // Contêineres abertos dentro de um valor descartado
+        int _conditionsDepth = 0;  // Profundidade dentro do array "conditions" da raiz; 0 fora dele
+        std::size_t _conditionIndex = 0;
+        Next _next = Next::Normal;
+        bool _priorityWritten = false;
+        bool _conditionsWritten = false;
+        bool _oldConditionsOpen = false;
+    };
+
+    // O que Scan e ScanContent fazem depois do parse: erro, validade e descarte do que não vale.
+    void FinishScan(ConfigRewriter::ExistingConfig& config, const ScanHandler& handler,
+                    const rapidjson::ParseResult& result) {
+        // kParseErrorTermination vem do próprio handler (raiz que não é objeto): o arquivo é só substituído.
+        if (result.IsError() && result.Code() != rapidjson::kParseErrorTermination) {
+            config.error = std::format("JSON inválido ({}, posição {})", rapidjson::GetParseError_En(result.Code()),
+                                       result.Offset());
+        }
+        config.valid = !result.IsError() && handler.RootIsObject();
+        if (!config.valid) {
+            // Raiz que não é objeto (ou arquivo quebrado): nada do que foi visto vale.
+            config.priority.reset();
+            config.hasConditions = false;
+            config.conditions.clear();
+            config.managedBlocks = 0;
+            config.managedBlockHash = Fnv1a64("null");
+        }
+    }
+}
+
+ConfigRewriter::ExistingConfig ConfigRewriter::Scan(const std::filesystem::path& path) {
+    ExistingConfig config;
+    config.managedBlockHash = Fnv1a64("null");  // Mesmo hash de um arquivo sem bloco gerenciado
+    ScanHandler handler(config);
+    const auto result = ParseFile(path, handler, config.bytesRead, config.exists);
+    if (!config.exists) return config;
+    FinishScan(config, handler, result);
+    return config;
+}
+
+ConfigRewriter::ExistingConfig ConfigRewriter::ScanContent(std::string_view content) {
+    ExistingConfig config;
+    config.managedBlockHash = Fnv1a64("null");
+    config.exists = true;
+    ScanHandler handler(config);
+    rapidjson::MemoryStream input(content.data(), content.size());
+    rapidjson::Reader reader;
+    const auto result = reader.Parse<kParseFlags>(input, handler);
+    config.bytesRead = input.Tell();
+    FinishScan(config, handler, result);
+    return config;
+}
+
+bool ConfigRewriter::Rewrite(const std::filesystem::path& path, const ExistingConfig& existing, int priority,
+                             bool preserveConditions, const BlockWriter& writeManagedBlock,
+                             rapidjson::StringBuffer& out, std::string& error) {
+    OutputWriter writer(out);
+    RewriteHandler handler(writer, existing, priority, preserveConditions, writeManagedBlock);
+    if (!existing.valid) {
+        // Documento novo: os mesmos eventos de um objeto vazio.
+        handler.StartObject();
+        handler.EndObject(0);
+        return true;
+    }
+
+    std::uint64_t bytesRead = 0;
+    bool opened = false;
+    const auto result = ParseFile(path, handler, bytesRead, opened);
+    if (!opened || result.IsError()) {
+        // O arquivo mudou entre as duas passadas. Melhor não escrever nada do que escrever pela metade.
+        error = "O arquivo mudou durante o salvamento.";
+        return false;
+    }
+    return true;
+}
+
+bool ConfigRewriter::RewriteContent(std::string_view content, const ExistingConfig& existing, int priority,
+                                    bool preserveConditions, const BlockWriter& writeManagedBlock,
+                                    rapidjson::StringBuffer& out, std::string& error) {
+    OutputWriter writer(out);
+    RewriteHandler handler(writer, existing, priority, preserveConditions, writeManagedBlock);
+    if (!existing.valid) {
+        handler.StartObject();
+        handler.EndObject(0);
+        return true;
+    }
+
+    rapidjson::MemoryStream input(content.data(), content.size());
+    rapidjson::Reader reader;
+    if (reader.Parse<kParseFlags>(input, handler).IsError()) {
+        error = "O conteúdo não é o mesmo da primeira passada.";
+        return false;
+    }
+    return true;
+}
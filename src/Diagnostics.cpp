@@ -0,0 +1,143 @@
+﻿#include "Diagnostics.h"
+
+#include <mutex>
+
+#ifdef _WIN32
+    #include <Windows.h>
+    #include <Psapi.h>
+#elif defined(__linux__)
+    #include <sys/resource.h>
+    #include <unistd.h>
+    #include <fstream>
+#endif
+
+namespace {
+    thread_local Diagnostics::ScopedPhase* t_activePhase = nullptr;
+
+    // As fases rodam em threads diferentes (escaneamento em segundo plano, UI, watcher).
+    std::mutex g_reportsMutex;
+    std::array<Diagnostics::PhaseReport, Diagnostics::kPhaseCount> g_reports;
+}
+
+const char* Diagnostics::PhaseName(Phase phase) {
+    switch (phase) {
+        case Phase::LibraryScan:
+            return "Escaneamento da biblioteca";
+        case Phase::ManagedFiles:
+            return "Arquivos gerenciados";
+        case Phase::ConditionGeneration:
+            return "Geração de condições";
+        case Phase::StanceLoad:
+            return "Carregar stances";
+        case Phase::StanceSave:
+            return "Salvar stances";
+        default:
+            return "?";
+    }
+}
+
+void Diagnostics::CountFsCalls(std::uint64_t calls) {
+    for (auto* phase = t_activePhase; phase; phase = phase->_parent) phase->_fsCalls += calls;
+}
+
+void Diagnostics::CountRead(std::uint64_t bytes, std::uint64_t files) {
+    for (auto* phase = t_activePhase; phase; phase = phase->_parent) {
+        phase->_fsCalls += files;
+        phase->_filesRead += files;
+        phase->_bytesRead += bytes;
+    }
+}
+
+void Diagnostics::CountWrite(std::uint64_t bytes, std::uint64_t files) {
+    for (auto* phase = t_activePhase; phase; phase = phase->_parent) {
+        phase->_fsCalls += files;
+        phase->_filesWritten += files;
+        phase->_bytesWritten += bytes;
+    }
+}
+
+std::uint64_t Diagnostics::CurrentWorkingSet() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS memoryCounters{};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &memoryCounters, sizeof(memoryCounters))) {
+        return memoryCounters.WorkingSetSize;
+    }
+    return 0;
+#elif defined(__linux__)
+    std::ifstream statm("/proc/self/statm");
+    std::uint64_t totalPages = 0, residentPages = 0;
+    if (statm >> totalPages >> residentPages) return residentPages * static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+    return 0;
+#else
+    return 0;
+#endif
+}
+
+std::uint64_t Diagnostics::PeakWorkingSet() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS memoryCounters{};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &memoryCounters, sizeof(memoryCounters))) {
+        return memoryCounters.PeakWorkingSetSize;
+    }
+    return 0;
+#elif defined(__linux__)
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) == 0) return static_cast<std::uint64_t>(usage.ru_maxrss) * 1024;
+    return 0;
+#else
+    return 0;
+#endif
+}
+
+Diagnostics::PhaseReport Diagnostics::GetReport(Phase phase) {
+    std::lock_guard lock(g_reportsMutex);
+    return g_reports[static_cast<std::size_t>(phase)];
+}
+
+void Diagnostics::LogReport() {
+    for (std::size_t i = 0; i < kPhaseCount; ++i) {
+        const auto phase = static_cast<Phase>(i);
+        const auto report = GetReport(phase);
+        if (report.runs == 0) continue;
+        SKSE::log::info(
+            "[Diagnóstico] {}: {:.1f} ms, {} chamadas ao disco, {} arquivos/{} bytes lidos, {} arquivos/{} bytes "
+            "escritos, memória {:+} KB (pico {} MB), {} execuções.",
+            PhaseName(phase), report.wallMs, report.fsCalls, report.filesRead, report.bytesRead, report.filesWritten,
+            report.bytesWritten, report.workingSetDelta / 1024, report.peakWorkingSet / (1024 * 1024), report.runs);
+    }
+}
+
+Diagnostics::ScopedPhase::ScopedPhase(Phase phase)
+    : _phase(phase),
+      _parent(t_activePhase),
+      _start(std::chrono::steady_clock::now()),
+      _startWorkingSet(CurrentWorkingSet()) {
+    t_activePhase = this;
+}
+
+Diagnostics::ScopedPhase::~ScopedPhase() {
+    t_activePhase = _parent;
+    PhaseReport report;
+    report.wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start).count();
+    report.fsCalls = _fsCalls.load();
+    report.filesRead = _filesRead.load();
+    report.bytesRead = _bytesRead.load();
+    report.filesWritten = _filesWritten.load();
+    report.bytesWritten = _bytesWritten.load();
+    report.workingSetDelta =
+        static_cast<std::int64_t>(CurrentWorkingSet()) - static_cast<std::int64_t>(_startWorkingSet);
+    report.peakWorkingSet = PeakWorkingSet();
+
+    std::lock_guard lock(g_reportsMutex);
+    auto& stored = g_reports[static_cast<std::size_t>(_phase)];
+    report.runs = stored.runs + 1;
+    stored = report;
+}
+
+Diagnostics::ScopedPhase* Diagnostics::ActivePhase() { return t_activePhase; }
+
+Diagnostics::ScopedAttribution::ScopedAttribution(ScopedPhase* phase) : _previous(t_activePhase) {
+    t_activePhase = phase;
+}
+
+Diagnostics::ScopedAttribution::~ScopedAttribution() { t_activePhase = _previous; }
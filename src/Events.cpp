@@ -1,7 +1,9 @@
 #include "Manager.h"  
+#include "Autosave.h"
 #include "Events.h"
 #include "Settings.h"
 #include "Hooks.h"
+#include "StateKey.h"
 #include "Utils.h"
 #include "rapidjson/document.h"
 #include "rapidjson/prettywriter.h"
@@ -47,25 +49,17 @@ namespace MyMenu {
         doc.AddMember("hotkey_segunda", Settings::hotkey_segunda, allocator);
         doc.AddMember("hotkey_terceira", Settings::hotkey_terceira, allocator);
         doc.AddMember("hotkey_quarta", Settings::hotkey_quarta, allocator);
+        doc.AddMember("packed_state_key", StateKey::IsEnabled(), allocator);
 
         // Converte o JSON para uma string formatada
         rapidjson::StringBuffer buffer;
         rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
         doc.Accept(writer);
 
-        // Garante que o diretrio Data/SKSE/Plugins exista
-        std::filesystem::path config_path(settings_path);
-        std::filesystem::create_directories(config_path.parent_path());
-
-        // Escreve a string no arquivo
-        std::ofstream file(settings_path);
-        if (file.is_open()) {
-            file << buffer.GetString();
-            file.close();
-            SKSE::log::info("Configuraes salvas em {}", settings_path);
-        } else {
-            SKSE::log::error("Falha ao abrir o arquivo para salvar as configuraes: {}", settings_path);
-        }
+        // Chamado da UI (a cada tecla capturada): a escrita fica com a thread do Autosave, que tambm junta
+        // capturas seguidas numa nica gravao.
+        Autosave::GetSingleton().Submit(settings_path, std::string(buffer.GetString(), buffer.GetSize()));
+        SKSE::log::info("Configuraes enviadas para o salvamento automtico: {}", settings_path);
     }
 
     //  NOVA FUNO: Carrega as configuraes de um arquivo JSON
@@ -103,6 +97,9 @@ namespace MyMenu {
         if (doc.HasMember("hotkey_quarta") && doc["hotkey_quarta"].IsInt()) {
             Settings::hotkey_quarta = doc["hotkey_quarta"].GetInt();
         }
+        if (doc.HasMember("packed_state_key") && doc["packed_state_key"].IsBool()) {
+            StateKey::SetEnabled(doc["packed_state_key"].GetBool());
+        }
 
         SKSE::log::info("Configuraes carregadas com sucesso.");
 
@@ -1,16 +1,51 @@
 ﻿#include <algorithm>
+#include <chrono>
 #include <format>
 #include <fstream>
 #include <string>
+#include "AtomicFile.h"
+#include "Autosave.h"
+#include "ConditionEmitter.h"
+#include "ConfigRewriter.h"
+#include "Diagnostics.h"
 #include "Events.h"
+#include "Hooks.h"
+#include "LibraryCache.h"
+#include "LibraryId.h"
+#include "LibraryScanner.h"
+#include "ManagedManifest.h"
+#include "StanceStore.h"
+#include "StateKey.h"
+#include "ThreadPool.h"
 #include "SKSEMCP/SKSEMenuFramework.hpp"
 #include "rapidjson/document.h"
 #include "rapidjson/error/en.h"
-#include "rapidjson/filereadstream.h"
-#include "rapidjson/filewritestream.h"
 #include "rapidjson/prettywriter.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+
+namespace {
+    // Como cada tag aparece ao lado do nome do submod.
+    struct TagStyle {
+        AnimationTag tag;
+        const char* label;
+        ImVec4 color;
+        bool showCount;
+    };
+    const TagStyle kTagStyles[] = {
+        {AnimationTag::Attack, "HitCombo", ImVec4(1.0f, 0.4f, 0.4f, 1.0f), true},
+        {AnimationTag::PowerAttack, "PA", ImVec4(1.0f, 0.6f, 0.2f, 1.0f), true},
+        {AnimationTag::SprintAttack, "Sprint", ImVec4(1.0f, 0.8f, 0.3f, 1.0f), true},
+        {AnimationTag::Idle, "Idle", ImVec4(0.4f, 0.6f, 1.0f, 1.0f), false},
+        {AnimationTag::Dodge, "Dodge", ImVec4(0.4f, 1.0f, 0.6f, 1.0f), true},
+        {AnimationTag::Block, "Block", ImVec4(0.7f, 0.7f, 0.7f, 1.0f), true},
+        {AnimationTag::Bash, "Bash", ImVec4(0.8f, 0.5f, 1.0f, 1.0f), true},
+        {AnimationTag::Equip, "Equip", ImVec4(0.5f, 0.9f, 0.9f, 1.0f), false},
+        {AnimationTag::Unequip, "Unequip", ImVec4(0.5f, 0.7f, 0.7f, 1.0f), false},
+    };
 
-
+    constexpr const char* kOarRootPath = "Data\\meshes\\actors\\character\\animations\\OpenAnimationReplacer";
+}
 
 AnimationManager& AnimationManager::GetSingleton() {
     static AnimationManager instance;
@@ -18,34 +53,20 @@ AnimationManager& AnimationManager::GetSingleton() {
 }
 
 
-// --- DESAFIO 1: Nova função para escanear a pasta do sub-moveset em busca de tags ---
-void ScanSubAnimationFolderForTags(const std::filesystem::path& subAnimPath,
-                                                     SubAnimationDef& subAnimDef) {
-    if (!std::filesystem::exists(subAnimPath) || !std::filesystem::is_directory(subAnimPath)) {
-        return;
-    }
-
-    subAnimDef.attackCount = 0;
-    subAnimDef.powerAttackCount = 0;
-    subAnimDef.hasIdle = false;
-
-    for (const auto& fileEntry : std::filesystem::directory_iterator(subAnimPath)) {
-        if (fileEntry.is_regular_file()) {
-            std::string filename = fileEntry.path().filename().string();
-            std::string lowerFilename = filename;
-            std::transform(lowerFilename.begin(), lowerFilename.end(), lowerFilename.begin(), ::tolower);
-
-            if (filename.rfind("BFCO_Attack", 0) == 0) {  // Prefixo "BFCO_Attack"
-                subAnimDef.attackCount++;
-            }
-            if (filename.rfind("BFCO_PowerAttack", 0) == 0) {  // Prefixo "BFCO_PowerAttack"
-                subAnimDef.powerAttackCount++;
-            }
-            if (lowerFilename.find("idle") != std::string::npos) {  // Contém "idle"
-                subAnimDef.hasIdle = true;
-            }
-        }
-    }
+// Chamado no carregamento do plugin: o jogo não espera mais pelo escaneamento.
+void AnimationManager::StartLibraryScan() {
+    if (_libraryReadyFuture.valid()) return;  // Já foi iniciado
+    _scanProgress.start = std::chrono::steady_clock::now();
+    _libraryReadyFuture = std::async(std::launch::async, [this] {
+                              try {
+                                  ScanAnimationMods();
+                                  StartLibraryWatcher();
+                              } catch (const std::exception& e) {
+                                  SKSE::log::error("Falha no escaneamento da biblioteca: {}", e.what());
+                              }
+                              // Publica tudo que foi montado acima (mods, movesets de usuário, stances).
+                              _libraryReady.store(true, std::memory_order_release);
+                          }).share();
 }
 
 // --- Lógica de Escaneamento (Carrega a Biblioteca) ---
@@ -53,8 +74,10 @@ void AnimationManager::ScanAnimationMods() {
     SKSE::log::info("Iniciando escaneamento da biblioteca de animações...");
     _categories.clear();
     _allMods.clear();
+    _nameIndex.Clear();
+    _modIndexByFolder.clear();
 
-    const std::filesystem::path oarRootPath = "Data\\meshes\\actors\\character\\animations\\OpenAnimationReplacer";
+    const std::filesystem::path oarRootPath = kOarRootPath;
     // ESTRUTURA MELHORADA: Facilita a definição de categorias e suas propriedades
     struct CategoryDefinition {
         std::string name;
@@ -85,29 +108,31 @@ void AnimationManager::ScanAnimationMods() {
     }
 
     if (!std::filesystem::exists(oarRootPath)) return;
-    for (const auto& entry : std::filesystem::directory_iterator(oarRootPath)) {
-        if (entry.is_directory()) {
-            ProcessTopLevelMod(entry.path());
+
+    const auto scanStart = std::chrono::steady_clock::now();
+    std::optional<Diagnostics::ScopedPhase> scanPhase(std::in_place, Diagnostics::Phase::LibraryScan);
+    // Mods cujos carimbos não mudaram desde o último carregamento vêm do índice salvo, sem re-escanear.
+    const auto scan = LibraryScanner::ScanLibrary(oarRootPath, 0, &_scanProgress);
+    for (const auto& entry : scan.entries) {
+        if (entry.mod) {
+            _modIndexByFolder[entry.folderName] = _allMods.size();
+            _allMods.push_back(*entry.mod);
         }
     }
-    SKSE::log::info("Escaneamento de arquivos finalizado. {} mods carregados.", _allMods.size());
+    const auto scanMs =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - scanStart).count();
+    SKSE::log::info("Escaneamento finalizado. {} mods carregados em {} ms ({} re-escaneados, {} do índice).",
+                    _allMods.size(), scanMs, scan.rescanned, scan.fromIndex);
+    const auto& scanStats = LibraryScanner::GetStats();
+    const auto submods = std::max<std::uint64_t>(1, scanStats.submodsFound.load());
+    SKSE::log::info("Travessia: {} pastas listadas, {} entradas, {} stats, {} arquivos lidos ({:.2f} por submod).",
+                    scanStats.directoriesListed.load(), scanStats.entriesVisited.load(), scanStats.statCalls.load(),
+                    scanStats.filesRead.load(), static_cast<double>(scanStats.TotalCalls()) / submods);
+    SKSE::log::info("Cabeçalhos de config.json: {} bytes lidos no total.", scanStats.bytesRead.load());
+    scanPhase.reset();
 
     // Agora que temos todos os mods, vamos encontrar quais arquivos já gerenciamos.
-    SKSE::log::info("Verificando arquivos previamente gerenciados...");
-    _managedFiles.clear();
-    for (const auto& mod : _allMods) {
-        for (const auto& subAnim : mod.subAnimations) {
-            if (std::filesystem::exists(subAnim.path)) {
-                std::ifstream fileStream(subAnim.path);
-                std::string content((std::istreambuf_iterator<char>(fileStream)), std::istreambuf_iterator<char>());
-                fileStream.close();
-                if (content.find("OAR_CYCLE_MANAGER_CONDITIONS") != std::string::npos) {
-                    _managedFiles.insert(subAnim.path);
-                }
-            }
-        }
-    }
-    SKSE::log::info("Encontrados {} arquivos gerenciados.", _managedFiles.size());
+    LoadManagedFiles();
 
     // --- NOVA SEÇÃO: Carregar e integrar movesets do usuário ---
     LoadUserMovesets();
@@ -116,6 +141,7 @@ void AnimationManager::ScanAnimationMods() {
         AnimationModDef modDef;
         modDef.name = userMoveset.name;
         modDef.author = "Usuário";  // Autor padrão
+        modDef.id = LibraryId::ForUserMoveset(userMoveset.name);
 
         for (const auto& subInstance : userMoveset.subAnimations) {
             // Verifica se os índices são válidos para evitar crashes
@@ -135,30 +161,244 @@ void AnimationManager::ScanAnimationMods() {
     LoadStanceConfigurations();
 }
 
-void AnimationManager::ProcessTopLevelMod(const std::filesystem::path& modPath) {
-    std::filesystem::path configPath = modPath / "config.json";
-    if (!std::filesystem::exists(configPath)) return;
-    std::ifstream fileStream(configPath);
-    std::string jsonContent((std::istreambuf_iterator<char>(fileStream)), std::istreambuf_iterator<char>());
-    fileStream.close();
-    rapidjson::Document doc;
-    doc.Parse(jsonContent.c_str());
-    if (doc.IsObject() && doc.HasMember("name") && doc.HasMember("author")) {
-        AnimationModDef modDef;
-        modDef.name = doc["name"].GetString();
-        modDef.author = doc["author"].GetString();
-        for (const auto& subEntry : std::filesystem::recursive_directory_iterator(modPath)) {
-            if (subEntry.is_directory() && std::filesystem::exists(subEntry.path() / "config.json")) {
-                if (std::filesystem::equivalent(modPath, subEntry.path())) continue;
-                SubAnimationDef subAnimDef;
-                subAnimDef.name = subEntry.path().filename().string();
-                subAnimDef.path = subEntry.path() / "config.json";
-                // --- DESAFIO 1: Chamar a função de escaneamento de tags ---
-                ScanSubAnimationFolderForTags(subEntry.path(), subAnimDef);
-                modDef.subAnimations.push_back(subAnimDef);
+// Usa o manifesto salvo pelo SaveAllSettings: só os arquivos listados nele são conferidos.
+void AnimationManager::LoadManagedFiles() {
+    Diagnostics::ScopedPhase phase(Diagnostics::Phase::ManagedFiles);
+    SKSE::log::info("Verificando arquivos previamente gerenciados...");
+    auto manifest = ManagedManifest::Load();
+    if (!manifest) {
+        // Primeira execução (ou manifesto perdido): varredura completa uma única vez.
+        RebuildManagedManifest();
+        return;
+    }
+
+    _managedFiles.clear();
+    size_t dropped = 0;
+    for (auto& [path, record] : *manifest) {
+        if (ManagedManifest::Verify(path, record)) {
+            _managedFiles[path] = record;
+        } else {
+            dropped++;
+        }
+    }
+    if (dropped > 0) {
+        ManagedManifest::Save(_managedFiles);
+    }
+    SKSE::log::info("Encontrados {} arquivos gerenciados pelo manifesto ({} descartados).", _managedFiles.size(),
+                    dropped);
+}
+
+// Varredura completa: lê todos os config.json da biblioteca procurando o nosso marcador.
+void AnimationManager::RebuildManagedManifest() {
+    SKSE::log::info("Reconstruindo o manifesto de arquivos gerenciados (varredura completa)...");
+    MarkAllDirty();
+    _managedFiles = ScanManagedFiles(CollectManifestCandidates());
+    UpdateSelfWrittenPaths();
+    SKSE::log::info("Manifesto reconstruído: {} arquivos gerenciados.", _managedFiles.size());
+}
+
+std::vector<std::filesystem::path> AnimationManager::CollectManifestCandidates() const {
+    std::vector<std::filesystem::path> candidates;
+    for (const auto& mod : _allMods) {
+        if (mod.author == "Usuário") continue;  // Movesets de usuário só repetem caminhos de outros mods
+        for (const auto& subAnim : mod.subAnimations) {
+            candidates.push_back(subAnim.ConfigPath());
+        }
+    }
+    return candidates;
+}
+
+// Não toca no estado do manager: lê os arquivos, carimba os gerenciados e grava o manifesto.
+ManagedFileMap AnimationManager::ScanManagedFiles(const std::vector<std::filesystem::path>& candidates) {
+    Diagnostics::ScopedPhase phase(Diagnostics::Phase::ManagedFiles);
+    std::vector<char> managed(candidates.size(), 0);
+    {
+        ThreadPool pool;
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            pool.Submit([&candidates, &managed, i] {
+                managed[i] = ManagedManifest::ContainsMarker(candidates[i]) ? 1 : 0;
+            });
+        }
+        pool.Wait();
+    }
+
+    ManagedFileMap managedFiles;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (!managed[i]) continue;
+        ManagedFileRecord record;
+        ManagedManifest::Stamp(candidates[i], record);
+        managedFiles[candidates[i]] = record;
+    }
+    ManagedManifest::Save(managedFiles);
+    return managedFiles;
+}
+
+void AnimationManager::StartManifestRebuild() {
+    SKSE::log::info("Reconstruindo o manifesto de arquivos gerenciados em segundo plano...");
+    auto job = std::make_shared<ManifestRebuildJob>();
+    job->candidates = CollectManifestCandidates();
+    _manifestRebuildJob = job;
+    _manifestRebuildFuture = std::async(std::launch::async, [job] {
+        job->managedFiles = ScanManagedFiles(job->candidates);
+        job->finished.store(true, std::memory_order_release);
+    });
+}
+
+// Thread da UI, quando a varredura termina: só troca o mapa em memória.
+void AnimationManager::FinishManifestRebuild() {
+    auto job = std::move(_manifestRebuildJob);
+    _manifestRebuildFuture.get();
+    _managedFiles = std::move(job->managedFiles);
+    MarkAllDirty();
+    UpdateSelfWrittenPaths();
+    SKSE::log::info("Manifesto reconstruído: {} arquivos gerenciados.", _managedFiles.size());
+}
+
+void AnimationManager::StartLibraryWatcher() {
+    if (!std::filesystem::exists(kOarRootPath)) return;
+    _libraryWatcher = std::make_unique<LibraryWatcher>(
+        kOarRootPath, [this](const std::set<std::u8string>& changedMods, bool fullRescan) {
+            OnLibraryChanged(changedMods, fullRescan);
+        });
+    _libraryWatcher->SetIgnoreFilter([this](const std::filesystem::path& relative) {
+        return IsSelfWrittenPath(relative);
+    });
+    UpdateSelfWrittenPaths();
+    _libraryWatcher->Start();
+}
+
+// Thread da UI: os config.json gerenciados e os do salvamento em andamento.
+void AnimationManager::UpdateSelfWrittenPaths() {
+    std::set<std::filesystem::path> paths;
+    for (const auto& [path, record] : _managedFiles) paths.insert(path.lexically_normal());
+    if (_saveJob) {
+        for (const auto& [path, configs] : _saveJob->files) paths.insert(path.lexically_normal());
+    }
+    std::lock_guard lock(_selfWrittenMutex);
+    _selfWrittenPaths.swap(paths);
+}
+
+// Thread do watcher. Reescrever um config.json gerenciado não muda nada na biblioteca; sem este filtro, cada
+// salvamento re-escaneava todos os mods tocados.
+bool AnimationManager::IsSelfWrittenPath(const std::filesystem::path& relative) {
+    const auto extension = relative.extension();
+    if (!extension.empty() && extension == AtomicFileBatch::kTempSuffix) return true;
+    const auto path = (std::filesystem::path(kOarRootPath) / relative).lexically_normal();
+    std::lock_guard lock(_selfWrittenMutex);
+    return _selfWrittenPaths.contains(path);
+}
+
+// Roda na thread do watcher: re-escaneia só as pastas afetadas e entrega o lote para a UI aplicar.
+void AnimationManager::OnLibraryChanged(const std::set<std::u8string>& changedMods, bool fullRescan) {
+    const std::filesystem::path oarRootPath = kOarRootPath;
+    std::set<std::u8string> folders = changedMods;
+    if (fullRescan) {
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(oarRootPath, ec)) {
+            if (entry.is_directory(ec)) folders.insert(entry.path().filename().u8string());
+        }
+    }
+
+    LibraryUpdateBatch batch;
+    batch.fullRescan = fullRescan;
+    for (const auto& folder : folders) {
+        const std::filesystem::directory_entry modEntry(oarRootPath / folder);
+        std::error_code ec;
+        if (modEntry.is_directory(ec)) {
+            try {
+                batch.entries.push_back(LibraryScanner::ProcessTopLevelMod(modEntry));
+                continue;
+            } catch (const std::exception& e) {
+                // Provavelmente ainda está sendo copiado; o próximo evento da pasta tenta de novo.
+                SKSE::log::warn("Falha ao re-escanear {}: {}", modEntry.path().string(), e.what());
             }
         }
-        _allMods.push_back(modDef);
+        LibraryIndexEntry removed;
+        removed.folderName = folder;
+        batch.entries.push_back(std::move(removed));
+    }
+
+    std::lock_guard lock(_libraryUpdateMutex);
+    _pendingLibraryUpdates.push_back(std::move(batch));
+}
+
+// Atualiza um mod existente sem mudar a posição de nenhum submod já conhecido.
+bool AnimationManager::MergeModDefinition(AnimationModDef& target, AnimationModDef&& source) {
+    bool changed = !target.available || target.name != source.name || target.author != source.author;
+    target.name = std::move(source.name);
+    target.author = std::move(source.author);
+    target.available = true;
+
+    std::vector<char> stillPresent(target.subAnimations.size(), 0);
+    for (auto& subAnim : source.subAnimations) {
+        auto existing = std::find_if(target.subAnimations.begin(), target.subAnimations.end(),
+                                     [&](const SubAnimationDef& known) { return known.name == subAnim.name; });
+        if (existing != target.subAnimations.end()) {
+            stillPresent[existing - target.subAnimations.begin()] = 1;
+            changed |= !existing->available || existing->id != subAnim.id || existing->tagCounts != subAnim.tagCounts;
+            *existing = std::move(subAnim);
+        } else {
+            target.subAnimations.push_back(std::move(subAnim));
+            changed = true;
+        }
+    }
+    for (size_t i = 0; i < stillPresent.size(); ++i) {
+        if (!stillPresent[i] && target.subAnimations[i].available) {
+            target.subAnimations[i].available = false;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+// Roda na thread da UI. Nada é apagado de _allMods: mods novos vão para o fim e os removidos são só marcados.
+void AnimationManager::ApplyLibraryUpdates() {
+    std::vector<LibraryUpdateBatch> batches;
+    {
+        std::lock_guard lock(_libraryUpdateMutex);
+        batches.swap(_pendingLibraryUpdates);
+    }
+
+    for (auto& batch : batches) {
+        size_t added = 0, updated = 0, removed = 0;
+        std::set<std::u8string> seen;
+        for (auto& entry : batch.entries) {
+            seen.insert(entry.folderName);
+            auto known = _modIndexByFolder.find(entry.folderName);
+            if (known == _modIndexByFolder.end()) {
+                if (!entry.mod) continue;
+                _modIndexByFolder[entry.folderName] = _allMods.size();
+                _allMods.push_back(std::move(*entry.mod));
+                added++;
+                continue;
+            }
+
+            auto& modDef = _allMods[known->second];
+            if (entry.mod) {
+                // Um evento sem efeito (arquivo tocado, mesma lista de arquivos) não invalida nada.
+                if (MergeModDefinition(modDef, std::move(*entry.mod))) {
+                    _nameIndex.Reindex(_allMods, known->second);
+                    updated++;
+                }
+            } else if (modDef.available) {
+                modDef.available = false;
+                for (auto& subAnim : modDef.subAnimations) subAnim.available = false;
+                removed++;
+            }
+        }
+
+        if (batch.fullRescan) {
+            for (const auto& [folder, modIdx] : _modIndexByFolder) {
+                if (!seen.contains(folder) && _allMods[modIdx].available) {
+                    _allMods[modIdx].available = false;
+                    for (auto& subAnim : _allMods[modIdx].subAnimations) subAnim.available = false;
+                    removed++;
+                }
+            }
+        }
+        SKSE::log::info("Biblioteca atualizada: {} mods novos, {} alterados, {} removidos.", added, updated, removed);
+        // Índices de sub-animação e disponibilidade mudaram: não dá para saber quais instâncias dependem disso.
+        if (added + updated + removed > 0) MarkAllDirty();
     }
 }
 
@@ -187,6 +427,7 @@ void AnimationManager::DrawAddModModal() {
             std::transform(filter_str.begin(), filter_str.end(), filter_str.begin(), ::tolower);
             for (size_t modIdx = 0; modIdx < _allMods.size(); ++modIdx) {
                 const auto& modDef = _allMods[modIdx];
+                if (!modDef.available) continue;
                 std::string mod_name_str = modDef.name;
                 std::transform(mod_name_str.begin(), mod_name_str.end(), mod_name_str.begin(), ::tolower);
                 if (filter_str.empty() || mod_name_str.find(filter_str) != std::string::npos) {
@@ -194,13 +435,20 @@ void AnimationManager::DrawAddModModal() {
                     if (ImGui::Button(("Adicionar##" + modDef.name).c_str())) {
                         ModInstance newModInstance;
                         newModInstance.sourceModIndex = modIdx;
+                        newModInstance.sourceModId = modDef.id;
                         for (size_t subIdx = 0; subIdx < modDef.subAnimations.size(); ++subIdx) {
+                            if (!modDef.subAnimations[subIdx].available) continue;
                             SubAnimationInstance newSubInstance;
-                            newSubInstance.sourceModIndex = modIdx;
-                            newSubInstance.sourceSubAnimIndex = subIdx;
+                            LinkSubAnimation(newSubInstance, modIdx, subIdx);
                             newModInstance.subAnimationInstances.push_back(newSubInstance);
                         }
                         _instanceToAddTo->modInstances.push_back(newModInstance);
+                        if (_modalInstanceKey) {
+                            auto op = StanceEditOp(StanceJournal::OpType::InsertMoveset, *_modalInstanceKey,
+                                                   _instanceToAddTo->modInstances.size() - 1);
+                            op.movesetData = StoreMoveset(newModInstance);
+                            RecordStanceEdit(std::move(op));
+                        }
                     }
                     ImGui::SameLine(240);
                     ImGui::Text("%s", modDef.name.c_str());
@@ -229,13 +477,14 @@ void AnimationManager::DrawAddModModal() {
 
             for (size_t modIdx = 0; modIdx < _allMods.size(); ++modIdx) {
                 const auto& modDef = _allMods[modIdx];
+                if (!modDef.available) continue;
                 std::string mod_name_str = modDef.name;
                 std::transform(mod_name_str.begin(), mod_name_str.end(), mod_name_str.begin(), ::tolower);
                 bool parent_matches = mod_name_str.find(filter_str) != std::string::npos;
                 bool child_matches = false;
                 if (!parent_matches) {
                     for (const auto& subAnim : modDef.subAnimations) {
-                        std::string sub_name_str = subAnim.name;
+                        std::string sub_name_str(subAnim.name.View());
                         std::transform(sub_name_str.begin(), sub_name_str.end(), sub_name_str.begin(), ::tolower);
                         if (sub_name_str.find(filter_str) != std::string::npos) {
                             child_matches = true;
@@ -248,7 +497,8 @@ void AnimationManager::DrawAddModModal() {
                     if (ImGui::TreeNode(modDef.name.c_str())) {
                         for (size_t subAnimIdx = 0; subAnimIdx < modDef.subAnimations.size(); ++subAnimIdx) {
                             const auto& subAnimDef = modDef.subAnimations[subAnimIdx];
-                            std::string sub_name_str = subAnimDef.name;
+                            if (!subAnimDef.available) continue;
+                            std::string sub_name_str(subAnimDef.name.View());
                             std::transform(sub_name_str.begin(), sub_name_str.end(), sub_name_str.begin(), ::tolower);
 
                             if (filter_str.empty() || sub_name_str.find(filter_str) != std::string::npos) {
@@ -266,14 +516,22 @@ void AnimationManager::DrawAddModModal() {
 
                                 if (ImGui::Button("Adicionar", ImVec2(button_width, 0))) {
                                     SubAnimationInstance newSubInstance;
-                                    newSubInstance.sourceModIndex = modIdx;
-                                    newSubInstance.sourceSubAnimIndex = subAnimIdx;
-                                    const auto& sourceMod = _allMods[modIdx];
-                                    const auto& sourceSubAnim = sourceMod.subAnimations[subAnimIdx];
-                                    newSubInstance.sourceModName = sourceMod.name;
-                                    newSubInstance.sourceSubName = sourceSubAnim.name;
+                                    LinkSubAnimation(newSubInstance, modIdx, subAnimIdx);
                                     if (_modInstanceToAddTo) {
-                                        _modInstanceToAddTo->subAnimationInstances.push_back(newSubInstance);
+                                        auto& animations = _modInstanceToAddTo->subAnimationInstances;
+                                        animations.push_back(newSubInstance);
+                                        if (_modalInstanceKey) {
+                                            const auto& [categoryName, instanceIndex] = *_modalInstanceKey;
+                                            const auto& movesets =
+                                                _categories.at(categoryName).instances[instanceIndex].modInstances;
+                                            auto op = StanceEditOp(StanceJournal::OpType::InsertAnimation,
+                                                                   *_modalInstanceKey,
+                                                                   static_cast<size_t>(_modInstanceToAddTo -
+                                                                                       movesets.data()));
+                                            op.animation = static_cast<std::uint32_t>(animations.size() - 1);
+                                            op.animationData = StoreAnimation(newSubInstance);
+                                            RecordStanceEdit(std::move(op));
+                                        }
                                     } else if (_userMovesetToAddTo) {
                                         _userMovesetToAddTo->subAnimations.push_back(newSubInstance);
                                     }
@@ -306,7 +564,133 @@ void AnimationManager::DrawAddModModal() {
 }
 
 // Esta é a nova função principal da UI que você registrará no SKSEMenuFramework
+void AnimationManager::DrawScanProgress() {
+    const auto total = _scanProgress.modsTotal.load();
+    const auto scanned = _scanProgress.modsScanned.load();
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - _scanProgress.start).count();
+
+    ImGui::Text("Carregando a biblioteca de animações...");
+    const float fraction = total > 0 ? static_cast<float>(scanned) / static_cast<float>(total) : 0.0f;
+    const std::string overlay = std::format("{} / {} mods", scanned, total);
+    ImGui::ProgressBar(fraction, ImVec2(-1.0f, 0.0f), overlay.c_str());
+    const auto submods = LibraryScanner::GetStats().submodsFound.load();
+    ImGui::Text("Submods encontrados: %llu", static_cast<unsigned long long>(submods));
+    ImGui::Text("Tempo decorrido: %.1f s", elapsed);
+    if (total > 0 && scanned == total) {
+        ImGui::Text("Carregando movesets de usuário e stances...");
+    }
+}
+
+AnimationManager::LibraryMemoryReport AnimationManager::ComputeLibraryMemoryReport() const {
+    // Como era um submod antes do StringPool, com as mesmas tags.
+    struct LegacySubAnimationDef {
+        std::string name;
+        std::filesystem::path path;
+        std::array<int, kAnimationTagCount> tagCounts;
+        bool available;
+    };
+    const std::size_t stringInline = std::string().capacity();
+    const std::size_t pathInline = std::filesystem::path().native().capacity();
+
+    LibraryMemoryReport report;
+    report.mods = _allMods.size();
+    report.recordBytes = _allMods.capacity() * sizeof(AnimationModDef);
+    std::size_t legacyHeap = 0;
+    for (const auto& mod : _allMods) {
+        report.submods += mod.subAnimations.size();
+        report.recordBytes += mod.subAnimations.capacity() * sizeof(SubAnimationDef);
+        for (const auto& subAnim : mod.subAnimations) {
+            if (subAnim.name.size() > stringInline) legacyHeap += subAnim.name.size() + 1;
+            const auto pathLength = subAnim.ConfigPath().native().size();
+            if (pathLength > pathInline) legacyHeap += (pathLength + 1) * sizeof(std::filesystem::path::value_type);
+        }
+    }
+    report.legacyBytes = _allMods.capacity() * sizeof(AnimationModDef) +
+                         report.submods * sizeof(LegacySubAnimationDef) + legacyHeap;
+
+    const auto poolStats = StringPool::GetSingleton().GetMemoryStats();
+    report.poolBytes = poolStats.arenaBytes + poolStats.indexBytes;
+    return report;
+}
+
+// Números da última execução de cada fase pesada (ver Diagnostics.h).
+void AnimationManager::DrawDiagnostics() {
+    if (ImGui::Button("Registrar no log")) {
+        Diagnostics::LogReport();
+    }
+    ImGui::Separator();
+
+    constexpr int kColumns = 8;
+    if (ImGui::BeginTable("diagnostics_table", kColumns, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("Fase");
+        ImGui::TableSetupColumn("Tempo (ms)");
+        ImGui::TableSetupColumn("Chamadas ao disco");
+        ImGui::TableSetupColumn("Lidos (arq./KB)");
+        ImGui::TableSetupColumn("Escritos (arq./KB)");
+        ImGui::TableSetupColumn("Memória (KB)");
+        ImGui::TableSetupColumn("Pico (MB)");
+        ImGui::TableSetupColumn("Execuções");
+        ImGui::TableHeadersRow();
+
+        for (std::size_t i = 0; i < Diagnostics::kPhaseCount; ++i) {
+            const auto phase = static_cast<Diagnostics::Phase>(i);
+            const auto report = Diagnostics::GetReport(phase);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%s", Diagnostics::PhaseName(phase));
+            if (report.runs == 0) {
+                for (int column = 1; column < kColumns; ++column) {
+                    ImGui::TableNextColumn();
+                    ImGui::Text("-");
+                }
+                continue;
+            }
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f", report.wallMs);
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", static_cast<unsigned long long>(report.fsCalls));
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu / %llu", static_cast<unsigned long long>(report.filesRead),
+                        static_cast<unsigned long long>(report.bytesRead / 1024));
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu / %llu", static_cast<unsigned long long>(report.filesWritten),
+                        static_cast<unsigned long long>(report.bytesWritten / 1024));
+            ImGui::TableNextColumn();
+            ImGui::Text("%+lld", static_cast<long long>(report.workingSetDelta / 1024));
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", static_cast<unsigned long long>(report.peakWorkingSet / (1024 * 1024)));
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", static_cast<unsigned long long>(report.runs));
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::Separator();
+    if (ImGui::Button("Calcular memória da biblioteca")) {
+        _memoryReport = ComputeLibraryMemoryReport();
+        SKSE::log::info("[Diagnóstico] Biblioteca: {} mods, {} submods. Formato antigo ~{} KB, atual {} KB "
+                        "(registros {} KB + pool {} KB).",
+                        _memoryReport->mods, _memoryReport->submods, _memoryReport->legacyBytes / 1024,
+                        (_memoryReport->recordBytes + _memoryReport->poolBytes) / 1024,
+                        _memoryReport->recordBytes / 1024, _memoryReport->poolBytes / 1024);
+    }
+    if (_memoryReport) {
+        const auto currentBytes = _memoryReport->recordBytes + _memoryReport->poolBytes;
+        ImGui::Text("%zu mods, %zu submods", _memoryReport->mods, _memoryReport->submods);
+        ImGui::Text("Formato antigo (estimado): %zu KB", _memoryReport->legacyBytes / 1024);
+        ImGui::Text("Formato atual: %zu KB (registros %zu KB + pool %zu KB)", currentBytes / 1024,
+                    _memoryReport->recordBytes / 1024, _memoryReport->poolBytes / 1024);
+    }
+}
+
 void AnimationManager::DrawMainMenu() {
+    // Enquanto o escaneamento não termina, nada da biblioteca pode ser lido.
+    if (!IsLibraryReady()) {
+        DrawScanProgress();
+        return;
+    }
+    ApplyLibraryUpdates();
+
     // Primeiro, desenhamos o sistema de abas
     if (ImGui::BeginTabBar("MainTabs")) {
         if (ImGui::BeginTabItem("Gerenciador de Animações")) {
@@ -317,6 +701,10 @@ void AnimationManager::DrawMainMenu() {
             DrawUserMovesetManager();  // Chama a UI da segunda aba
             ImGui::EndTabItem();
         }
+        if (ImGui::BeginTabItem("Diagnóstico")) {
+            DrawDiagnostics();
+            ImGui::EndTabItem();
+        }
         ImGui::EndTabBar();
     }
 
@@ -324,14 +712,64 @@ void AnimationManager::DrawMainMenu() {
     // Ele só será desenhado quando a flag _isAddModModalOpen for verdadeira,
     // mas agora ele não pertence a nenhuma aba específica.
     DrawAddModModal();
+
+    // As edições deste quadro viram um snapshot em memória; o disco fica com a thread do Autosave.
+    QueueStanceAutosave();
 }
 
 void AnimationManager::DrawAnimationManager() {
+    if (_manifestRebuildJob && _manifestRebuildJob->finished.load(std::memory_order_acquire)) {
+        FinishManifestRebuild();
+    }
+    // Salvamento e reconstrução mexem nos mesmos arquivos e no mesmo manifesto: um de cada vez.
+    ImGui::BeginDisabled(_saveJob != nullptr || _manifestRebuildJob != nullptr);
     if (ImGui::Button("Save config")) {
         SaveAllSettings();
     }
     ImGui::SameLine();
-    ImGui::Checkbox("Preservar Condições Externas", &_preserveConditions);
+    if (ImGui::Button("Simular salvamento")) {
+        PlanAllSettings();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Reconstruir manifesto")) {
+        StartManifestRebuild();
+    }
+    ImGui::EndDisabled();
+    ImGui::SameLine();
+    if (ImGui::Button("Exportar stances")) {
+        ExportStances();
+    }
+    if (ImGui::IsItemHovered()) ImGui::SetTooltip("Grava uma cópia legível em %s.", StanceStore::kExportPath);
+    ImGui::SameLine();
+    ImGui::BeginDisabled(_undoStack.empty());
+    if (ImGui::Button("Desfazer")) {
+        UndoStanceEdit();
+    }
+    ImGui::EndDisabled();
+    ImGui::SameLine();
+    ImGui::BeginDisabled(_redoStack.empty());
+    if (ImGui::Button("Refazer")) {
+        RedoStanceEdit();
+    }
+    ImGui::EndDisabled();
+    ImGui::SameLine();
+    if (ImGui::Checkbox("Preservar Condições Externas", &_preserveConditions)) MarkAllDirty();
+    ImGui::SameLine();
+    if (ImGui::Checkbox("Otimizar Condições", &_optimizeConditions)) MarkAllDirty();
+    ImGui::SameLine();
+    bool packedStateKey = StateKey::IsEnabled();
+    if (ImGui::Checkbox("Chave de estado única", &packedStateKey)) {
+        StateKey::SetEnabled(packedStateKey);
+        MarkAllDirty();
+        MyMenu::SaveSettings();
+    }
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip(
+            "Publica instância, posição na playlist e direção em %s e gera condições que só comparam essa\n"
+            "variável. A variável precisa existir no behavior. Salve a configuração de novo depois de mudar.",
+            StateKey::kGraphVariable);
+    }
+    DrawSaveStatus();
     ImGui::Separator();
 
     // DrawAddModModal();
@@ -385,6 +823,7 @@ void AnimationManager::DrawAnimationManager() {
                             _isAddModModalOpen = true;
                             _instanceToAddTo = &instance;
                             _modInstanceToAddTo = nullptr;
+                            _modalInstanceKey = InstanceKey(category.name, i);
                         }
                         ImGui::Separator();
 
@@ -409,7 +848,13 @@ void AnimationManager::DrawAnimationManager() {
                             // 3. Desenhamos todos os widgets do "Pai" (botão, checkbox, nome)
                             if (ImGui::Button("X")) modInstanceToRemove = static_cast<int>(mod_i);
                             ImGui::SameLine();
-                            ImGui::Checkbox("##modselect", &modInstance.isSelected);
+                            if (ImGui::Checkbox("##modselect", &modInstance.isSelected)) {
+                                auto op = StanceEditOp(StanceJournal::OpType::SetMovesetSelected,
+                                                       {category.name, i}, mod_i);
+                                op.before = !modInstance.isSelected;
+                                op.after = modInstance.isSelected;
+                                RecordStanceEdit(std::move(op));
+                            }
                             ImGui::SameLine();
                             bool node_open = ImGui::TreeNode(sourceMod.name.c_str());
 
@@ -422,7 +867,12 @@ void AnimationManager::DrawAnimationManager() {
                             if (ImGui::BeginDragDropTarget()) {
                                 if (const ImGuiPayload* payload = ImGui::AcceptDragDropPayload("DND_MOD_INSTANCE")) {
                                     size_t source_idx = *(const size_t*)payload->Data;
+                                    auto op = StanceEditOp(StanceJournal::OpType::SwapMovesets,
+                                                           {category.name, i}, source_idx);
+                                    op.target = static_cast<std::uint32_t>(mod_i);
+                                    op.targetId = instance.modInstances[mod_i].sourceModId;
                                     std::swap(instance.modInstances[source_idx], instance.modInstances[mod_i]);
+                                    RecordStanceEdit(std::move(op));
                                 }
                             }
 
@@ -431,6 +881,7 @@ void AnimationManager::DrawAnimationManager() {
                                     _isAddModModalOpen = true;
                                     _modInstanceToAddTo = &modInstance;
                                     _instanceToAddTo = nullptr;
+                                    _modalInstanceKey = InstanceKey(category.name, i);
                                 }
                                 // Estas variáveis agora controlam a lógica de agrupamento
 
@@ -468,7 +919,15 @@ void AnimationManager::DrawAnimationManager() {
                                         // --- COLUNA 1: Informações Principais ---
                                         ImGui::TableNextColumn();
 
-                                        ImGui::Checkbox("##subselect", &subInstance.isSelected);
+                                        if (ImGui::Checkbox("##subselect", &subInstance.isSelected)) {
+                                            auto op = StanceEditOp(StanceJournal::OpType::SetAnimationSelected,
+                                                                   {category.name, i}, mod_i);
+                                            op.animation = static_cast<std::uint32_t>(sub_j);
+                                            op.animationId = subInstance.sourceSubId;
+                                            op.before = !subInstance.isSelected;
+                                            op.after = subInstance.isSelected;
+                                            RecordStanceEdit(std::move(op));
+                                        }
                                         ImGui::SameLine();
 
                                         // NOVO: Agrupa o nome e as tags para que o Drag and Drop funcione em ambos.
@@ -479,15 +938,16 @@ void AnimationManager::DrawAnimationManager() {
                                         if (modInstance.isSelected && subInstance.isSelected) {
                                             if (playlistNumbers.count(&subInstance)) {
                                                 label = std::format("[{}] {}", playlistNumbers.at(&subInstance),
-                                                                    originSubAnim.name);
+                                                                    originSubAnim.name.View());
                                             } else if (parentNumbersForChildren.count(&subInstance)) {
                                                 int parentNum = parentNumbersForChildren.at(&subInstance);
-                                                label = std::format(" -> [{}] {}", parentNum, originSubAnim.name);
+                                                label = std::format(" -> [{}] {}", parentNum,
+                                                                    originSubAnim.name.View());
                                             } else {
-                                                label = originSubAnim.name;
+                                                label = originSubAnim.name.View();
                                             }
                                         } else {
-                                            label = originSubAnim.name;
+                                            label = originSubAnim.name.View();
                                         }
                                         if (subInstance.sourceModIndex != modInstance.sourceModIndex) {
                                             label += std::format(" (by: {})", originMod.name);
@@ -508,8 +968,16 @@ void AnimationManager::DrawAnimationManager() {
                                             if (const ImGuiPayload* payload =
                                                     ImGui::AcceptDragDropPayload("DND_SUB_INSTANCE")) {
                                                 size_t source_idx = *(const size_t*)payload->Data;
+                                                auto op = StanceEditOp(StanceJournal::OpType::SwapAnimations,
+                                                                       {category.name, i}, mod_i);
+                                                op.animation = static_cast<std::uint32_t>(source_idx);
+                                                op.target = static_cast<std::uint32_t>(sub_j);
+                                                op.animationId =
+                                                    modInstance.subAnimationInstances[source_idx].sourceSubId;
+                                                op.targetId = modInstance.subAnimationInstances[sub_j].sourceSubId;
                                                 std::swap(modInstance.subAnimationInstances[source_idx],
                                                           modInstance.subAnimationInstances[sub_j]);
+                                                RecordStanceEdit(std::move(op));
                                             }
                                         }
         
@@ -517,21 +985,15 @@ void AnimationManager::DrawAnimationManager() {
                                         // ALTERADO: As tags agora são desenhadas abaixo da label, dentro do mesmo
                                         // grupo. Elas usam SameLine() entre si para ficarem na mesma linha.
                                         bool firstTag = true;
-                                        if (originSubAnim.attackCount > 0) {
-                                            if (!firstTag) ImGui::SameLine();
-                                            ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "[HitCombo: %d]",
-                                                               originSubAnim.attackCount);
-                                            firstTag = false;
-                                        }
-                                        if (originSubAnim.powerAttackCount > 0) {
-                                            if (!firstTag) ImGui::SameLine();
-                                            ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.2f, 1.0f), "[PA: %d]",
-                                                               originSubAnim.powerAttackCount);
-                                            firstTag = false;
-                                        }
-                                        if (originSubAnim.hasIdle) {
+                                        for (const auto& style : kTagStyles) {
+                                            const auto count = originSubAnim.TagCount(style.tag);
+                                            if (count == 0) continue;
                                             if (!firstTag) ImGui::SameLine();
-                                            ImGui::TextColored(ImVec4(0.4f, 0.6f, 1.0f, 1.0f), "[Idle]");
+                                            if (style.showCount) {
+                                                ImGui::TextColored(style.color, "[%s: %u]", style.label, count);
+                                            } else {
+                                                ImGui::TextColored(style.color, "[%s]", style.label);
+                                            }
                                             firstTag = false;
                                         }
 
@@ -543,25 +1005,35 @@ void AnimationManager::DrawAnimationManager() {
 
                                         // MOVIDO: Todos os checkboxes agora estão na segunda coluna.
                                         // Eles usam SameLine() para se alinharem horizontalmente DENTRO da coluna.
-                                        ImGui::Checkbox("F", &subInstance.pFront);
+                                        const auto flagsBefore = StanceStore::PackFlags(subInstance);
+                                        bool flagsChanged = ImGui::Checkbox("F", &subInstance.pFront);
                                         ImGui::SameLine();
-                                        ImGui::Checkbox("B", &subInstance.pBack);
+                                        flagsChanged |= ImGui::Checkbox("B", &subInstance.pBack);
                                         ImGui::SameLine();
-                                        ImGui::Checkbox("L", &subInstance.pLeft);
+                                        flagsChanged |= ImGui::Checkbox("L", &subInstance.pLeft);
                                         ImGui::SameLine();
-                                        ImGui::Checkbox("R", &subInstance.pRight);
+                                        flagsChanged |= ImGui::Checkbox("R", &subInstance.pRight);
                                         ImGui::SameLine();
-                                        ImGui::Checkbox("FR", &subInstance.pFrontRight);
+                                        flagsChanged |= ImGui::Checkbox("FR", &subInstance.pFrontRight);
                                         ImGui::SameLine();
-                                        ImGui::Checkbox("FL", &subInstance.pFrontLeft);
+                                        flagsChanged |= ImGui::Checkbox("FL", &subInstance.pFrontLeft);
                                         ImGui::SameLine();
-                                        ImGui::Checkbox("BR", &subInstance.pBackRight);
+                                        flagsChanged |= ImGui::Checkbox("BR", &subInstance.pBackRight);
                                         ImGui::SameLine();
-                                        ImGui::Checkbox("BL", &subInstance.pBackLeft);
+                                        flagsChanged |= ImGui::Checkbox("BL", &subInstance.pBackLeft);
                                         ImGui::SameLine();
-                                        ImGui::Checkbox("Rnd", &subInstance.pRandom);
+                                        flagsChanged |= ImGui::Checkbox("Rnd", &subInstance.pRandom);
                                         ImGui::SameLine();
-                                        ImGui::Checkbox("Movement", &subInstance.pDodge);
+                                        flagsChanged |= ImGui::Checkbox("Movement", &subInstance.pDodge);
+                                        if (flagsChanged) {
+                                            auto op = StanceEditOp(StanceJournal::OpType::SetAnimationFlags,
+                                                                   {category.name, i}, mod_i);
+                                            op.animation = static_cast<std::uint32_t>(sub_j);
+                                            op.animationId = subInstance.sourceSubId;
+                                            op.before = flagsBefore;
+                                            op.after = StanceStore::PackFlags(subInstance);
+                                            RecordStanceEdit(std::move(op));
+                                        }
 
                                         ImGui::EndTable();
                                     }
@@ -585,7 +1057,11 @@ void AnimationManager::DrawAnimationManager() {
                         }
 
                         if (modInstanceToRemove != -1) {
+                            auto op = StanceEditOp(StanceJournal::OpType::RemoveMoveset, {category.name, i},
+                                                   modInstanceToRemove);
+                            op.movesetData = StoreMoveset(instance.modInstances[modInstanceToRemove]);
                             instance.modInstances.erase(instance.modInstances.begin() + modInstanceToRemove);
+                            RecordStanceEdit(std::move(op));
                         }
                         ImGui::EndTabItem();
                     }
@@ -598,118 +1074,615 @@ void AnimationManager::DrawAnimationManager() {
 }
 
 void AnimationManager::SaveAllSettings() {
+    if (_saveJob) return;  // Já existe um salvamento em andamento
     SKSE::log::info("Iniciando salvamento global de todas as configurações...");
-    SaveStanceConfigurations();
-    SKSE::log::info("Gerando arquivos de condição para OAR...");
-    std::map<std::filesystem::path, std::vector<FileSaveConfig>> fileUpdates;
+    auto selection = CollectConditionFileUpdates();
+    // O diário já guarda cada edição; o salvamento completo é um bom momento para compactá-lo.
+    CompactStanceJournal();
+
+    // A partir daqui o salvamento vale como feito; o que falhar volta a ficar marcado.
+    if (selection.full) _filesByInstance.clear();
+    for (auto& [key, files] : selection.filesByInstance) _filesByInstance[key] = std::move(files);
+    _dirty = DirtyState{.all = false};
+
+    SKSE::log::info("Gerando arquivos de condição para OAR ({})...",
+                    selection.full ? "completo" : "só o que mudou");
+    SKSE::log::info("{} arquivos de configuração serão verificados.", selection.fileUpdates.size());
+    StartConditionFileJobs(std::move(selection.fileUpdates), false);
+}
+
+void AnimationManager::PlanAllSettings() {
+    if (_saveJob) return;
+    auto selection = CollectConditionFileUpdates();
+    SKSE::log::info("Simulando o salvamento de {} arquivos de configuração...", selection.fileUpdates.size());
+    StartConditionFileJobs(std::move(selection.fileUpdates), true);
+}
+
+void AnimationManager::MarkInstanceDirty(const WeaponCategory& category, int instanceIndex) {
+    MarkInstanceEdited(InstanceKey(category.name, instanceIndex));
+    _snapshotRequested = true;
+    // As posições guardadas no histórico podem não valer mais.
+    _undoStack.clear();
+    _redoStack.clear();
+}
+
+void AnimationManager::MarkInstanceEdited(const InstanceKey& key) {
+    _dirty.instances.insert(key);
+    _unsavedStances.insert(key);
+}
+
+void AnimationManager::QueueStanceAutosave() {
+    // O diário pode ter ficado com um registro pela metade: só um snapshot novo (store + diário vazio) o conserta.
+    if (Autosave::GetSingleton().AppendFailed(StanceJournal::kJournalPath)) _snapshotRequested = true;
+    if (!_snapshotRequested && _journalRecords < StanceJournal::kCompactThreshold) return;
+    CompactStanceJournal();
+}
+
+void AnimationManager::CompactStanceJournal() {
+    if (_stanceStoreLocked) return;
+    SaveStanceConfigurations(&_unsavedStances);
+    _unsavedStances.clear();
+}
+
+StanceJournal::Op AnimationManager::StanceEditOp(StanceJournal::OpType type, const InstanceKey& key,
+                                                 size_t movesetIndex) const {
+    StanceJournal::Op op;
+    op.type = type;
+    op.category = key.first;
+    op.instance = static_cast<std::uint8_t>(key.second);
+    op.moveset = static_cast<std::uint32_t>(movesetIndex);
+    const auto& movesets = _categories.at(key.first).instances[key.second].modInstances;
+    if (movesetIndex < movesets.size()) op.movesetId = movesets[movesetIndex].sourceModId;
+    return op;
+}
 
+void AnimationManager::RecordStanceEdit(StanceJournal::Op op) {
+    const InstanceKey key(op.category, op.instance);
+    MarkInstanceEdited(key);
+    if (_divergedInstances.erase(key)) {
+        // As posições da UI não são as do store nesta instância: ela vai inteira para um snapshot novo, que
+        // passa a ter a mesma lista da UI, em vez de entrar no diário.
+        _snapshotRequested = true;
+    } else {
+        AppendStanceRecord(op);
+    }
+    _undoStack.push_back(std::move(op));
+    _redoStack.clear();
+}
+
+void AnimationManager::AppendStanceRecord(const StanceJournal::Op& op) {
+    if (_stanceStoreLocked) return;  // O diário pertence ao store que não pode ser alterado
+    Autosave::GetSingleton().Append(StanceJournal::kJournalPath, StanceJournal::Encode(op));
+    _journalRecords++;
+}
+
+bool AnimationManager::ApplyStanceOp(const StanceJournal::Op& op) {
+    const auto category = _categories.find(op.category);
+    if (category == _categories.end() || op.instance >= StanceStore::kInstanceCount) return false;
+    // A operação vale sobre a instância no formato do store, como na reaplicação do diário; a lista da UI é
+    // refeita a partir do resultado.
+    auto stored = BuildStoredInstance(category->second, op.instance);
+    if (!StanceJournal::Apply(stored, op)) return false;
+    std::vector<ModInstance> movesets;
+    movesets.reserve(stored.size());
+    for (const auto& moveset : stored) {
+        auto modInstance = InstantiateMoveset(moveset);
+        // Algo que não resolve mais, ou resolve pelo nome para outra pasta, desalinharia as posições.
+        if (!modInstance || (moveset.id != 0 && modInstance->sourceModId != moveset.id) ||
+            modInstance->subAnimationInstances.size() != moveset.animations.size()) {
+            return false;
+        }
+        for (std::size_t a = 0; a < moveset.animations.size(); ++a) {
+            const auto storedId = moveset.animations[a].sourceSubId;
+            if (storedId != 0 && modInstance->subAnimationInstances[a].sourceSubId != storedId) return false;
+        }
+        movesets.push_back(std::move(*modInstance));
+    }
+    category->second.instances[op.instance].modInstances = std::move(movesets);
+    MarkInstanceEdited(InstanceKey(op.category, op.instance));
+    return true;
+}
+
+// Desfazer e refazer também são edições: a operação aplicada vai para o diário como qualquer outra, então a
+// reaplicação nunca precisa saber o que foi desfeito.
+void AnimationManager::UndoStanceEdit() {
+    if (_undoStack.empty()) return;
+    auto inverse = StanceJournal::Inverse(_undoStack.back());
+    if (!ApplyStanceOp(inverse)) {
+        SKSE::log::warn("Não foi possível desfazer a última edição; o histórico foi descartado.");
+        _undoStack.clear();
+        _redoStack.clear();
+        return;
+    }
+    AppendStanceRecord(inverse);
+    _redoStack.push_back(std::move(_undoStack.back()));
+    _undoStack.pop_back();
+}
+
+void AnimationManager::RedoStanceEdit() {
+    if (_redoStack.empty()) return;
+    const auto& op = _redoStack.back();
+    if (!ApplyStanceOp(op)) {
+        SKSE::log::warn("Não foi possível refazer a edição; o histórico foi descartado.");
+        _undoStack.clear();
+        _redoStack.clear();
+        return;
+    }
+    AppendStanceRecord(op);
+    _undoStack.push_back(std::move(_redoStack.back()));
+    _redoStack.pop_back();
+}
+
+void AnimationManager::CollectInstanceConfigs(WeaponCategory& category, int instanceIndex,
+                                              std::map<std::filesystem::path, std::vector<FileSaveConfig>>& fileUpdates,
+                                              std::set<std::filesystem::path>& files) {
+    CategoryInstance& instance = category.instances[instanceIndex];
+    int playlistParentCounter = 1;  // Contador para os itens "Pai"
+    int lastParentOrder = 0;        // Armazena o número do último "Pai"
+    // Loop através dos MOVESETS (ModInstance) na instância
+    for (size_t mod_i = 0; mod_i < instance.modInstances.size(); ++mod_i) {
+        ModInstance& modInstance = instance.modInstances[mod_i];
+
+        // Loop através dos SUB-MOVESETS (SubAnimationInstance)
+        for (size_t sub_j = 0; sub_j < modInstance.subAnimationInstances.size(); ++sub_j) {
+            SubAnimationInstance& subInstance = modInstance.subAnimationInstances[sub_j];
+
+            // Salva apenas se tanto o sub-moveset quanto o moveset pai estiverem selecionados
+            if (modInstance.isSelected && subInstance.isSelected) {
+                const auto& sourceMod = _allMods[subInstance.sourceModIndex];
+                const auto& sourceSubAnim = sourceMod.subAnimations[subInstance.sourceSubAnimIndex];
+                // A pasta foi removida com o jogo aberto: não há arquivo para escrever.
+                if (!sourceSubAnim.available) continue;
+
+                FileSaveConfig config;
+                config.instance_index = instanceIndex + 1;  // Instância é 1-4
+                config.category = &category;
+
+                // Copia o estado de todas as checkboxes para o config
+                config.pFront = subInstance.pFront;
+                config.pBack = subInstance.pBack;
+                config.pLeft = subInstance.pLeft;
+                config.pRight = subInstance.pRight;
+                config.pFrontRight = subInstance.pFrontRight;
+                config.pFrontLeft = subInstance.pFrontLeft;
+                config.pBackRight = subInstance.pBackRight;
+                config.pBackLeft = subInstance.pBackLeft;
+                config.pRandom = subInstance.pRandom;
+
+                // Determina se é um "Pai" (nenhuma checkbox de direção marcada) ou "Filho"
+                bool isParent = !(config.pFront || config.pBack || config.pLeft || config.pRight ||
+                                  config.pFrontRight || config.pFrontLeft || config.pBackRight || config.pBackLeft ||
+                                  config.pRandom || config.pDodge);
+
+                config.isParent = isParent;
+
+                if (isParent) {
+                    lastParentOrder = playlistParentCounter;
+                    config.order_in_playlist = playlistParentCounter++;
+                } else {
+                    // Filhos herdam o número do último pai encontrado
+                    config.order_in_playlist = lastParentOrder;
+                }
+
+                // Adiciona a configuração ao mapa, agrupada pelo caminho do arquivo
+                auto configPath = sourceSubAnim.ConfigPath();
+                files.insert(configPath);
+                fileUpdates[std::move(configPath)].push_back(config);
+            }
+        }
+    }
+}
+
+// Configurações de cada config.json, agrupadas pelo caminho. Arquivos do manifesto que nenhuma configuração usa
+// mais entram com a lista vazia (recebem o "kill switch").
+// Com edições pontuais só entram os arquivos afetados: os que as instâncias marcadas usavam no último salvamento
+// e os que usam agora. Como um config.json reúne as configurações de todas as instâncias que apontam para ele,
+// essas outras instâncias também são percorridas, na mesma ordem da geração completa.
+AnimationManager::ConditionFileSelection AnimationManager::CollectConditionFileUpdates() {
+    ConditionFileSelection selection;
+    selection.full = _dirty.all;
+
+    std::set<std::filesystem::path> affected;
+    std::set<InstanceKey> toCollect;
+    if (!selection.full) {
+        affected = _dirty.files;
+        toCollect = _dirty.instances;
+        std::map<std::filesystem::path, std::vector<FileSaveConfig>> scratch;
+        for (const auto& key : _dirty.instances) {
+            const auto category = _categories.find(key.first);
+            if (category == _categories.end()) continue;
+            if (const auto old = _filesByInstance.find(key); old != _filesByInstance.end()) {
+                affected.insert(old->second.begin(), old->second.end());
+            }
+            std::set<std::filesystem::path> current;
+            CollectInstanceConfigs(category->second, key.second, scratch, current);
+            affected.insert(current.begin(), current.end());
+        }
+        for (const auto& [key, files] : _filesByInstance) {
+            if (toCollect.contains(key)) continue;
+            if (std::ranges::any_of(files, [&](const auto& path) { return affected.contains(path); })) {
+                toCollect.insert(key);
+            }
+        }
+    }
+
+    auto& fileUpdates = selection.fileUpdates;
     // 1. Loop através de cada CATEGORIA de arma
     for (auto& pair : _categories) {
         WeaponCategory& category = pair.second;
 
         // 2. Loop através de cada uma das 4 INSTÂNCIAS
         for (int i = 0; i < 4; ++i) {
-            CategoryInstance& instance = category.instances[i];
-            int playlistParentCounter = 1;  // Contador para os itens "Pai"
-            int lastParentOrder = 0;        // Armazena o número do último "Pai"
-            // 3. Loop através dos MOVESETS (ModInstance) na instância
-            for (size_t mod_i = 0; mod_i < instance.modInstances.size(); ++mod_i) {
-                ModInstance& modInstance = instance.modInstances[mod_i];
-
-                // 4. Loop através dos SUB-MOVESETS (SubAnimationInstance)
-                for (size_t sub_j = 0; sub_j < modInstance.subAnimationInstances.size(); ++sub_j) {
-                    SubAnimationInstance& subInstance = modInstance.subAnimationInstances[sub_j];
-
-                    // Salva apenas se tanto o sub-moveset quanto o moveset pai estiverem selecionados
-                    if (modInstance.isSelected && subInstance.isSelected) {
-                        const auto& sourceMod = _allMods[subInstance.sourceModIndex];
-                        const auto& sourceSubAnim = sourceMod.subAnimations[subInstance.sourceSubAnimIndex];
-
-                        FileSaveConfig config;
-                        config.instance_index = i + 1;  // Instância é 1-4
-                        config.category = &category;
-
-                        // Copia o estado de todas as checkboxes para o config
-                        config.pFront = subInstance.pFront;
-                        config.pBack = subInstance.pBack;
-                        config.pLeft = subInstance.pLeft;
-                        config.pRight = subInstance.pRight;
-                        config.pFrontRight = subInstance.pFrontRight;
-                        config.pFrontLeft = subInstance.pFrontLeft;
-                        config.pBackRight = subInstance.pBackRight;
-                        config.pBackLeft = subInstance.pBackLeft;
-                        config.pRandom = subInstance.pRandom;
-
-                        // Determina se é um "Pai" (nenhuma checkbox de direção marcada) ou "Filho"
-                        bool isParent = !(config.pFront || config.pBack || config.pLeft || config.pRight ||
-                                          config.pFrontRight || config.pFrontLeft || config.pBackRight ||
-                                          config.pBackLeft || config.pRandom || config.pDodge);
-
-                        config.isParent = isParent;
-
-                        if (isParent) {
-                            lastParentOrder = playlistParentCounter;
-                            config.order_in_playlist = playlistParentCounter++;
-                        } else {
-                            // Filhos herdam o número do último pai encontrado
-                            config.order_in_playlist = lastParentOrder;
-                        }
+            InstanceKey key(category.name, i);
+            if (!selection.full && !toCollect.contains(key)) continue;
+            CollectInstanceConfigs(category, i, fileUpdates, selection.filesByInstance[std::move(key)]);
+        }
+    }
 
-                        // Adiciona a configuração ao mapa, agrupada pelo caminho do arquivo
-                        fileUpdates[sourceSubAnim.path].push_back(config);
-                    }
-                }
+    if (!selection.full) {
+        // Instâncias vizinhas trazem também arquivos que não mudaram: ficam de fora.
+        std::erase_if(fileUpdates, [&](const auto& entry) { return !affected.contains(entry.first); });
+        for (const auto& path : affected) {
+            if (!fileUpdates.contains(path) && _managedFiles.contains(path)) {
+                fileUpdates[path] = {};  // Ninguém usa mais: desativação
             }
         }
+        return selection;
     }
+
     // Agora, verifique todos os arquivos que já gerenciamos.
     // Se algum deles não estiver na lista de atualizações ativas,
     // significa que ele foi removido e precisa ser desativado.
-    for (const auto& managedPath : _managedFiles) {
+    for (const auto& [managedPath, record] : _managedFiles) {
         // Se o arquivo não está no mapa de atualizações, adicione-o com um vetor vazio.
         if (fileUpdates.find(managedPath) == fileUpdates.end()) {
             fileUpdates[managedPath] = {};  // Adiciona para a fila de desativação
         }
     }
-    // Adiciona todos os novos arquivos à lista de gerenciados para o futuro.
-    for (const auto& pair : fileUpdates) {
-        _managedFiles.insert(pair.first);
+    return selection;
+}
+
+// A escrita dos config.json sai da thread da UI: uma thread coordena e o pool escreve os arquivos.
+void AnimationManager::StartConditionFileJobs(
+    std::map<std::filesystem::path, std::vector<FileSaveConfig>> fileUpdates, bool dryRun) {
+    auto job = std::make_shared<SaveJob>();
+    job->dryRun = dryRun;
+    job->files.assign(std::make_move_iterator(fileUpdates.begin()), std::make_move_iterator(fileUpdates.end()));
+    job->results.resize(job->files.size());
+    job->records.resize(job->files.size());
+    job->notStarted.resize(job->files.size(), 0);
+    job->knownRecords.reserve(job->files.size());
+    for (const auto& [path, configs] : job->files) {
+        const auto known = _managedFiles.find(path);
+        job->knownRecords.push_back(known != _managedFiles.end() ? std::optional(known->second) : std::nullopt);
     }
+    job->options.preserveConditions = _preserveConditions;
+    job->options.optimizeConditions = _optimizeConditions;
+    job->options.packedStateKey = StateKey::IsEnabled();
+    if (!dryRun) job->manifest = _managedFiles;
+    _saveJob = job;
+    _lastSaveSummary.reset();
+    UpdateSelfWrittenPaths();
+
+    _saveJobFuture = std::async(std::launch::async, [this, job] {
+        Diagnostics::ScopedPhase phase(Diagnostics::Phase::ConditionGeneration);
+        const auto start = std::chrono::steady_clock::now();
+        {
+            ThreadPool pool;
+            for (size_t i = 0; i < job->files.size(); ++i) {
+                pool.Submit([this, job, i] {
+                    auto& result = job->results[i];
+                    if (job->cancelRequested) {
+                        job->notStarted[i] = 1;
+                    } else {
+                        const auto& [path, configs] = job->files[i];
+                        const auto& known = job->knownRecords[i];
+                        try {
+                            result = PlanConditionFile(path, configs, job->options, known ? &*known : nullptr);
+                            if (!job->dryRun) ExecuteConditionFilePlan(path, result, job->batch);
+                        } catch (const std::exception& e) {
+                            result.blockHash.reset();
+                            result.error = e.what();
+                        }
+                        // O texto gerado já está no lote (ou foi só simulado): não fica na memória até o fim.
+                        std::string().swap(result.content);
+                    }
+                    job->completed++;
+                });
+            }
+            pool.Wait();
+        }
+        // Todos os arquivos gerados: um único passo de durabilidade e as trocas pelos temporários.
+        const auto failures = job->batch.Commit();
+        if (!failures.empty()) {
+            const std::map<std::filesystem::path, std::string> failedByPath(failures.begin(), failures.end());
+            for (size_t i = 0; i < job->files.size(); ++i) {
+                const auto failed = failedByPath.find(job->files[i].first);
+                if (failed == failedByPath.end()) continue;
+                job->results[i].blockHash.reset();
+                job->results[i].error = failed->second;
+            }
+        }
+        if (!job->dryRun) {
+            // Hash do conteúdo gerenciado e carimbo do arquivo (escrito ou não), já com os arquivos no lugar.
+            // Um stat por arquivo e a escrita do manifesto ficam aqui, fora da thread da UI.
+            for (size_t i = 0; i < job->files.size(); ++i) {
+                const auto& result = job->results[i];
+                if (job->notStarted[i] || !result.blockHash) continue;
+                ManagedFileRecord record;
+                record.blockHash = *result.blockHash;
+                ManagedManifest::Stamp(job->files[i].first, record);
+                job->manifest[job->files[i].first] = record;
+                job->records[i] = record;
+            }
+            ManagedManifest::Save(job->manifest);
+        }
+        job->elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        job->finished.store(true, std::memory_order_release);
+    });
+}
 
-    SKSE::log::info("{} arquivos de configuração serão modificados.", fileUpdates.size());
-    for (const auto& updateEntry : fileUpdates) {
-        UpdateOrCreateJson(updateEntry.first, updateEntry.second);
+// Roda na thread da UI quando o trabalho termina: atualiza o manifesto e monta o resumo.
+void AnimationManager::FinishConditionFileJobs() {
+    auto job = std::move(_saveJob);
+    _saveJobFuture.get();
+
+    SaveSummary summary;
+    summary.elapsedMs = job->elapsedMs;
+    summary.cancelled = job->cancelRequested;
+    summary.dryRun = job->dryRun;
+    for (size_t i = 0; i < job->files.size(); ++i) {
+        const auto& path = job->files[i].first;
+        const auto& result = job->results[i];
+        if (job->notStarted[i]) {
+            summary.notStarted++;
+            if (!job->dryRun) _dirty.files.insert(path);  // Fica para o próximo salvamento
+            continue;
+        }
+        if (!result.error.empty()) summary.errors.emplace_back(path, result.error);
+        if (!result.blockHash) {
+            summary.failed++;
+            if (!job->dryRun) _dirty.files.insert(path);
+            continue;
+        }
+        summary.conditionNodesBefore += result.conditionNodesBefore;
+        summary.conditionNodesAfter += result.conditionNodesAfter;
+        if (job->records[i]) _managedFiles[path] = *job->records[i];
+        if (result.change == ConditionFileChange::Unchanged) {
+            summary.unchanged++;
+        } else {
+            summary.written++;
+            summary.bytesWritten += result.bytesWritten;
+            summary.bytesDelta +=
+                static_cast<std::int64_t>(result.newBytes) - static_cast<std::int64_t>(result.oldBytes);
+            summary.changes.emplace_back(path, result);
+        }
+    }
+    UpdateSelfWrittenPaths();
+    if (job->dryRun) {
+        SKSE::log::info("Simulação: {} arquivos mudariam ({:+} bytes), {} sem mudanças, {} com falha.",
+                        summary.written, summary.bytesDelta, summary.unchanged, summary.failed);
+        for (const auto& [path, error] : summary.errors) {
+            SKSE::log::error("{}: {}", path.string(), error);
+        }
+        _lastSaveSummary = std::move(summary);
+        return;
     }
 
-    SKSE::log::info("Salvamento global concluído.");
-    RE::DebugNotification("Todas as configurações foram salvas!");
+    SKSE::log::info(
+        "Salvamento concluído{}: {} escritos ({} KB), {} sem mudanças, {} com falha, {} cancelados, {:.0f} ms.",
+        summary.cancelled ? " (cancelado)" : "", summary.written, summary.bytesWritten / 1024, summary.unchanged,
+        summary.failed, summary.notStarted, summary.elapsedMs);
+    SKSE::log::info("Nós de condição gerados: {} (sem otimização: {}).", summary.conditionNodesAfter,
+                    summary.conditionNodesBefore);
+    for (const auto& [path, error] : summary.errors) {
+        SKSE::log::error("{}: {}", path.string(), error);
+    }
+    RE::DebugNotification(summary.cancelled ? "Salvamento cancelado." : "Todas as configurações foram salvas!");
+    _lastSaveSummary = std::move(summary);
 }
 
-void AnimationManager::UpdateOrCreateJson(const std::filesystem::path& jsonPath,
-                                          const std::vector<FileSaveConfig>& configs) {
-    rapidjson::Document doc;
-    std::ifstream fileStream(jsonPath);
-    if (fileStream) {
-        std::string jsonContent((std::istreambuf_iterator<char>(fileStream)), std::istreambuf_iterator<char>());
-        fileStream.close();
-        if (doc.Parse(jsonContent.c_str()).HasParseError()) {
-            SKSE::log::error("Erro de Parse ao ler {}. Criando um novo arquivo.", jsonPath.string());
-            doc.SetObject();
+void AnimationManager::DrawSaveStatus() {
+    if (_saveJob) {
+        if (_saveJob->finished.load(std::memory_order_acquire)) {
+            FinishConditionFileJobs();
+        } else {
+            const auto total = _saveJob->files.size();
+            const auto completed = _saveJob->completed.load();
+            const std::string overlay = completed < total  ? std::format("{} / {} arquivos", completed, total)
+                                        : _saveJob->dryRun ? std::string("Concluindo...")
+                                                           : std::string("Gravando no disco...");
+            ImGui::ProgressBar(total > 0 ? static_cast<float>(completed) / static_cast<float>(total) : 0.0f,
+                               ImVec2(-1.0f, 0.0f), overlay.c_str());
+            if (_saveJob->cancelRequested) {
+                ImGui::Text("Cancelando...");
+            } else if (ImGui::Button("Cancelar")) {
+                _saveJob->cancelRequested = true;
+            }
+            return;
         }
+    }
+
+    if (!_lastSaveSummary) return;
+    const auto& summary = *_lastSaveSummary;
+    if (summary.dryRun) {
+        ImGui::Text("Simulação%s: %zu mudariam (%+lld bytes), %zu sem mudanças, %zu com falha, %.0f ms",
+                    summary.cancelled ? " (cancelada)" : "", summary.written,
+                    static_cast<long long>(summary.bytesDelta), summary.unchanged, summary.failed,
+                    summary.elapsedMs);
     } else {
-        doc.SetObject();
+        ImGui::Text(
+            "Último salvamento%s: %zu escritos (%llu KB), %zu sem mudanças, %zu com falha, %zu cancelados, %.0f ms",
+            summary.cancelled ? " (cancelado)" : "", summary.written,
+            static_cast<unsigned long long>(summary.bytesWritten / 1024), summary.unchanged, summary.failed,
+            summary.notStarted, summary.elapsedMs);
+    }
+    ImGui::Text("Nós de condição: %zu (sem otimização: %zu)", summary.conditionNodesAfter,
+                summary.conditionNodesBefore);
+    if (!summary.errors.empty() && ImGui::TreeNode("Erros", "Erros (%zu)", summary.errors.size())) {
+        for (const auto& [path, error] : summary.errors) {
+            ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", path.string().c_str());
+            ImGui::Text("    %s", error.c_str());
+        }
+        ImGui::TreePop();
     }
+    DrawSavePlan(summary);
+}
 
-    if (!doc.IsObject()) doc.SetObject();
-    auto& allocator = doc.GetAllocator();
+const char* AnimationManager::ChangeLabel(ConditionFileChange change) {
+    switch (change) {
+        case ConditionFileChange::Create:
+            return "Criar";
+        case ConditionFileChange::Modify:
+            return "Modificar";
+        case ConditionFileChange::KillSwitch:
+            return "Kill switch";
+        default:
+            return "Sem mudanças";
+    }
+}
+
+const char* AnimationManager::ChangeId(ConditionFileChange change) {
+    switch (change) {
+        case ConditionFileChange::Create:
+            return "create";
+        case ConditionFileChange::Modify:
+            return "modify";
+        case ConditionFileChange::KillSwitch:
+            return "kill_switch";
+        default:
+            return "unchanged";
+    }
+}
+
+// Lista dos arquivos que mudam (ou mudariam) no último salvamento ou simulação.
+void AnimationManager::DrawSavePlan(const SaveSummary& summary) {
+    if (summary.changes.empty()) return;
+    if (!ImGui::TreeNode("Mudancas", "Mudanças (%zu)", summary.changes.size())) return;
+
+    if (ImGui::Button("Exportar JSON")) {
+        if (ExportSavePlan(summary)) {
+            RE::DebugNotification("Plano exportado.");
+        }
+    }
+    ImGui::SameLine();
+    ImGui::TextDisabled("%s", kSavePlanPath);
+
+    constexpr int kColumns = 4;
+    const auto flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY;
+    if (ImGui::BeginTable("save_plan_table", kColumns, flags, ImVec2(0.0f, 300.0f))) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Arquivo");
+        ImGui::TableSetupColumn("Ação");
+        ImGui::TableSetupColumn("Prioridade");
+        ImGui::TableSetupColumn("Bytes");
+        ImGui::TableHeadersRow();
+
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(summary.changes.size()));
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+                const auto& [path, change] = summary.changes[static_cast<std::size_t>(row)];
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Text("%s", path.string().c_str());
+                ImGui::TableNextColumn();
+                ImGui::Text("%s", ChangeLabel(change.change));
+                ImGui::TableNextColumn();
+                if (change.oldPriority && *change.oldPriority != change.newPriority) {
+                    ImGui::Text("%d -> %d", *change.oldPriority, change.newPriority);
+                } else {
+                    ImGui::Text("%d", change.newPriority);
+                }
+                ImGui::TableNextColumn();
+                ImGui::Text("%llu -> %llu (%+lld)", static_cast<unsigned long long>(change.oldBytes),
+                            static_cast<unsigned long long>(change.newBytes),
+                            static_cast<long long>(change.newBytes) - static_cast<long long>(change.oldBytes));
+            }
+        }
+        ImGui::EndTable();
+    }
+    ImGui::TreePop();
+}
+
+bool AnimationManager::ExportSavePlan(const SaveSummary& summary) {
+    rapidjson::StringBuffer buffer;
+    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+    auto writePath = [&](const std::filesystem::path& path) {
+        const auto pathUtf8 = path.u8string();
+        writer.Key("path");
+        writer.String(reinterpret_cast<const char*>(pathUtf8.data()),
+                      static_cast<rapidjson::SizeType>(pathUtf8.size()));
+    };
+    writer.StartObject();
+    writer.Key("dryRun");
+    writer.Bool(summary.dryRun);
+    writer.Key("unchanged");
+    writer.Uint64(summary.unchanged);
+    writer.Key("failed");
+    writer.Uint64(summary.failed);
+    writer.Key("bytesDelta");
+    writer.Int64(summary.bytesDelta);
+    writer.Key("files");
+    writer.StartArray();
+    for (const auto& [path, change] : summary.changes) {
+        writer.StartObject();
+        writePath(path);
+        writer.Key("action");
+        writer.String(ChangeId(change.change));
+        writer.Key("oldPriority");
+        if (change.oldPriority) {
+            writer.Int(*change.oldPriority);
+        } else {
+            writer.Null();
+        }
+        writer.Key("newPriority");
+        writer.Int(change.newPriority);
+        writer.Key("oldBytes");
+        writer.Uint64(change.oldBytes);
+        writer.Key("newBytes");
+        writer.Uint64(change.newBytes);
+        if (!change.error.empty()) {
+            writer.Key("warning");
+            writer.String(change.error.c_str());
+        }
+        writer.EndObject();
+    }
+    writer.EndArray();
+    writer.Key("errors");
+    writer.StartArray();
+    for (const auto& [path, error] : summary.errors) {
+        writer.StartObject();
+        writePath(path);
+        writer.Key("error");
+        writer.String(error.c_str());
+        writer.EndObject();
+    }
+    writer.EndArray();
+    writer.EndObject();
+
+    const std::filesystem::path planPath(kSavePlanPath);
+    std::error_code ec;
+    std::filesystem::create_directories(planPath.parent_path(), ec);
+    std::string error;
+    if (!AtomicFileBatch::Write(planPath, std::string_view(buffer.GetString(), buffer.GetSize()), error)) {
+        SKSE::log::error("Falha ao exportar o plano de salvamento: {} ({})", kSavePlanPath, error);
+        return false;
+    }
+    SKSE::log::info("Plano de salvamento exportado para {}.", kSavePlanPath);
+    return true;
+}
+
+AnimationManager::ConditionFileResult AnimationManager::PlanConditionFile(const std::filesystem::path& jsonPath,
+                                                                         const std::vector<FileSaveConfig>& configs,
+                                                                         const ConditionWriteOptions& options,
+                                                                         const ManagedFileRecord* knownRecord) {
+    ConditionFileResult result;
 
     // ---> INÍCIO DA NOVA LÓGICA DE PRIORIDADE <---
 
-    // 1. Lê a prioridade base do arquivo. Se não existir, usa um valor padrão (ex: 0).
+    // 1. Prioridade base. A leitura da prioridade do arquivo está desativada, então ela não depende do disco.
     int basePriority = 200000000;
-    if (doc.HasMember("priority") && doc["priority"].IsInt()) {
-        basePriority;  //= doc["priority"].GetInt();
-    }
 
     // 2. Determina se esta animação está sendo usada como "mãe" em QUALQUER uma das configurações.
     bool isUsedAsParent = false;
@@ -723,212 +1696,105 @@ void AnimationManager::UpdateOrCreateJson(const std::filesystem::path& jsonPath,
     // 3. Define a prioridade final. Se for usada como mãe, mantém a base.
     //    Se for usada APENAS como filha, incrementa a prioridade para garantir que ela sobrescreva a mãe.
     int finalPriority = isUsedAsParent ? basePriority : basePriority + 1;
+    result.newPriority = finalPriority;
+
+    // Passo 1: A árvore de condições, como sempre foi gerada (um AND por configuração), e a versão fatorada.
+    // Só configurações com posição na playlist geram condições; sem nenhuma configuração, vai o "kill switch".
+    const ConditionIR::Node naiveTree = ConditionIR::BuildTree(configs, options.packedStateKey);
+    const bool hasManagedBlock = !naiveTree.children.empty();
+    std::optional<ConditionIR::Node> optimizedTree;
+    if (hasManagedBlock && options.optimizeConditions) optimizedTree = ConditionIR::Optimize(naiveTree);
+    const ConditionIR::Node& tree = optimizedTree ? *optimizedTree : naiveTree;
+    if (hasManagedBlock) {
+        result.conditionNodesBefore = ConditionIR::CountNodes(naiveTree);
+        result.conditionNodesAfter = ConditionIR::CountNodes(tree);
+    }
+    std::string scratch;
 
-    // 4. Aplica a prioridade final ao documento JSON.
-    if (doc.HasMember("priority")) {
-        doc["priority"].SetInt(finalPriority);
+    // Passo 2: O bloco em forma compacta, só para o hash.
+    rapidjson::StringBuffer compactBlock;
+    if (hasManagedBlock) {
+        rapidjson::Writer<rapidjson::StringBuffer> compactWriter(compactBlock);
+        ConditionEmitter::WriteManagedBlock(compactWriter, tree, scratch);
     } else {
-        doc.AddMember("priority", finalPriority, allocator);
+        rapidjson::Writer<rapidjson::StringBuffer> compactWriter(compactBlock);
+        compactWriter.Null();
     }
 
-    rapidjson::Value oldConditions(rapidjson::kArrayType);
-    if (_preserveConditions && doc.HasMember("conditions") && doc["conditions"].IsArray()) {
-        for (auto& cond : doc["conditions"].GetArray()) {
-            if (cond.IsObject() && cond.HasMember("comment") && cond["comment"] == "OAR_CYCLE_MANAGER_CONDITIONS") {
-                // Pula o nosso próprio bloco ao preservar, pois ele será reescrito
-                continue;
-            }
-            rapidjson::Value c;
-            c.CopyFrom(cond, allocator);
-            oldConditions.PushBack(c, allocator);
+    // Nada mudou desde a última escrita? Primeiro pelo manifesto (sem abrir o arquivo), depois pelo conteúdo.
+    const std::uint64_t outputHash = ConditionEmitter::HashManagedOutput(
+        Fnv1a64(std::string_view(compactBlock.GetString(), compactBlock.GetSize())), finalPriority,
+        options.preserveConditions);
+    if (knownRecord && knownRecord->blockHash == outputHash) {
+        ManagedFileRecord current;
+        if (ManagedManifest::Stamp(jsonPath, current) && current.size == knownRecord->size &&
+            current.mtime == knownRecord->mtime) {
+            result.blockHash = outputHash;
+            result.oldPriority = finalPriority;
+            result.oldBytes = result.newBytes = current.size;
+            return result;
         }
     }
 
-    if (doc.HasMember("conditions")) {
-        doc["conditions"].SetArray();
-    } else {
-        doc.AddMember("conditions", rapidjson::Value(rapidjson::kArrayType), allocator);
+    // Primeira passada pelo arquivo atual: só classifica as condições e calcula o hash do nosso bloco.
+    const auto existing = ConfigRewriter::Scan(jsonPath);
+    result.oldPriority = existing.priority;
+    result.oldBytes = existing.bytesRead;
+    if (!existing.error.empty()) {
+        // O arquivo ainda é escrito (do zero); o erro aparece no resumo do salvamento.
+        result.error = existing.error + ". O arquivo é recriado do zero.";
+    } else if (ConditionEmitter::MatchesManagedOutput(existing, outputHash, options.preserveConditions)) {
+        result.blockHash = outputHash;
+        result.newBytes = existing.bytesRead;
+        return result;
     }
-    rapidjson::Value& conditions = doc["conditions"];
 
-    if (_preserveConditions && !oldConditions.Empty()) {
-        rapidjson::Value oldConditionsBlock(rapidjson::kObjectType);
-        oldConditionsBlock.AddMember("condition", "OR", allocator);
-        oldConditionsBlock.AddMember("comment", "Old Conditions", allocator);
-        oldConditionsBlock.AddMember("Conditions", oldConditions, allocator);
-        conditions.PushBack(oldConditionsBlock, allocator);
+    // Segunda passada: o conteúdo de terceiros é copiado em streaming e o bloco gerenciado sai dos templates.
+    ConfigRewriter::BlockWriter writeManagedBlock;
+    if (hasManagedBlock) {
+        writeManagedBlock = [&](ConfigRewriter::OutputWriter& writer) {
+            ConditionEmitter::WriteManagedBlock(writer, tree, scratch);
+        };
     }
-
-    // Passo 1: Mapear todas as direções usadas pelas "filhas" para cada "mãe" (playlist).
-    // A chave do mapa é o 'order_in_playlist', o valor é um set com os números das direções.
-    std::map<int, std::set<int>> childDirectionsByPlaylist;
-    for (const auto& config : configs) {
-        if (!config.isParent) {
-            int playlistId = config.order_in_playlist;
-            if (playlistId > 0) {  // Garante que é uma filha de uma playlist válida
-                if (config.pFront) childDirectionsByPlaylist[playlistId].insert(1);
-                if (config.pFrontRight) childDirectionsByPlaylist[playlistId].insert(2);
-                if (config.pRight) childDirectionsByPlaylist[playlistId].insert(3);
-                if (config.pBackRight) childDirectionsByPlaylist[playlistId].insert(4);
-                if (config.pBack) childDirectionsByPlaylist[playlistId].insert(5);
-                if (config.pBackLeft) childDirectionsByPlaylist[playlistId].insert(6);
-                if (config.pLeft) childDirectionsByPlaylist[playlistId].insert(7);
-                if (config.pFrontLeft) childDirectionsByPlaylist[playlistId].insert(8);
-            }
-        }
+    rapidjson::StringBuffer buffer;
+    if (!ConfigRewriter::Rewrite(jsonPath, existing, finalPriority, options.preserveConditions, writeManagedBlock,
+                                 buffer, result.error)) {
+        return result;
     }
-
-    if (!configs.empty()) {
-        rapidjson::Value masterOrBlock(rapidjson::kObjectType);
-        masterOrBlock.AddMember("condition", "OR", allocator);
-        masterOrBlock.AddMember("comment", "OAR_CYCLE_MANAGER_CONDITIONS", allocator);
-        rapidjson::Value innerConditions(rapidjson::kArrayType);
-
-        for (const auto& config : configs) {
-            rapidjson::Value categoryAndBlock(rapidjson::kObjectType);
-            categoryAndBlock.AddMember("condition", "AND", allocator);
-            rapidjson::Value andConditions(rapidjson::kArrayType);
-
-            {
-                rapidjson::Value actorBase(rapidjson::kObjectType);
-                actorBase.AddMember("condition", "IsActorBase", allocator);
-                rapidjson::Value actorBaseParams(rapidjson::kObjectType);
-                actorBaseParams.AddMember("pluginName", "Skyrim.esm", allocator);
-                actorBaseParams.AddMember("formID", "7", allocator);
-                actorBase.AddMember("Actor base", actorBaseParams, allocator);
-                andConditions.PushBack(actorBase, allocator);
-            }
-            {
-                rapidjson::Value equippedType(rapidjson::kObjectType);
-                equippedType.AddMember("condition", "IsEquippedType", allocator);
-                rapidjson::Value typeVal(rapidjson::kObjectType);
-                typeVal.AddMember("value", config.category->equippedTypeValue, allocator);
-                equippedType.AddMember("Type", typeVal, allocator);
-                equippedType.AddMember("Left hand", false, allocator);  // Condição da mão direita (sempre presente)
-                andConditions.PushBack(equippedType, allocator);
-            }
-
-            // MUDANÇA: Substituído o caso especial de adagas por uma verificação genérica "isDualWield".
-            if (config.category->isDualWield) {
-                rapidjson::Value equippedTypeL(rapidjson::kObjectType);
-                equippedTypeL.AddMember("condition", "IsEquippedType", allocator);
-                rapidjson::Value typeValL(rapidjson::kObjectType);
-                typeValL.AddMember("value", config.category->equippedTypeValue, allocator);
-                equippedTypeL.AddMember("Type", typeValL, allocator);
-                equippedTypeL.AddMember("Left hand", true, allocator);  // Adiciona a condição da mão esquerda
-                andConditions.PushBack(equippedTypeL, allocator);
-            }
-
-            AddCompareValuesCondition(andConditions, "cycle_instance", config.instance_index, allocator);
-
-            // Apenas adiciona a condição de ordem se for um "Pai"
-            if (config.order_in_playlist > 0) {
-                AddCompareValuesCondition(andConditions, "testarone", config.order_in_playlist, allocator);
-                if (config.isParent) {
-                    // LÓGICA DA MÃE: Adicionar condições negadas para cada direção de filha.
-                    const auto& childDirs = childDirectionsByPlaylist[config.order_in_playlist];
-                    if (!childDirs.empty()) {
-                        for (int dirValue : childDirs) {
-                            AddNegatedCompareValuesCondition(andConditions, "DirecionalCycleMoveset", dirValue,
-                                                             allocator);
-                        }
-                    }
-                } else {
-                    // ---> LÓGICA DE ATIVAÇÃO CORRIGIDA (RANDOM + DIRECIONAL) <---
-
-                    // 1. Adiciona a condição Random se a checkbox estiver marcada.
-                    //    Esta condição é adicionada diretamente ao bloco AND principal.
-                    if (config.pRandom) {
-                        AddRandomCondition(andConditions, config.order_in_playlist, allocator);
-                    }
-
-                    // 2. Coleta as condições direcionais, independentemente da condição Random.
-                    rapidjson::Value directionalOrConditions(rapidjson::kArrayType);
-                    if (config.pFront)
-                        AddCompareValuesCondition(directionalOrConditions, "DirecionalCycleMoveset", 1, allocator);
-                    if (config.pFrontRight)
-                        AddCompareValuesCondition(directionalOrConditions, "DirecionalCycleMoveset", 2, allocator);
-                    if (config.pRight)
-                        AddCompareValuesCondition(directionalOrConditions, "DirecionalCycleMoveset", 3, allocator);
-                    if (config.pBackRight)
-                        AddCompareValuesCondition(directionalOrConditions, "DirecionalCycleMoveset", 4, allocator);
-                    if (config.pBack)
-                        AddCompareValuesCondition(directionalOrConditions, "DirecionalCycleMoveset", 5, allocator);
-                    if (config.pBackLeft)
-                        AddCompareValuesCondition(directionalOrConditions, "DirecionalCycleMoveset", 6, allocator);
-                    if (config.pLeft)
-                        AddCompareValuesCondition(directionalOrConditions, "DirecionalCycleMoveset", 7, allocator);
-                    if (config.pFrontLeft)
-                        AddCompareValuesCondition(directionalOrConditions, "DirecionalCycleMoveset", 8, allocator);
-
-                    // 3. Se houver alguma condição direcional, cria o bloco OR e o adiciona
-                    //    também ao bloco AND principal.
-                    if (!directionalOrConditions.Empty()) {
-                        rapidjson::Value orBlock(rapidjson::kObjectType);
-                        orBlock.AddMember("condition", "OR", allocator);
-                        orBlock.AddMember("Conditions", directionalOrConditions, allocator);
-                        andConditions.PushBack(orBlock, allocator);
-                    }
-                }
-
-                categoryAndBlock.AddMember("Conditions", andConditions, allocator);
-                innerConditions.PushBack(categoryAndBlock, allocator);
-            }
-        }
-        if (!innerConditions.Empty()) {
-            masterOrBlock.AddMember("Conditions", innerConditions, allocator);
-            conditions.PushBack(masterOrBlock, allocator);
-        }
+#ifndef NDEBUG
+    if (auto violation = ConditionEmitter::CheckGeneratedOutput(std::string_view(buffer.GetString(), buffer.GetSize()),
+                                                                existing, finalPriority, hasManagedBlock, outputHash,
+                                                                options.preserveConditions);
+        !violation.empty()) {
+        SKSE::log::error("{}: {}", jsonPath.string(), violation);
+        if (!result.error.empty()) result.error += " ";
+        result.error += "Verificação de consistência: " + violation + ".";
     }
-    // Se a lista de configs ESTIVER VAZIA, geramos uma condição "kill switch".
-    else {
-        rapidjson::Value masterOrBlock(rapidjson::kObjectType);
-        masterOrBlock.AddMember("condition", "OR", allocator);
-        masterOrBlock.AddMember("comment", "OAR_CYCLE_MANAGER_CONDITIONS", allocator);
-        rapidjson::Value innerConditions(rapidjson::kArrayType);
+#endif
 
-        rapidjson::Value andBlock(rapidjson::kObjectType);
-        andBlock.AddMember("condition", "AND", allocator);
-        rapidjson::Value andConditions(rapidjson::kArrayType);
-
-        // Adiciona uma condição que sempre será falsa.
-        // Assumindo que a variável "CycleMovesetDisable" nunca será 1.0 no seu behavior graph.
-        AddCompareValuesCondition(andConditions, "CycleMovesetDisable", 1, allocator);
-
-        andBlock.AddMember("Conditions", andConditions, allocator);
-        innerConditions.PushBack(andBlock, allocator);
-        masterOrBlock.AddMember("Conditions", innerConditions, allocator);
-        conditions.PushBack(masterOrBlock, allocator);
+    if (configs.empty()) {
+        result.change = ConditionFileChange::KillSwitch;
+    } else {
+        result.change = existing.exists ? ConditionFileChange::Modify : ConditionFileChange::Create;
     }
+    result.content.assign(buffer.GetString(), buffer.GetSize());
+    result.newBytes = result.content.size();
+    result.blockHash = outputHash;
+    return result;
+}
+
+void AnimationManager::ExecuteConditionFilePlan(const std::filesystem::path& jsonPath, ConditionFileResult& plan,
+                                                AtomicFileBatch& batch) {
+    if (!plan.blockHash || plan.change == ConditionFileChange::Unchanged) return;
 
-    FILE* fp;
-    fopen_s(&fp, jsonPath.string().c_str(), "wb");
-    if (!fp) {
-        SKSE::log::error("Falha ao abrir o arquivo para escrita: {}", jsonPath.string());
+    // Vai para o temporário do lote; o arquivo real só é trocado no Commit, ao fim do salvamento.
+    std::string stageError;
+    if (!batch.Stage(jsonPath, plan.content, stageError)) {
+        plan.blockHash.reset();
+        plan.error = std::move(stageError);
         return;
     }
-    char writeBuffer[65536];
-    rapidjson::FileWriteStream os(fp, writeBuffer, sizeof(writeBuffer));
-    rapidjson::PrettyWriter<rapidjson::FileWriteStream> writer(os);
-    doc.Accept(writer);
-    fclose(fp);
-}
-
-// ATUALIZADO: Apenas uma pequena modificação para garantir que o 'value' é tratado como double.
-void AnimationManager::AddCompareValuesCondition(rapidjson::Value& conditionsArray, const std::string& graphVarName,
-                                                 int value, rapidjson::Document::AllocatorType& allocator) {
-    rapidjson::Value newCompare(rapidjson::kObjectType);
-    newCompare.AddMember("condition", "CompareValues", allocator);
-    newCompare.AddMember("requiredVersion", "1.0.0.0", allocator);
-    rapidjson::Value valueA(rapidjson::kObjectType);
-    valueA.AddMember("value", static_cast<double>(value), allocator);  // Garante que o valor é float/double no JSON
-    newCompare.AddMember("Value A", valueA, allocator);
-    newCompare.AddMember("Comparison", "==", allocator);
-    rapidjson::Value valueB(rapidjson::kObjectType);
-    valueB.AddMember("graphVariable", rapidjson::Value(graphVarName.c_str(), allocator), allocator);
-    valueB.AddMember("graphVariableType", "Float", allocator);
-    newCompare.AddMember("Value B", valueB, allocator);
-    conditionsArray.PushBack(newCompare, allocator);
+    plan.bytesWritten = plan.content.size();
 }
 
 // NOVA FUNÇÃO HELPER: Adiciona uma condição "CompareValues" para um valor booleano.
@@ -953,263 +1819,320 @@ void AnimationManager::AddCompareBoolCondition(rapidjson::Value& conditionsArray
     conditionsArray.PushBack(newCompare, allocator);
 }
 
-void AnimationManager::AddRandomCondition(rapidjson::Value& conditionsArray, int value,
-                                          rapidjson::Document::AllocatorType& allocator) {
-    rapidjson::Value newRandom(rapidjson::kObjectType);
-    newRandom.AddMember("condition", "Random", allocator);
-    newRandom.AddMember("requiredVersion", "2.3.0.0", allocator);
-
-    rapidjson::Value state(rapidjson::kObjectType);
-    state.AddMember("scope", "Local", allocator);
-    state.AddMember("shouldResetOnLoopOrEcho", true, allocator);
-    newRandom.AddMember("State", state, allocator);
-
-    rapidjson::Value minVal(rapidjson::kObjectType);
-    minVal.AddMember("value", static_cast<double>(value), allocator);
-    newRandom.AddMember("Minimum random value", minVal, allocator);
-
-    rapidjson::Value maxVal(rapidjson::kObjectType);
-    maxVal.AddMember("value", static_cast<double>(value), allocator);
-    newRandom.AddMember("Maximum random value", maxVal, allocator);
+// Toda a parte de user ta ca pra baixo
 
-    newRandom.AddMember("Comparison", "==", allocator);
+std::optional<size_t> AnimationManager::FindModIndexByName(std::string_view name) {
+    _nameIndex.Append(_allMods);
+    return _nameIndex.FindMod(name);
+}
 
-    rapidjson::Value numVal(rapidjson::kObjectType);
-    numVal.AddMember("graphVariable", "CycleMovesetsRandom", allocator);
-    numVal.AddMember("graphVariableType", "Float", allocator);
-    newRandom.AddMember("Numeric value", numVal, allocator);
+std::optional<size_t> AnimationManager::FindSubAnimIndexByName(size_t modIdx, std::string_view name) {
+    _nameIndex.Append(_allMods);
+    return _nameIndex.FindSubAnim(modIdx, name);
+}
 
-    conditionsArray.PushBack(newRandom, allocator);
+void AnimationManager::LinkSubAnimation(SubAnimationInstance& subInstance, size_t modIdx, size_t subIdx) {
+    const auto& sourceMod = _allMods[modIdx];
+    const auto& sourceSubAnim = sourceMod.subAnimations[subIdx];
+    subInstance.sourceModIndex = modIdx;
+    subInstance.sourceSubAnimIndex = subIdx;
+    subInstance.sourceModId = sourceMod.id;
+    subInstance.sourceSubId = sourceSubAnim.id;
+    subInstance.sourceModName = sourceMod.name;
+    subInstance.sourceSubName = sourceSubAnim.name;
 }
 
-// Toda a parte de user ta ca pra baixo
+std::optional<size_t> AnimationManager::ResolveMod(LibraryId::Id id, std::string_view name) {
+    _nameIndex.Append(_allMods);
+    if (auto modIdx = _nameIndex.FindModById(id)) return modIdx;
+    return _nameIndex.FindMod(name);
+}
 
-std::optional<size_t> AnimationManager::FindModIndexByName(const std::string& name) {
-    for (size_t i = 0; i < _allMods.size(); ++i) {
-        if (_allMods[i].name == name) {
-            return i;
+bool AnimationManager::ResolveSubAnimation(SubAnimationInstance& subInstance) {
+    _nameIndex.Append(_allMods);
+    if (const auto modIdx = _nameIndex.FindModById(subInstance.sourceModId)) {
+        if (const auto subIdx = _nameIndex.FindSubAnimById(*modIdx, subInstance.sourceSubId)) {
+            LinkSubAnimation(subInstance, *modIdx, *subIdx);
+            return true;
         }
     }
-    return std::nullopt;
+    const auto modIdx = _nameIndex.FindMod(subInstance.sourceModName);
+    if (!modIdx) return false;
+    const auto subIdx = _nameIndex.FindSubAnim(*modIdx, subInstance.sourceSubName);
+    if (!subIdx) return false;
+    LinkSubAnimation(subInstance, *modIdx, *subIdx);
+    return true;
 }
 
-std::optional<size_t> AnimationManager::FindSubAnimIndexByName(size_t modIdx, const std::string& name) {
-    if (modIdx >= _allMods.size()) return std::nullopt;
-    const auto& modDef = _allMods[modIdx];
-    for (size_t i = 0; i < modDef.subAnimations.size(); ++i) {
-        if (modDef.subAnimations[i].name == name) {
-            return i;
+// Só as referências cujo registro em _allMods não tem mais o ID guardado são procuradas de novo, pelo ID.
+// O que sumiu da biblioteca (moveset de usuário apagado) sai da stance.
+void AnimationManager::RelinkInstances() {
+    _nameIndex.Append(_allMods);
+    auto isStale = [this](size_t modIdx, LibraryId::Id modId) {
+        return modId != 0 && (modIdx >= _allMods.size() || _allMods[modIdx].id != modId);
+    };
+    auto relinkSub = [&](SubAnimationInstance& subInstance) {
+        const bool modMoved = isStale(subInstance.sourceModIndex, subInstance.sourceModId);
+        const bool subMoved =
+            !modMoved && subInstance.sourceSubId != 0 &&
+            (subInstance.sourceSubAnimIndex >= _allMods[subInstance.sourceModIndex].subAnimations.size() ||
+             _allMods[subInstance.sourceModIndex].subAnimations[subInstance.sourceSubAnimIndex].id !=
+                 subInstance.sourceSubId);
+        if (!modMoved && !subMoved) return true;
+        const auto modIdx = _nameIndex.FindModById(subInstance.sourceModId);
+        const auto subIdx = modIdx ? _nameIndex.FindSubAnimById(*modIdx, subInstance.sourceSubId) : std::nullopt;
+        if (!subIdx) return false;
+        LinkSubAnimation(subInstance, *modIdx, *subIdx);
+        return true;
+    };
+
+    size_t relinked = 0, dropped = 0;
+    for (auto& [name, category] : _categories) {
+        for (int i = 0; i < 4; ++i) {
+            bool changed = false;
+            std::erase_if(category.instances[i].modInstances, [&](ModInstance& modInstance) {
+                if (isStale(modInstance.sourceModIndex, modInstance.sourceModId)) {
+                    const auto modIdx = _nameIndex.FindModById(modInstance.sourceModId);
+                    if (!modIdx) {
+                        dropped++;
+                        changed = true;
+                        return true;
+                    }
+                    modInstance.sourceModIndex = *modIdx;
+                    relinked++;
+                }
+                changed |= std::erase_if(modInstance.subAnimationInstances, [&](SubAnimationInstance& subInstance) {
+                               return !relinkSub(subInstance);
+                           }) > 0;
+                return false;
+            });
+            if (changed) MarkInstanceDirty(category, i);
         }
     }
-    return std::nullopt;
+    for (auto& userMoveset : _userMovesets) {
+        std::erase_if(userMoveset.subAnimations,
+                      [&](SubAnimationInstance& subInstance) { return !relinkSub(subInstance); });
+    }
+    if (relinked > 0 || dropped > 0) {
+        SKSE::log::info("Referências atualizadas pelo ID: {} movesets reapontados, {} removidos.", relinked, dropped);
+    }
 }
 
 // --- NOVA FUNÇÃO DE CARREGAMENTO ---
 void AnimationManager::LoadStanceConfigurations() {
+    Diagnostics::ScopedPhase phase(Diagnostics::Phase::StanceLoad);
     SKSE::log::info("Iniciando carregamento das configurações de Stance...");
-    const std::filesystem::path stancesRoot = "Data/SKSE/Plugins/CycleMovesets/Stances";
 
-    if (!std::filesystem::exists(stancesRoot)) {
-        SKSE::log::info("Diretório de Stances não encontrado. Nenhuma configuração carregada.");
+    std::uint64_t snapshotHash = 0;
+    auto loadError = StanceStore::LoadError::Missing;
+    auto stances = StanceStore::Load(&snapshotHash, &loadError);
+    const bool fromStore = stances.has_value();
+    if (!stances && loadError == StanceStore::LoadError::Missing) {
+        // Só sem store: os arquivos antigos nunca voltam por cima de um store que existe.
+        std::vector<std::string> categoryNames;
+        for (const auto& [name, category] : _categories) categoryNames.push_back(category.name);
+        stances = StanceStore::ImportLegacy(categoryNames);
+        if (stances) {
+            // A importação acontece uma vez: daqui em diante só o store é lido. Os arquivos antigos ficam como
+            // estão.
+            SKSE::log::info("Stances do formato antigo serão gravadas em {}.", StanceStore::kStorePath);
+        } else {
+            SKSE::log::info("Nenhuma configuração de stance encontrada.");
+            stances.emplace();
+        }
+    } else if (!stances && loadError == StanceStore::LoadError::NewerVersion) {
+        SKSE::log::error("{} foi gravado por uma versão mais nova do plugin. Ele não será alterado: as stances "
+                         "desta sessão não serão salvas.",
+                         StanceStore::kStorePath);
+        _stanceStoreLocked = true;
         return;
+    } else if (!stances) {
+        // O arquivo ilegível sai do caminho antes de qualquer gravação; as stances começam vazias.
+        if (!StanceStore::Quarantine()) {
+            SKSE::log::error("{} está ilegível e não pôde ser movido. As stances desta sessão não serão salvas.",
+                             StanceStore::kStorePath);
+            _stanceStoreLocked = true;
+            return;
+        }
+        SKSE::log::error("{} está ilegível; foi movido para {} e as stances começam vazias.",
+                         StanceStore::kStorePath, StanceStore::kQuarantinePath);
+        stances.emplace();
+    }
+
+    // Edições feitas depois do último snapshot, reaplicadas sobre ele antes de montar a UI. Sem diário válido, o
+    // próximo quadro grava store + diário vazio.
+    bool journalOutdated = false;
+    auto ops = fromStore ? StanceJournal::Load(snapshotHash, &journalOutdated) : std::nullopt;
+    if (!ops || journalOutdated) _snapshotRequested = true;  // Registros novos não podem ir para um diário antigo
+    if (ops) {
+        const auto start = std::chrono::steady_clock::now();
+        // Uma operação que não cabe mais só invalida o resto da sua instância; as outras seguem sendo aplicadas.
+        const size_t recorded = ops->size();
+        size_t broken = 0;
+        _undoStack = StanceJournal::Replay(*stances, std::move(*ops), &broken);
+        const size_t applied = _undoStack.size();
+        _journalRecords = recorded;
+        const auto replayMs =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        SKSE::log::info("Diário de stances: {} edições reaplicadas em {:.1f} ms.", applied, replayMs);
+        if (applied < recorded) {
+            // O snapshot novo guarda o que foi aplicado e fecha o diário aqui.
+            SKSE::log::warn("{} edições do diário em {} instâncias não correspondem mais ao store e foram descartadas.",
+                            recorded - applied, broken);
+            _snapshotRequested = true;
+        }
     }
 
     // Limpa as instâncias atuais antes de carregar
+    MarkAllDirty();
     for (auto& pair : _categories) {
         for (auto& instance : pair.second.instances) {
             instance.modInstances.clear();
         }
     }
 
+    size_t resolved = 0;
+    _divergedInstances.clear();
     for (auto& categoryPair : _categories) {
         WeaponCategory& category = categoryPair.second;
-        std::filesystem::path categoryPath = stancesRoot / category.name;
-
-        if (!std::filesystem::exists(categoryPath)) continue;
+        const auto stored = stances->find(category.name);
+        if (stored == stances->end()) continue;
 
         for (int i = 0; i < 4; ++i) {
-            std::filesystem::path instancePath = categoryPath / ("Instance" + std::to_string(i + 1) + "_Cycle.json");
-            if (!std::filesystem::exists(instancePath)) continue;
-
-            FILE* fp;
-            fopen_s(&fp, instancePath.string().c_str(), "rb");
-            if (!fp) continue;
-
-            char readBuffer[65536];
-            rapidjson::FileReadStream is(fp, readBuffer, sizeof(readBuffer));
-            rapidjson::Document doc;
-            doc.ParseStream(is);
-            fclose(fp);
-
-            if (doc.HasParseError() || !doc.IsObject() || !doc.HasMember("stances") || !doc["stances"].IsArray()) {
-                SKSE::log::warn("Arquivo de stance mal formatado: {}", instancePath.string());
-                continue;
+            CategoryInstance& targetInstance = category.instances[i];
+            bool complete = true;
+            for (const auto& moveset : stored->second[i]) {
+                auto modInstance = InstantiateMoveset(moveset);
+                if (!modInstance) {
+                    complete = false;
+                    continue;
+                }
+                if (modInstance->subAnimationInstances.size() != moveset.animations.size()) complete = false;
+                resolved += modInstance->subAnimationInstances.size();
+                targetInstance.modInstances.push_back(std::move(*modInstance));
             }
+            if (!complete) _divergedInstances.insert(InstanceKey(category.name, i));
+        }
+    }
+    // O histórico aponta posições do store; onde a UI deixou itens de fora elas não valem para desfazer.
+    std::erase_if(_undoStack, [&](const StanceJournal::Op& op) {
+        return _divergedInstances.contains(InstanceKey(op.category, op.instance));
+    });
+    // Categorias que não existem mais continuam no store, para não perder nada se voltarem.
+    _storedStances = std::move(*stances);
+    SKSE::log::info("Carregamento das configurações de Stance concluído ({} animações resolvidas).", resolved);
+}
 
-            CategoryInstance& targetInstance = category.instances[i];
-            const auto& stances = doc["stances"].GetArray();
+std::optional<ModInstance> AnimationManager::InstantiateMoveset(const StanceStore::Moveset& moveset) {
+    auto modIdxOpt = ResolveMod(moveset.id, moveset.name);
+    if (!modIdxOpt) {
+        SKSE::log::warn("Moveset '{}' não encontrado na biblioteca ao carregar stance.", moveset.name);
+        return std::nullopt;
+    }
+    ModInstance modInstance;
+    modInstance.sourceModIndex = *modIdxOpt;
+    modInstance.sourceModId = _allMods[*modIdxOpt].id;
+    modInstance.isSelected = moveset.selected;
+    for (const auto& animation : moveset.animations) {
+        if (auto subInstance = InstantiateAnimation(animation)) {
+            modInstance.subAnimationInstances.push_back(std::move(*subInstance));
+        }
+    }
+    return modInstance;
+}
 
-            for (const auto& stanceJson : stances) {
-                if (!stanceJson.IsObject()) continue;
+std::optional<SubAnimationInstance> AnimationManager::InstantiateAnimation(const StanceStore::Animation& animation) {
+    SubAnimationInstance subInstance;
+    subInstance.sourceModName = animation.sourceModName;
+    subInstance.sourceSubName = animation.sourceSubName;
+    subInstance.sourceModId = animation.sourceModId;
+    subInstance.sourceSubId = animation.sourceSubId;
+
+    // Preenche os índices para uso em tempo de execução
+    if (!ResolveSubAnimation(subInstance)) {
+        SKSE::log::warn("Sub-animação '{}' não encontrada em '{}'", subInstance.sourceSubName,
+                        subInstance.sourceModName);
+        return std::nullopt;
+    }
 
-                ModInstance newModInstance;
-                std::string movesetName = stanceJson["name"].GetString();
+    // Carrega os estados dos checkboxes
+    StanceStore::UnpackFlags(animation.flags, subInstance);
+    subInstance.isSelected = animation.selected;
+    return subInstance;
+}
 
-                auto modIdxOpt = FindModIndexByName(movesetName);
-                if (!modIdxOpt) {
-                    SKSE::log::warn("Moveset '{}' não encontrado na biblioteca ao carregar stance.", movesetName);
-                    continue;
-                }
-                newModInstance.sourceModIndex = *modIdxOpt;
-
-                if (stanceJson.HasMember("animations") && stanceJson["animations"].IsArray()) {
-                    for (const auto& animJson : stanceJson["animations"].GetArray()) {
-                        SubAnimationInstance newSubInstance;
-                        newSubInstance.sourceModName = animJson["sourceModName"].GetString();
-                        newSubInstance.sourceSubName = animJson["sourceSubName"].GetString();
-
-                        // Preenche os índices para uso em tempo de execução
-                        auto subModIdxOpt = FindModIndexByName(newSubInstance.sourceModName);
-                        if (subModIdxOpt) {
-                            newSubInstance.sourceModIndex = *subModIdxOpt;
-                            auto subAnimIdxOpt = FindSubAnimIndexByName(*subModIdxOpt, newSubInstance.sourceSubName);
-                            if (subAnimIdxOpt) {
-                                newSubInstance.sourceSubAnimIndex = *subAnimIdxOpt;
-                            } else {
-                                SKSE::log::warn("Sub-animação '{}' não encontrada em '{}'",
-                                                newSubInstance.sourceSubName, newSubInstance.sourceModName);
-                                continue;
-                            }
-                        } else {
-                            SKSE::log::warn("Mod de origem '{}' não encontrado para sub-animação.",
-                                            newSubInstance.sourceModName);
-                            continue;
-                        }
+// Estado de uma aba de stance como vai para o store, por ID e nome. Os itens desmarcados também vão: o diário
+// aponta posições da lista da UI, e ela os inclui.
+StanceStore::Instance AnimationManager::BuildStoredInstance(const WeaponCategory& category, int instanceIndex) const {
+    StanceStore::Instance stored;
+    for (const auto& modInst : category.instances[instanceIndex].modInstances) {
+        stored.push_back(StoreMoveset(modInst));
+    }
+    return stored;
+}
 
-                        // Carrega os estados dos checkboxes
-                        if (animJson.HasMember("pFront")) newSubInstance.pFront = animJson["pFront"].GetBool();
-                        if (animJson.HasMember("pBack")) newSubInstance.pBack = animJson["pBack"].GetBool();
-                        if (animJson.HasMember("pLeft")) newSubInstance.pLeft = animJson["pLeft"].GetBool();
-                        if (animJson.HasMember("pRight")) newSubInstance.pRight = animJson["pRight"].GetBool();
-                        if (animJson.HasMember("pFrontRight"))
-                            newSubInstance.pFrontRight = animJson["pFrontRight"].GetBool();
-                        if (animJson.HasMember("pFrontLeft"))
-                            newSubInstance.pFrontLeft = animJson["pFrontLeft"].GetBool();
-                        if (animJson.HasMember("pBackRight"))
-                            newSubInstance.pBackRight = animJson["pBackRight"].GetBool();
-                        if (animJson.HasMember("pBackLeft")) newSubInstance.pBackLeft = animJson["pBackLeft"].GetBool();
-                        if (animJson.HasMember("pRandom")) newSubInstance.pRandom = animJson["pRandom"].GetBool();
-                        if (animJson.HasMember("pDodge")) newSubInstance.pDodge = animJson["pDodge"].GetBool();
-
-                        newModInstance.subAnimationInstances.push_back(newSubInstance);
-                    }
-                }
-                targetInstance.modInstances.push_back(newModInstance);
-            }
-        }
+StanceStore::Moveset AnimationManager::StoreMoveset(const ModInstance& modInstance) const {
+    const auto& sourceMod = _allMods[modInstance.sourceModIndex];
+    StanceStore::Moveset moveset;
+    moveset.name = sourceMod.name;
+    moveset.id = sourceMod.id;
+    moveset.userMoveset = sourceMod.author == "Usuário";
+    moveset.selected = modInstance.isSelected;
+    for (const auto& subInst : modInstance.subAnimationInstances) {
+        moveset.animations.push_back(StoreAnimation(subInst));
     }
-    SKSE::log::info("Carregamento das configurações de Stance concluído.");
+    return moveset;
+}
+
+StanceStore::Animation AnimationManager::StoreAnimation(const SubAnimationInstance& subInstance) const {
+    const auto& animOriginMod = _allMods[subInstance.sourceModIndex];
+    const auto& animOriginSub = animOriginMod.subAnimations[subInstance.sourceSubAnimIndex];
+    StanceStore::Animation animation;
+    animation.sourceModName = animOriginMod.name;
+    animation.sourceSubName = animOriginSub.name.View();
+    animation.sourceModId = animOriginMod.id;
+    animation.sourceSubId = animOriginSub.id;
+    animation.flags = StanceStore::PackFlags(subInstance);
+    animation.selected = subInstance.isSelected;
+    return animation;
 }
 
 // --- NOVA FUNÇÃO DE SALVAMENTO ---
-void AnimationManager::SaveStanceConfigurations() {
-    SKSE::log::info("Iniciando salvamento das configurações de Stance...");
-    const std::filesystem::path stancesRoot = "Data/SKSE/Plugins/CycleMovesets/Stances";
+// Só as instâncias pedidas são remontadas; as outras seguem como estavam no store. O arquivo é sempre
+// reescrito inteiro, numa única escrita atômica.
+void AnimationManager::SaveStanceConfigurations(const std::set<InstanceKey>* onlyInstances) {
+    Diagnostics::ScopedPhase phase(Diagnostics::Phase::StanceSave);
+    std::size_t rebuilt = 0;
 
     for (const auto& categoryPair : _categories) {
         const WeaponCategory& category = categoryPair.second;
-        std::filesystem::path categoryPath = stancesRoot / category.name;
-        std::filesystem::create_directories(categoryPath);  // Garante que a pasta da categoria exista
-
         for (int i = 0; i < 4; ++i) {
-            const CategoryInstance& instance = category.instances[i];
-            std::filesystem::path instancePath = categoryPath / ("Instance" + std::to_string(i + 1) + "_Cycle.json");
-
-            rapidjson::Document doc;
-            doc.SetObject();
-            auto& allocator = doc.GetAllocator();
-
-            doc.AddMember("Category", rapidjson::Value(category.name.c_str(), allocator), allocator);
-
-            rapidjson::Value stancesArray(rapidjson::kArrayType);
-
-            for (const auto& modInst : instance.modInstances) {
-                if (!modInst.isSelected) continue;  // Pula movesets desativados
-
-                const auto& sourceMod = _allMods[modInst.sourceModIndex];
-
-                rapidjson::Value stanceObj(rapidjson::kObjectType);
-                rapidjson::Value typeValue(sourceMod.author == "Usuário" ? "user_moveset" : "moveset", allocator);
-                stanceObj.AddMember("type", typeValue, allocator);
-                stanceObj.AddMember("name", rapidjson::Value(sourceMod.name.c_str(), allocator), allocator);
-
-                rapidjson::Value animationsArray(rapidjson::kArrayType);
-                for (const auto& subInst : modInst.subAnimationInstances) {
-                    if (!subInst.isSelected) continue;
-
-                    const auto& animOriginMod = _allMods[subInst.sourceModIndex];
-                    const auto& animOriginSub = animOriginMod.subAnimations[subInst.sourceSubAnimIndex];
-
-                    rapidjson::Value animObj(rapidjson::kObjectType);
-                    animObj.AddMember("sourceModName", rapidjson::Value(animOriginMod.name.c_str(), allocator),
-                                      allocator);
-                    animObj.AddMember("sourceSubName", rapidjson::Value(animOriginSub.name.c_str(), allocator),
-                                      allocator);
-                    animObj.AddMember("sourceConfigPath",
-                                      rapidjson::Value(animOriginSub.path.string().c_str(), allocator), allocator);
-
-                    // Salva todos os booleans
-                    animObj.AddMember("pFront", subInst.pFront, allocator);
-                    animObj.AddMember("pBack", subInst.pBack, allocator);
-                    animObj.AddMember("pLeft", subInst.pLeft, allocator);
-                    animObj.AddMember("pRight", subInst.pRight, allocator);
-                    animObj.AddMember("pFrontRight", subInst.pFrontRight, allocator);
-                    animObj.AddMember("pFrontLeft", subInst.pFrontLeft, allocator);
-                    animObj.AddMember("pBackRight", subInst.pBackRight, allocator);
-                    animObj.AddMember("pBackLeft", subInst.pBackLeft, allocator);
-                    animObj.AddMember("pRandom", subInst.pRandom, allocator);
-                    animObj.AddMember("pDodge", subInst.pDodge, allocator);
-
-                    animationsArray.PushBack(animObj, allocator);
-                }
-                stanceObj.AddMember("animations", animationsArray, allocator);
-                stancesArray.PushBack(stanceObj, allocator);
-            }
-
-            doc.AddMember("stances", stancesArray, allocator);
-
-            // Escreve o arquivo JSON
-            FILE* fp;
-            fopen_s(&fp, instancePath.string().c_str(), "wb");
-            if (fp) {
-                char writeBuffer[65536];
-                rapidjson::FileWriteStream os(fp, writeBuffer, sizeof(writeBuffer));
-                rapidjson::PrettyWriter<rapidjson::FileWriteStream> writer(os);
-                doc.Accept(writer);
-                fclose(fp);
-            }
+            const InstanceKey key(category.name, i);
+            if (onlyInstances && !onlyInstances->contains(key)) continue;  // Não mudou desde o último salvamento
+            _storedStances[category.name][i] = BuildStoredInstance(category, i);
+            rebuilt++;
         }
     }
-    SKSE::log::info("Salvamento das configurações de Stance concluído.");
+    // Store e diário vazio no mesmo lote; o diário novo aponta o hash deste snapshot. Se a escrita falhar, o
+    // Autosave tenta de novo, e um diário antigo que sobrar não casa com o store novo.
+    auto content = StanceStore::Serialize(_storedStances);
+    const auto snapshotHash = Fnv1a64(content);
+    auto& autosave = Autosave::GetSingleton();
+    autosave.Submit(StanceStore::kStorePath, std::move(content));
+    autosave.Submit(StanceJournal::kJournalPath, StanceJournal::Header(snapshotHash));
+    _journalRecords = 0;
+    _snapshotRequested = false;
+    SKSE::log::info("Configurações de Stance enviadas para o salvamento automático ({} instâncias atualizadas).",
+                    rebuilt);
 }
 
-void AnimationManager::AddNegatedCompareValuesCondition(rapidjson::Value& conditionsArray,
-                                                        const std::string& graphVarName, int value,
-                                                        rapidjson::Document::AllocatorType& allocator) {
-    rapidjson::Value newCompare(rapidjson::kObjectType);
-    newCompare.AddMember("condition", "CompareValues", allocator);
-
-    // ---> A ÚNICA DIFERENÇA ESTÁ AQUI <---
-    newCompare.AddMember("negated", true, allocator);
-
-    newCompare.AddMember("requiredVersion", "1.0.0.0", allocator);
-    rapidjson::Value valueA(rapidjson::kObjectType);
-    valueA.AddMember("value", static_cast<double>(value), allocator);
-    newCompare.AddMember("Value A", valueA, allocator);
-    newCompare.AddMember("Comparison", "==", allocator);
-    rapidjson::Value valueB(rapidjson::kObjectType);
-    valueB.AddMember("graphVariable", rapidjson::Value(graphVarName.c_str(), allocator), allocator);
-    valueB.AddMember("graphVariableType", "Float", allocator);
-    newCompare.AddMember("Value B", valueB, allocator);
-    conditionsArray.PushBack(newCompare, allocator);
+void AnimationManager::ExportStances() {
+    auto stances = _storedStances;
+    for (const auto& [name, category] : _categories) {
+        for (int i = 0; i < 4; ++i) stances[category.name][i] = BuildStoredInstance(category, i);
+    }
+    if (StanceStore::ExportJson(stances)) {
+        SKSE::log::info("Stances exportadas para {}.", StanceStore::kExportPath);
+        RE::DebugNotification("Stances exportadas!");
+    }
 }
@@ -0,0 +1,152 @@
+﻿#include "LibraryCache.h"
+#include "AtomicFile.h"
+#include "BinaryStream.h"
+#include "Diagnostics.h"
+#include "LibraryId.h"
+#include "LibraryScanner.h"
+
+#include <fstream>
+
+namespace {
+    constexpr std::uint32_t kMagic = 0x494C4D43;  // "CMLI"
+    // 2: contagem de todas as tags. 3: pasta do submod em vez do config.json. 4: contagens de tag em 32 bits sem sinal.
+    // 5: carimbos de pasta sem o número de entradas
+    constexpr std::uint32_t kVersion = 5;
+}
+
+std::int64_t LibraryCache::ToStamp(std::filesystem::file_time_type time) {
+    return static_cast<std::int64_t>(time.time_since_epoch().count());
+}
+
+std::unordered_map<std::u8string, LibraryIndexEntry> LibraryCache::Load(const std::filesystem::path& oarRootPath) {
+    std::unordered_map<std::u8string, LibraryIndexEntry> result;
+
+    std::ifstream file(kIndexPath, std::ios::binary);
+    if (!file) return result;
+    std::vector<char> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    Diagnostics::CountRead(buffer.size());
+
+    BinaryReader reader(buffer);
+    if (reader.Read<std::uint32_t>() != kMagic || reader.Read<std::uint32_t>() != kVersion) {
+        SKSE::log::info("Índice da biblioteca ausente ou de outra versão. Fazendo escaneamento completo.");
+        return result;
+    }
+
+    const auto modCount = reader.Read<std::uint32_t>();
+    for (std::uint32_t m = 0; m < modCount && reader.Ok(); ++m) {
+        LibraryIndexEntry entry;
+        entry.folderName = reader.ReadString<char8_t>();
+        entry.hasConfig = reader.Read<std::uint8_t>() != 0;
+        entry.configMtime = reader.Read<std::int64_t>();
+        entry.configSize = reader.Read<std::uint64_t>();
+
+        const auto dirCount = reader.Read<std::uint32_t>();
+        for (std::uint32_t d = 0; d < dirCount && reader.Ok(); ++d) {
+            DirectoryStamp stamp;
+            stamp.relativePath = reader.ReadString<char8_t>();
+            stamp.mtime = reader.Read<std::int64_t>();
+            entry.directories.push_back(std::move(stamp));
+        }
+
+        if (reader.Read<std::uint8_t>() != 0) {
+            auto& pool = StringPool::GetSingleton();
+            const PathNode* modFolder = pool.InternPath(oarRootPath / entry.folderName);
+            AnimationModDef modDef;
+            modDef.name = reader.ReadString<char>();
+            modDef.author = reader.ReadString<char>();
+            modDef.id = LibraryId::FromRelativePath(std::filesystem::path(entry.folderName));
+            const auto subCount = reader.Read<std::uint32_t>();
+            for (std::uint32_t s = 0; s < subCount && reader.Ok(); ++s) {
+                SubAnimationDef subDef;
+                subDef.name = pool.Intern(reader.ReadString<char>());
+                const std::filesystem::path relativePath(reader.ReadString<char8_t>());
+                subDef.folder = pool.InternPath(relativePath, modFolder);
+                subDef.id = LibraryId::FromRelativePath(std::filesystem::path(entry.folderName) / relativePath);
+                const auto tagCount = reader.Read<std::uint8_t>();
+                for (std::uint8_t t = 0; t < tagCount; ++t) {
+                    const auto count = reader.Read<std::uint32_t>();
+                    if (t < kAnimationTagCount) subDef.tagCounts[t] = count;
+                }
+                modDef.subAnimations.push_back(std::move(subDef));
+            }
+            entry.mod = std::move(modDef);
+        }
+        result[entry.folderName] = std::move(entry);
+    }
+
+    if (!reader.Ok()) {
+        SKSE::log::warn("Índice da biblioteca corrompido. Fazendo escaneamento completo.");
+        result.clear();
+    }
+    return result;
+}
+
+bool LibraryCache::Save(const std::vector<LibraryIndexEntry>& entries, const std::filesystem::path& oarRootPath) {
+    BinaryWriter writer;
+    writer.Write(kMagic);
+    writer.Write(kVersion);
+    writer.Write(static_cast<std::uint32_t>(entries.size()));
+    for (const auto& entry : entries) {
+        writer.WriteString(entry.folderName);
+        writer.Write(static_cast<std::uint8_t>(entry.hasConfig));
+        writer.Write(entry.configMtime);
+        writer.Write(entry.configSize);
+
+        writer.Write(static_cast<std::uint32_t>(entry.directories.size()));
+        for (const auto& stamp : entry.directories) {
+            writer.WriteString(stamp.relativePath);
+            writer.Write(stamp.mtime);
+        }
+
+        writer.Write(static_cast<std::uint8_t>(entry.mod.has_value()));
+        if (entry.mod) {
+            const std::filesystem::path modPath = oarRootPath / entry.folderName;
+            writer.WriteString(entry.mod->name);
+            writer.WriteString(entry.mod->author);
+            writer.Write(static_cast<std::uint32_t>(entry.mod->subAnimations.size()));
+            for (const auto& subDef : entry.mod->subAnimations) {
+                writer.WriteString(std::string(subDef.name.View()));
+                writer.WriteString(StringPool::BuildPath(subDef.folder).lexically_relative(modPath).u8string());
+                writer.Write(static_cast<std::uint8_t>(kAnimationTagCount));
+                for (const auto count : subDef.tagCounts) writer.Write(count);
+            }
+        }
+    }
+
+    // Escrita atômica: um jogo fechado no meio do salvamento deixa o índice anterior, não um truncado.
+    const std::filesystem::path indexPath(kIndexPath);
+    std::filesystem::create_directories(indexPath.parent_path());
+    const auto& data = writer.Data();
+    std::string error;
+    if (!AtomicFileBatch::Write(indexPath, std::string_view(data.data(), data.size()), error)) {
+        SKSE::log::error("Falha ao salvar o índice da biblioteca: {} ({})", kIndexPath, error);
+        return false;
+    }
+    return true;
+}
+
+bool LibraryCache::IsUpToDate(const std::filesystem::path& modPath, const LibraryIndexEntry& entry) {
+    std::error_code ec;
+
+    auto& stats = LibraryScanner::GetStats();
+
+    // directory_entry já traz tamanho e data de modificação numa única consulta.
+    std::filesystem::directory_entry config(modPath / "config.json", ec);
+    stats.statCalls++;
+    const bool configExists = !ec && config.exists(ec);
+    if (configExists != entry.hasConfig) return false;
+    if (configExists) {
+        if (config.file_size(ec) != entry.configSize || ec) return false;
+        if (ToStamp(config.last_write_time(ec)) != entry.configMtime || ec) return false;
+    }
+
+    for (const auto& stamp : entry.directories) {
+        const auto dirPath = stamp.relativePath.empty() ? modPath : modPath / stamp.relativePath;
+        std::filesystem::directory_entry dir(dirPath, ec);
+        stats.statCalls++;
+        if (ec || !dir.is_directory(ec)) return false;
+        if (ToStamp(dir.last_write_time(ec)) != stamp.mtime || ec) return false;
+    }
+    return true;
+}
@@ -0,0 +1,306 @@
+﻿#include "LibraryScanner.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <string_view>
+#include "Diagnostics.h"
+#include "LibraryId.h"
+#include "TagClassifier.h"
+#include "ThreadPool.h"
+#include "rapidjson/encodedstream.h"
+#include "rapidjson/error/en.h"
+#include "rapidjson/filereadstream.h"
+#include "rapidjson/reader.h"
+
+namespace {
+    using NativeView = std::basic_string_view<std::filesystem::path::value_type>;
+
+    // Nome do arquivo como view sobre o caminho nativo: path::filename() alocaria um path novo por arquivo.
+    NativeView FileNameView(const std::filesystem::path& path) {
+        constexpr std::filesystem::path::value_type kSeparators[] = {'/', std::filesystem::path::preferred_separator,
+                                                                     0};
+        const NativeView native = path.native();
+        const auto separator = native.find_last_of(kSeparators);
+        return separator == NativeView::npos ? native : native.substr(separator + 1);
+    }
+
+    // Symlink de pasta ou, no MSVC, junction. Vem da própria listagem, sem stat extra.
+    bool IsDirectoryLink(const std::filesystem::directory_entry& entry) {
+        std::error_code error;
+        const auto type = entry.symlink_status(error).type();
+#ifdef _MSC_VER
+        if (type == std::filesystem::file_type::junction) return true;
+#endif
+        return type == std::filesystem::file_type::symlink;
+    }
+
+    bool EqualsIgnoreCase(NativeView a, std::string_view b) {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](auto x, char y) {
+                   return x < 128 && std::tolower(static_cast<unsigned char>(x)) ==
+                                         std::tolower(static_cast<unsigned char>(y));
+               });
+    }
+
+    // Handler SAX: guarda "name" e "author" do objeto raiz e interrompe o parse (retornando false)
+    // assim que os dois foram vistos. Chaves iguais em objetos aninhados são ignoradas.
+    struct ModHeaderHandler : rapidjson::BaseReaderHandler<rapidjson::UTF8<>, ModHeaderHandler> {
+        enum class Field { None, Name, Author };
+
+        explicit ModHeaderHandler(LibraryScanner::ModHeader& header) : header(header) {}
+
+        bool Done() const { return hasName && hasAuthor; }
+
+        // Qualquer valor que não seja string (números, bool, null).
+        bool Default() {
+            pending = Field::None;
+            return true;
+        }
+        bool String(const char* str, rapidjson::SizeType length, bool) {
+            if (depth == 1 && pending == Field::Name) {
+                header.name.assign(str, length);
+                hasName = true;
+            } else if (depth == 1 && pending == Field::Author) {
+                header.author.assign(str, length);
+                hasAuthor = true;
+            }
+            pending = Field::None;
+            return !Done();
+        }
+        bool Key(const char* str, rapidjson::SizeType length, bool) {
+            if (depth == 1) {
+                const std::string_view key(str, length);
+                if (key == "name" && !hasName) {
+                    pending = Field::Name;
+                } else if (key == "author" && !hasAuthor) {
+                    pending = Field::Author;
+                } else {
+                    pending = Field::None;
+                }
+            }
+            return true;
+        }
+        bool StartObject() {
+            pending = Field::None;
+            depth++;
+            return true;
+        }
+        bool EndObject(rapidjson::SizeType) {
+            depth--;
+            return true;
+        }
+        bool StartArray() {
+            if (depth == 0) return false;  // A raiz precisa ser um objeto
+            pending = Field::None;
+            depth++;
+            return true;
+        }
+        bool EndArray(rapidjson::SizeType) {
+            depth--;
+            return true;
+        }
+
+        LibraryScanner::ModHeader& header;
+        int depth = 0;
+        Field pending = Field::None;
+        bool hasName = false;
+        bool hasAuthor = false;
+    };
+}
+
+void LibraryScanner::ScanStats::Reset() {
+    directoriesListed = 0;
+    entriesVisited = 0;
+    statCalls = 0;
+    filesRead = 0;
+    bytesRead = 0;
+    submodsFound = 0;
+}
+
+std::uint64_t LibraryScanner::ScanStats::TotalCalls() const {
+    return directoriesListed.load() + statCalls.load() + filesRead.load();
+}
+
+LibraryScanner::ScanStats& LibraryScanner::GetStats() {
+    static ScanStats stats;
+    return stats;
+}
+
+LibraryScanner::ModHeader LibraryScanner::ReadModHeader(const std::filesystem::path& configPath) {
+    ModHeader header;
+    FILE* fp = nullptr;
+    fopen_s(&fp, configPath.string().c_str(), "rb");
+    if (!fp) return header;
+
+    // Buffer pequeno: name/author costumam estar nas primeiras linhas.
+    char readBuffer[4096];
+    rapidjson::FileReadStream fileStream(fp, readBuffer, sizeof(readBuffer));
+    rapidjson::AutoUTFInputStream<unsigned, rapidjson::FileReadStream> input(fileStream);  // Pula o BOM, se houver
+    ModHeaderHandler handler(header);
+    rapidjson::GenericReader<rapidjson::AutoUTF<unsigned>, rapidjson::UTF8<>> reader;
+    const auto result = reader.Parse(input, handler);
+    fclose(fp);
+
+    header.valid = handler.Done();
+    header.bytesRead = fileStream.Tell();
+    auto& stats = GetStats();
+    stats.filesRead++;
+    stats.bytesRead += header.bytesRead;
+
+    if (!header.valid && result.IsError() && result.Code() != rapidjson::kParseErrorTermination) {
+        SKSE::log::warn("config.json inválido em {}: {} (posição {})", configPath.string(),
+                        rapidjson::GetParseError_En(result.Code()), result.Offset());
+    }
+    return header;
+}
+
+LibraryScanner::DirectoryListing LibraryScanner::ListDirectory(const std::filesystem::path& dir,
+                                                               SubAnimationDef& tags) {
+    DirectoryListing listing;
+    auto& stats = GetStats();
+    stats.directoriesListed++;
+
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        listing.entryCount++;
+        if (entry.is_directory()) {
+            listing.subdirectories.push_back(entry);
+            continue;
+        }
+        if (!entry.is_regular_file()) continue;
+
+        const auto filename = FileNameView(entry.path());
+        if (EqualsIgnoreCase(filename, "config.json")) {
+            listing.hasConfig = true;
+            listing.configSize = entry.file_size();
+            listing.configMtime = LibraryCache::ToStamp(entry.last_write_time());
+            continue;
+        }
+        TagClassifier::Accumulate(filename, tags);
+    }
+    stats.entriesVisited += listing.entryCount;
+    return listing;
+}
+
+void LibraryScanner::CollectSubAnimations(const std::filesystem::path& modPath, const PathNode* parentFolder,
+                                          const std::vector<std::filesystem::directory_entry>& subdirectories,
+                                          std::vector<DirectoryStamp>& stamps,
+                                          std::vector<SubAnimationDef>& subAnimations) {
+    auto& pool = StringPool::GetSingleton();
+    for (const auto& subdirectory : subdirectories) {
+        const auto& subPath = subdirectory.path();
+        const auto folderName = subPath.filename();
+        const auto folderUtf8 = folderName.u8string();
+        const PathNode* folder = pool.InternSegment(
+            parentFolder, std::string_view(reinterpret_cast<const char*>(folderUtf8.data()), folderUtf8.size()));
+
+        SubAnimationDef subAnimDef;
+        const auto listing = ListDirectory(subPath, subAnimDef);
+        const auto relativePath = subPath.lexically_relative(modPath);
+        stamps.push_back({relativePath.u8string(), LibraryCache::ToStamp(subdirectory.last_write_time())});
+
+        if (listing.hasConfig) {
+            subAnimDef.name = pool.Intern(folderName.string());
+            subAnimDef.folder = folder;
+            subAnimDef.id = LibraryId::FromRelativePath(modPath.filename() / relativePath);
+            subAnimations.push_back(subAnimDef);
+            GetStats().submodsFound++;
+        }
+        // Um link vale como submod, mas não é percorrido (como no recursive_directory_iterator): um link para
+        // uma pasta acima repetiria os mesmos submods até o caminho estourar.
+        if (IsDirectoryLink(subdirectory)) continue;
+        CollectSubAnimations(modPath, folder, listing.subdirectories, stamps, subAnimations);
+    }
+}
+
+LibraryIndexEntry LibraryScanner::ProcessTopLevelMod(const std::filesystem::directory_entry& modEntry) {
+    const auto& modPath = modEntry.path();
+    LibraryIndexEntry entry;
+    entry.folderName = modPath.filename().u8string();
+
+    // A listagem da pasta do mod já diz se existe config.json (sem exists/stat separado).
+    SubAnimationDef rootTags;
+    auto root = ListDirectory(modPath, rootTags);
+    // A pasta do mod é sempre carimbada: criar o config.json depois também invalida o cache.
+    entry.directories.push_back({u8"", LibraryCache::ToStamp(modEntry.last_write_time())});
+    if (!root.hasConfig) return entry;
+    entry.hasConfig = true;
+    entry.configSize = root.configSize;
+    entry.configMtime = root.configMtime;
+
+    // Só o cabeçalho: a leitura para assim que name e author aparecem.
+    auto header = ReadModHeader(modPath / "config.json");
+    if (header.valid) {
+        AnimationModDef modDef;
+        modDef.name = std::move(header.name);
+        modDef.author = std::move(header.author);
+        modDef.id = LibraryId::FromRelativePath(std::filesystem::path(entry.folderName));
+        CollectSubAnimations(modPath, StringPool::GetSingleton().InternPath(modPath), root.subdirectories,
+                             entry.directories, modDef.subAnimations);
+        entry.mod = std::move(modDef);
+    }
+    return entry;
+}
+
+LibraryScanner::LibraryScan LibraryScanner::ScanLibrary(const std::filesystem::path& oarRootPath,
+                                                         std::size_t threads, Progress* progress) {
+    auto& scanStats = GetStats();
+    scanStats.Reset();
+    auto cachedEntries = LibraryCache::Load(oarRootPath);
+
+    // Guardamos o directory_entry inteiro: a data de modificação da pasta já vem da listagem.
+    std::vector<std::filesystem::directory_entry> modEntries;
+    for (const auto& entry : std::filesystem::directory_iterator(oarRootPath)) {
+        if (entry.is_directory()) {
+            modEntries.push_back(entry);
+        }
+    }
+    scanStats.directoriesListed++;
+    scanStats.entriesVisited += modEntries.size();
+    std::sort(modEntries.begin(), modEntries.end(),
+              [](const auto& a, const auto& b) { return a.path() < b.path(); });
+    if (progress) {
+        progress->modsScanned = 0;
+        progress->modsTotal = modEntries.size();
+    }
+
+    // Cada tarefa escreve apenas no seu próprio slot; a junção é a própria ordem de modEntries.
+    LibraryScan scan;
+    scan.entries.resize(modEntries.size());
+    std::vector<char> rescanned(modEntries.size(), 0);
+    {
+        ThreadPool pool(threads);
+        for (std::size_t i = 0; i < modEntries.size(); ++i) {
+            pool.Submit([&modEntries, &scan, &rescanned, &cachedEntries, progress, i] {
+                const auto& modPath = modEntries[i].path();
+                struct ProgressGuard {
+                    Progress* progress;
+                    ~ProgressGuard() {
+                        if (progress) progress->modsScanned++;
+                    }
+                } progressGuard{progress};
+                try {
+                    auto cached = cachedEntries.find(modPath.filename().u8string());
+                    if (cached != cachedEntries.end() && LibraryCache::IsUpToDate(modPath, cached->second)) {
+                        scan.entries[i] = std::move(cached->second);
+                        return;
+                    }
+                    rescanned[i] = 1;
+                    scan.entries[i] = ProcessTopLevelMod(modEntries[i]);
+                } catch (const std::exception& e) {
+                    SKSE::log::error("Falha ao escanear {}: {}", modPath.string(), e.what());
+                    scan.entries[i] = LibraryIndexEntry{};
+                }
+            });
+        }
+        pool.Wait();
+    }
+
+    for (const auto flag : rescanned) scan.rescanned += flag;
+    scan.fromIndex = modEntries.size() - scan.rescanned;
+    std::erase_if(scan.entries, [](const LibraryIndexEntry& entry) { return entry.folderName.empty(); });
+    Diagnostics::CountFsCalls(scanStats.directoriesListed.load() + scanStats.statCalls.load());
+    Diagnostics::CountRead(scanStats.bytesRead.load(), scanStats.filesRead.load());
+    // Regrava o índice só se algo mudou (mod novo, alterado ou removido).
+    if (scan.rescanned > 0 || cachedEntries.size() != modEntries.size()) LibraryCache::Save(scan.entries, oarRootPath);
+    return scan;
+}
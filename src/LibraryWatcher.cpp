@@ -0,0 +1,249 @@
+﻿#include "LibraryWatcher.h"
+
+#include <cstddef>
+#include <unordered_map>
+
+#ifdef _WIN32
+    #include <Windows.h>
+#elif defined(__linux__)
+    #include <poll.h>
+    #include <sys/inotify.h>
+    #include <unistd.h>
+#endif
+
+namespace {
+#ifdef _WIN32
+    // ReadDirectoryChangesW com bWatchSubtree: um único handle cobre a árvore inteira.
+    class Win32Backend final : public LibraryWatcher::Backend {
+    public:
+        ~Win32Backend() override { Close(); }
+
+        bool Open(const std::filesystem::path& root) override {
+            _directory = CreateFileW(root.c_str(), FILE_LIST_DIRECTORY,
+                                     FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                                     FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+            if (_directory == INVALID_HANDLE_VALUE) return false;
+            _event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+            return _event && IssueRead();
+        }
+
+        void Poll(std::chrono::milliseconds timeout, std::vector<std::filesystem::path>& changed,
+                  bool& overflow) override {
+            if (!_readPending && !IssueRead()) {
+                overflow = true;
+                Sleep(static_cast<DWORD>(timeout.count()));
+                return;
+            }
+            if (WaitForSingleObject(_event, static_cast<DWORD>(timeout.count())) != WAIT_OBJECT_0) return;
+
+            DWORD bytes = 0;
+            _readPending = false;
+            if (!GetOverlappedResult(_directory, &_overlapped, &bytes, FALSE) || bytes == 0) {
+                // Zero bytes significa que o buffer do sistema estourou e os eventos foram descartados.
+                overflow = true;
+            } else {
+                const auto* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(_buffer);
+                while (true) {
+                    changed.emplace_back(std::wstring(info->FileName, info->FileNameLength / sizeof(WCHAR)));
+                    if (info->NextEntryOffset == 0) break;
+                    info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(reinterpret_cast<const std::byte*>(info) +
+                                                                            info->NextEntryOffset);
+                }
+            }
+            IssueRead();
+        }
+
+        void Close() override {
+            if (_directory != INVALID_HANDLE_VALUE) {
+                if (_readPending) {
+                    DWORD bytes = 0;
+                    CancelIoEx(_directory, &_overlapped);
+                    GetOverlappedResult(_directory, &_overlapped, &bytes, TRUE);
+                    _readPending = false;
+                }
+                CloseHandle(_directory);
+                _directory = INVALID_HANDLE_VALUE;
+            }
+            if (_event) {
+                CloseHandle(_event);
+                _event = nullptr;
+            }
+        }
+
+    private:
+        bool IssueRead() {
+            ResetEvent(_event);
+            _overlapped = {};
+            _overlapped.hEvent = _event;
+            _readPending = ReadDirectoryChangesW(_directory, _buffer, sizeof(_buffer), TRUE,
+                                                 FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME |
+                                                     FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE,
+                                                 nullptr, &_overlapped, nullptr) != 0;
+            return _readPending;
+        }
+
+        HANDLE _directory = INVALID_HANDLE_VALUE;
+        HANDLE _event = nullptr;
+        OVERLAPPED _overlapped{};
+        bool _readPending = false;
+        alignas(DWORD) std::byte _buffer[64 * 1024];
+    };
+#elif defined(__linux__)
+    // inotify não é recursivo: cada pasta da árvore recebe seu próprio watch, e pastas novas são
+    // adicionadas conforme aparecem. Usado para testar o watcher fora do jogo.
+    class InotifyBackend final : public LibraryWatcher::Backend {
+    public:
+        ~InotifyBackend() override { Close(); }
+
+        bool Open(const std::filesystem::path& root) override {
+            _root = root;
+            _fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (_fd < 0) return false;
+            AddWatchTree({});
+            return !_watches.empty();
+        }
+
+        void Poll(std::chrono::milliseconds timeout, std::vector<std::filesystem::path>& changed,
+                  bool& overflow) override {
+            pollfd pfd{_fd, POLLIN, 0};
+            if (poll(&pfd, 1, static_cast<int>(timeout.count())) <= 0) return;
+
+            alignas(inotify_event) char buffer[64 * 1024];
+            while (true) {
+                const auto length = read(_fd, buffer, sizeof(buffer));
+                if (length <= 0) break;
+                for (char* ptr = buffer; ptr < buffer + length;) {
+                    const auto* event = reinterpret_cast<const inotify_event*>(ptr);
+                    ptr += sizeof(inotify_event) + event->len;
+                    if (event->mask & IN_Q_OVERFLOW) {
+                        overflow = true;
+                        continue;
+                    }
+                    if (event->mask & IN_IGNORED) {
+                        _watches.erase(event->wd);
+                        continue;
+                    }
+                    const auto watch = _watches.find(event->wd);
+                    if (watch == _watches.end()) continue;
+
+                    auto relative = event->len > 0 ? watch->second / event->name : watch->second;
+                    if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO))) {
+                        AddWatchTree(relative);
+                    }
+                    changed.push_back(std::move(relative));
+                }
+            }
+        }
+
+        void Close() override {
+            if (_fd >= 0) {
+                close(_fd);
+                _fd = -1;
+            }
+            _watches.clear();
+        }
+
+    private:
+        void AddWatchTree(const std::filesystem::path& relative) {
+            const auto absolute = _root / relative;
+            // Só a raiz pode ser um link; abaixo dela, um link para uma pasta acima faria a árvore de watches
+            // crescer sem fim (o LibraryScanner também não entra neles).
+            const std::uint32_t follow = relative.empty() ? 0 : IN_DONT_FOLLOW;
+            const int wd = inotify_add_watch(
+                _fd, absolute.c_str(), IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | follow);
+            if (wd < 0) return;
+            _watches[wd] = relative;
+
+            std::error_code ec;
+            for (const auto& entry : std::filesystem::directory_iterator(absolute, ec)) {
+                if (entry.is_directory(ec) && !entry.is_symlink(ec)) {
+                    AddWatchTree(relative / entry.path().filename());
+                }
+            }
+        }
+
+        std::filesystem::path _root;
+        int _fd = -1;
+        std::unordered_map<int, std::filesystem::path> _watches;  // wd -> pasta relativa à raiz
+    };
+#endif
+}
+
+std::unique_ptr<LibraryWatcher::Backend> LibraryWatcher::CreateDefaultBackend() {
+#ifdef _WIN32
+    return std::make_unique<Win32Backend>();
+#elif defined(__linux__)
+    return std::make_unique<InotifyBackend>();
+#else
+    return nullptr;
+#endif
+}
+
+LibraryWatcher::LibraryWatcher(std::filesystem::path root, BatchCallback callback, std::unique_ptr<Backend> backend)
+    : _root(std::move(root)), _callback(std::move(callback)), _backend(std::move(backend)) {}
+
+LibraryWatcher::~LibraryWatcher() { Stop(); }
+
+bool LibraryWatcher::Start() {
+    if (_thread.joinable()) return true;
+    if (!_backend || !_backend->Open(_root)) {
+        SKSE::log::warn("Não foi possível observar a pasta {}. Mods novos só aparecem após reiniciar.",
+                        _root.string());
+        return false;
+    }
+    _stopRequested = false;
+    _thread = std::thread(&LibraryWatcher::Run, this);
+    SKSE::log::info("Observando alterações em {}.", _root.string());
+    return true;
+}
+
+void LibraryWatcher::Stop() {
+    _stopRequested = true;
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+    if (_backend) {
+        _backend->Close();
+    }
+}
+
+void LibraryWatcher::Run() {
+    std::set<std::u8string> pendingMods;
+    bool fullRescan = false;
+    std::chrono::steady_clock::time_point firstEvent;
+    std::chrono::steady_clock::time_point lastEvent;
+    std::vector<std::filesystem::path> changed;
+
+    while (!_stopRequested) {
+        changed.clear();
+        bool overflow = false;
+        _backend->Poll(kPollInterval, changed, overflow);
+
+        const auto now = std::chrono::steady_clock::now();
+        const bool wasIdle = pendingMods.empty() && !fullRescan;
+        bool relevant = overflow;
+        // Só interessa o mod de topo: "ModX/sub/arquivo.hkx" -> "ModX".
+        for (const auto& relative : changed) {
+            if (relative.empty() || (_ignore && _ignore(relative))) continue;
+            pendingMods.insert(relative.begin()->u8string());
+            relevant = true;
+        }
+        // Eventos ignorados não abrem nem estendem o lote.
+        if (relevant) {
+            if (wasIdle) firstEvent = now;
+            lastEvent = now;
+            fullRescan |= overflow;
+        }
+
+        if (pendingMods.empty() && !fullRescan) continue;
+        if (now - lastEvent < kDebounce && now - firstEvent < kMaxBatchDelay) continue;
+
+        try {
+            _callback(pendingMods, fullRescan);
+        } catch (const std::exception& e) {
+            SKSE::log::error("Falha ao processar alterações da biblioteca: {}", e.what());
+        }
+        pendingMods.clear();
+        fullRescan = false;
+    }
+}
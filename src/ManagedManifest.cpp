@@ -0,0 +1,110 @@
+﻿#include "ManagedManifest.h"
+
+#include <fstream>
+#include <string>
+#include "AtomicFile.h"
+#include "Diagnostics.h"
+#include "LibraryCache.h"
+#include "rapidjson/document.h"
+#include "rapidjson/prettywriter.h"
+#include "rapidjson/stringbuffer.h"
+
+namespace {
+    constexpr int kManifestVersion = 1;
+}
+
+std::optional<ManagedFileMap> ManagedManifest::Load() {
+    std::ifstream fileStream(kManifestPath);
+    if (!fileStream) return std::nullopt;
+    std::string jsonContent((std::istreambuf_iterator<char>(fileStream)), std::istreambuf_iterator<char>());
+    fileStream.close();
+    Diagnostics::CountRead(jsonContent.size());
+
+    rapidjson::Document doc;
+    if (doc.Parse(jsonContent.c_str()).HasParseError() || !doc.IsObject() || !doc.HasMember("version") ||
+        !doc["version"].IsInt() || doc["version"].GetInt() != kManifestVersion || !doc.HasMember("files") ||
+        !doc["files"].IsArray()) {
+        SKSE::log::warn("Manifesto de arquivos gerenciados inválido: {}", kManifestPath);
+        return std::nullopt;
+    }
+
+    ManagedFileMap files;
+    for (const auto& fileJson : doc["files"].GetArray()) {
+        if (!fileJson.IsObject() || !fileJson.HasMember("path") || !fileJson["path"].IsString()) continue;
+        const std::string_view pathUtf8(fileJson["path"].GetString(), fileJson["path"].GetStringLength());
+        std::filesystem::path path(std::u8string(pathUtf8.begin(), pathUtf8.end()));
+
+        ManagedFileRecord record;
+        if (fileJson.HasMember("hash") && fileJson["hash"].IsUint64()) record.blockHash = fileJson["hash"].GetUint64();
+        if (fileJson.HasMember("size") && fileJson["size"].IsUint64()) record.size = fileJson["size"].GetUint64();
+        if (fileJson.HasMember("mtime") && fileJson["mtime"].IsInt64()) record.mtime = fileJson["mtime"].GetInt64();
+        files[path] = record;
+    }
+    return files;
+}
+
+bool ManagedManifest::Save(const ManagedFileMap& files) {
+    rapidjson::Document doc;
+    doc.SetObject();
+    auto& allocator = doc.GetAllocator();
+    doc.AddMember("version", kManifestVersion, allocator);
+
+    rapidjson::Value filesArray(rapidjson::kArrayType);
+    for (const auto& [path, record] : files) {
+        const auto pathUtf8 = path.u8string();
+        rapidjson::Value fileObj(rapidjson::kObjectType);
+        fileObj.AddMember("path",
+                          rapidjson::Value(reinterpret_cast<const char*>(pathUtf8.data()),
+                                           static_cast<rapidjson::SizeType>(pathUtf8.size()), allocator),
+                          allocator);
+        fileObj.AddMember("hash", record.blockHash, allocator);
+        fileObj.AddMember("size", record.size, allocator);
+        fileObj.AddMember("mtime", record.mtime, allocator);
+        filesArray.PushBack(fileObj, allocator);
+    }
+    doc.AddMember("files", filesArray, allocator);
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+    doc.Accept(writer);
+
+    const std::filesystem::path manifestPath(kManifestPath);
+    std::filesystem::create_directories(manifestPath.parent_path());
+    std::string error;
+    if (!AtomicFileBatch::Write(manifestPath, std::string_view(buffer.GetString(), buffer.GetSize()), error)) {
+        SKSE::log::error("Falha ao salvar o manifesto de arquivos gerenciados: {} ({})", kManifestPath, error);
+        return false;
+    }
+    return true;
+}
+
+bool ManagedManifest::Stamp(const std::filesystem::path& path, ManagedFileRecord& record) {
+    std::error_code ec;
+    Diagnostics::CountFsCalls();
+    std::filesystem::directory_entry entry(path, ec);
+    if (ec || !entry.is_regular_file(ec)) return false;
+    record.size = entry.file_size(ec);
+    record.mtime = LibraryCache::ToStamp(entry.last_write_time(ec));
+    return !ec;
+}
+
+bool ManagedManifest::Verify(const std::filesystem::path& path, ManagedFileRecord& record) {
+    ManagedFileRecord current;
+    if (!Stamp(path, current)) return false;  // Arquivo removido
+    if (current.size == record.size && current.mtime == record.mtime) return true;
+
+    // O arquivo mudou desde o nosso último save (outro mod sobrescreveu, usuário editou...).
+    if (!ContainsMarker(path)) return false;
+    record.size = current.size;
+    record.mtime = current.mtime;
+    record.blockHash = 0;  // Não sabemos mais o que está escrito lá
+    return true;
+}
+
+bool ManagedManifest::ContainsMarker(const std::filesystem::path& path) {
+    std::ifstream fileStream(path);
+    if (!fileStream) return false;
+    std::string content((std::istreambuf_iterator<char>(fileStream)), std::istreambuf_iterator<char>());
+    Diagnostics::CountRead(content.size());
+    return content.find(kMarker) != std::string::npos;
+}
@@ -1,9 +1,11 @@
+#include "Autosave.h"
 #include "Events.h"
+#include "LibraryId.h"
 #include "SKSEMCP/SKSEMenuFramework.hpp"
 #include "rapidjson/document.h"
 #include "rapidjson/error/en.h"
-#include "rapidjson/filewritestream.h"
 #include "rapidjson/prettywriter.h"
+#include "rapidjson/stringbuffer.h"
 #include <format>
 #include <fstream>
 #include <string>
@@ -42,24 +44,19 @@ void AnimationManager::LoadUserMovesets() {
                 // Preenche com os nomes salvos do JSON
                 subInstance.sourceModName = subAnimJson["sourceModName"].GetString();
                 subInstance.sourceSubName = subAnimJson["sourceSubName"].GetString();
+                // IDs s existem em arquivos gravados depois dos LibraryIds; sem eles a busca  pelo nome.
+                if (subAnimJson.HasMember("sourceModId") && subAnimJson["sourceModId"].IsUint64()) {
+                    subInstance.sourceModId = subAnimJson["sourceModId"].GetUint64();
+                }
+                if (subAnimJson.HasMember("sourceSubId") && subAnimJson["sourceSubId"].IsUint64()) {
+                    subInstance.sourceSubId = subAnimJson["sourceSubId"].GetUint64();
+                }
 
-                // ---> INCIO DA CORREO <---
-                // Agora, usamos os nomes para encontrar e preencher os ndices para uso em tempo de execuo.
-                auto modIdxOpt = FindModIndexByName(subInstance.sourceModName);
-                if (modIdxOpt) {
-                    subInstance.sourceModIndex = *modIdxOpt;  // Preenche o ndice do mod
-                    auto subAnimIdxOpt = FindSubAnimIndexByName(*modIdxOpt, subInstance.sourceSubName);
-                    if (subAnimIdxOpt) {
-                        subInstance.sourceSubAnimIndex = *subAnimIdxOpt;  // Preenche o ndice da sub-animao
-                    } else {
-                        SKSE::log::warn("Sub-animao '{}' do moveset de usurio no encontrada no mod '{}'. Pulando.",
-                                        subInstance.sourceSubName, subInstance.sourceModName);
-                        continue;  // Pula esta sub-animao se no for encontrada
-                    }
-                } else {
-                    SKSE::log::warn("Mod '{}' do moveset de usurio no encontrado. Pulando sub-animao.",
-                                    subInstance.sourceModName);
-                    continue;  // Pula esta sub-animao se o mod pai no for encontrado
+                // Preenche ndices e IDs (pelo ID salvo e, se ele no existir mais, pelo nome).
+                if (!ResolveSubAnimation(subInstance)) {
+                    SKSE::log::warn("Sub-animao '{}' do moveset de usurio no encontrada no mod '{}'. Pulando.",
+                                    subInstance.sourceSubName, subInstance.sourceModName);
+                    continue;  // Pula esta sub-animao se no for encontrada
                 }
                 loadedMoveset.subAnimations.push_back(subInstance);
             }
@@ -71,7 +68,6 @@ void AnimationManager::LoadUserMovesets() {
 
 void AnimationManager::SaveUserMovesets() {
     const std::filesystem::path userMovesetsPath = "Data/SKSE/Plugins/CycleMovesets/UserMovesets.json";
-    std::filesystem::create_directories(userMovesetsPath.parent_path());
 
     rapidjson::Document doc;
     doc.SetArray();
@@ -91,8 +87,10 @@ void AnimationManager::SaveUserMovesets() {
             // Salva os nomes e o caminho, conforme seu novo formato
             subAnimObj.AddMember("sourceModName", rapidjson::Value(originMod.name.c_str(), allocator), allocator);
             subAnimObj.AddMember("sourceSubName", rapidjson::Value(originSubAnim.name.c_str(), allocator), allocator);
-            subAnimObj.AddMember("sourceConfigPath", rapidjson::Value(originSubAnim.path.string().c_str(), allocator),
-                                 allocator);
+            subAnimObj.AddMember("sourceConfigPath",
+                                 rapidjson::Value(originSubAnim.ConfigPath().string().c_str(), allocator), allocator);
+            subAnimObj.AddMember("sourceModId", rapidjson::Value(originMod.id), allocator);
+            subAnimObj.AddMember("sourceSubId", rapidjson::Value(originSubAnim.id), allocator);
 
             // Nota: As checkboxes como pLeft no so salvas AQUI. Elas so salvas no _Cycle.json
             // quando este user_moveset  adicionado a uma stance. O UserMovesets.json  um "template".
@@ -103,18 +101,12 @@ void AnimationManager::SaveUserMovesets() {
         doc.PushBack(movesetObj, allocator);
     }
 
-    FILE* fp;
-    fopen_s(&fp, userMovesetsPath.string().c_str(), "wb");
-    if (!fp) {
-        SKSE::log::error("Falha ao salvar UserMovesets.json.");
-        return;
-    }
-    char writeBuffer[65536];
-    rapidjson::FileWriteStream os(fp, writeBuffer, sizeof(writeBuffer));
-    rapidjson::PrettyWriter<rapidjson::FileWriteStream> writer(os);
+    rapidjson::StringBuffer buffer;
+    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
     doc.Accept(writer);
-    fclose(fp);
-    SKSE::log::info("Movesets de usurio salvos com sucesso.");
+    // S monta o contedo; a escrita acontece na thread do Autosave.
+    Autosave::GetSingleton().Submit(userMovesetsPath, std::string(buffer.GetString(), buffer.GetSize()));
+    SKSE::log::info("Movesets de usurio enviados para o salvamento automtico.");
 }
 
 void AnimationManager::DrawUserMovesetEditor() {
@@ -231,28 +223,49 @@ void AnimationManager::DrawUserMovesetManager() {
 
 void AnimationManager::RebuildUserMovesetLibrary() {
     SKSE::log::info("Reconstruindo a biblioteca de movesets do usurio em tempo real...");
+    MarkAllDirty();  // Stances que usam estes movesets apontam para outros sub-movesets agora
 
-    // Remove todos os mods que foram previamente adicionados como "Usurio" para evitar duplicatas
-    _allMods.erase(std::remove_if(_allMods.begin(), _allMods.end(),
-                                  [](const AnimationModDef& mod) { return mod.author == "Usurio"; }),
-                   _allMods.end());
+    // Reaproveita as posies dos mods "Usurio" j existentes em vez de apag-los: mods instalados com o
+    // jogo aberto ficam depois deles em _allMods, e apagar do meio do vetor mudaria os ndices desses mods.
+    std::vector<size_t> userSlots;
+    for (size_t i = 0; i < _allMods.size(); ++i) {
+        if (_allMods[i].author == "Usurio") userSlots.push_back(i);
+    }
+    size_t nextSlot = 0;
 
     // Readiciona os movesets da lista _userMovesets (que est atualizada em memria)
     for (const auto& userMoveset : _userMovesets) {
         AnimationModDef modDef;
         modDef.name = userMoveset.name;
         modDef.author = "Usurio";
+        modDef.id = LibraryId::ForUserMoveset(userMoveset.name);
 
         for (const auto& subInstance : userMoveset.subAnimations) {
-            auto modIdxOpt = FindModIndexByName(subInstance.sourceModName);
-            if (modIdxOpt) {
-                auto subAnimIdxOpt = FindSubAnimIndexByName(*modIdxOpt, subInstance.sourceSubName);
-                if (subAnimIdxOpt) {
-                    modDef.subAnimations.push_back(_allMods[*modIdxOpt].subAnimations[*subAnimIdxOpt]);
-                }
+            // Pelo LibraryId primeiro, como as stances: um mod renomeado ou outro com o mesmo nome no troca a
+            // sub-animao. O nome s decide para referncias sem ID.
+            SubAnimationInstance resolved = subInstance;
+            if (ResolveSubAnimation(resolved)) {
+                modDef.subAnimations.push_back(
+                    _allMods[resolved.sourceModIndex].subAnimations[resolved.sourceSubAnimIndex]);
             }
         }
-        _allMods.push_back(modDef);
+        if (nextSlot < userSlots.size()) {
+            _allMods[userSlots[nextSlot]] = std::move(modDef);
+            _nameIndex.Reindex(_allMods, userSlots[nextSlot++]);
+        } else {
+            _allMods.push_back(std::move(modDef));
+        }
+    }
+    // Sobras de movesets apagados ficam vazias e indisponveis (e so reaproveitadas na prxima vez). Sem nome
+    // nem ID elas saem do ndice: uma stance no pode voltar a apontar para um moveset apagado.
+    for (; nextSlot < userSlots.size(); ++nextSlot) {
+        auto& staleMod = _allMods[userSlots[nextSlot]];
+        staleMod = AnimationModDef{};
+        staleMod.author = "Usurio";
+        staleMod.available = false;
+        _nameIndex.Reindex(_allMods, userSlots[nextSlot]);
     }
+    // Os movesets de usurio podem ter mudado de posio: as stances seguem o ID, no o ndice.
+    RelinkInstances();
     SKSE::log::info("Biblioteca reconstruda. Total de {} mods.", _allMods.size());
 }
\ No newline at end of file
@@ -0,0 +1,109 @@
+﻿#include "ModNameIndex.h"
+
+namespace {
+    // Nome vazio e ID 0 ("sem ID") não entram no índice: são as sobras de movesets de usuário apagados.
+    bool IsKey(const std::string& name) { return !name.empty(); }
+    bool IsKey(LibraryId::Id id) { return id != 0; }
+
+    // Troca a chave do mod `modIdx` mantendo a regra "o primeiro mod com a chave". Só acontece quando um mod
+    // é trocado no lugar por outro (movesets de usuário): a busca linear pelo próximo dono é aceitável aqui.
+    template <class Map, class Key>
+    void MoveKey(Map& map, const std::vector<Key>& indexedKeys, const Key& oldKey, const Key& newKey,
+                 std::size_t modIdx) {
+        const auto owner = map.find(oldKey);
+        if (owner != map.end() && owner->second == modIdx) {
+            map.erase(owner);
+            for (std::size_t other = 0; other < indexedKeys.size(); ++other) {
+                if (other != modIdx && indexedKeys[other] == oldKey) {
+                    map.emplace(oldKey, other);
+                    break;
+                }
+            }
+        }
+        if (!IsKey(newKey)) return;
+        const auto [entry, inserted] = map.try_emplace(newKey, modIdx);
+        if (!inserted && entry->second > modIdx) entry->second = modIdx;
+    }
+}
+
+void ModNameIndex::Clear() {
+    _modByName.clear();
+    _modById.clear();
+    _indexedNames.clear();
+    _indexedIds.clear();
+    _subAnimByName.clear();
+    _subAnimById.clear();
+}
+
+void ModNameIndex::Append(const std::vector<AnimationModDef>& mods) {
+    if (mods.size() < _indexedNames.size()) Clear();  // O vetor foi refeito do zero
+    for (std::size_t modIdx = _indexedNames.size(); modIdx < mods.size(); ++modIdx) {
+        const auto& mod = mods[modIdx];
+        if (IsKey(mod.name)) _modByName.try_emplace(mod.name, modIdx);
+        if (IsKey(mod.id)) _modById.try_emplace(mod.id, modIdx);
+        _indexedNames.push_back(mod.name);
+        _indexedIds.push_back(mod.id);
+        _subAnimByName.emplace_back();
+        _subAnimById.emplace_back();
+        IndexSubAnimations(mod, modIdx);
+    }
+}
+
+void ModNameIndex::Reindex(const std::vector<AnimationModDef>& mods, std::size_t modIdx) {
+    if (modIdx >= _indexedNames.size()) {
+        Append(mods);
+        return;
+    }
+    const auto& mod = mods[modIdx];
+    if (_indexedNames[modIdx] != mod.name) {
+        MoveKey(_modByName, _indexedNames, _indexedNames[modIdx], mod.name, modIdx);
+        _indexedNames[modIdx] = mod.name;
+    }
+    if (_indexedIds[modIdx] != mod.id) {
+        MoveKey(_modById, _indexedIds, _indexedIds[modIdx], mod.id, modIdx);
+        _indexedIds[modIdx] = mod.id;
+    }
+    _subAnimByName[modIdx].clear();
+    _subAnimById[modIdx].clear();
+    IndexSubAnimations(mod, modIdx);
+}
+
+std::optional<std::size_t> ModNameIndex::FindMod(std::string_view name) const {
+    const auto found = _modByName.find(name);
+    if (found == _modByName.end()) return std::nullopt;
+    return found->second;
+}
+
+std::optional<std::size_t> ModNameIndex::FindSubAnim(std::size_t modIdx, std::string_view name) const {
+    if (modIdx >= _subAnimByName.size()) return std::nullopt;
+    const auto& subAnims = _subAnimByName[modIdx];
+    const auto found = subAnims.find(name);
+    if (found == subAnims.end()) return std::nullopt;
+    return found->second;
+}
+
+std::optional<std::size_t> ModNameIndex::FindModById(LibraryId::Id id) const {
+    if (id == 0) return std::nullopt;
+    const auto found = _modById.find(id);
+    if (found == _modById.end()) return std::nullopt;
+    return found->second;
+}
+
+std::optional<std::size_t> ModNameIndex::FindSubAnimById(std::size_t modIdx, LibraryId::Id id) const {
+    if (id == 0 || modIdx >= _subAnimById.size()) return std::nullopt;
+    const auto& subAnims = _subAnimById[modIdx];
+    const auto found = subAnims.find(id);
+    if (found == subAnims.end()) return std::nullopt;
+    return found->second;
+}
+
+void ModNameIndex::IndexSubAnimations(const AnimationModDef& mod, std::size_t modIdx) {
+    auto& byName = _subAnimByName[modIdx];
+    auto& byId = _subAnimById[modIdx];
+    byName.reserve(mod.subAnimations.size());
+    byId.reserve(mod.subAnimations.size());
+    for (std::size_t subIdx = 0; subIdx < mod.subAnimations.size(); ++subIdx) {
+        byName.try_emplace(mod.subAnimations[subIdx].name.View(), subIdx);
+        if (IsKey(mod.subAnimations[subIdx].id)) byId.try_emplace(mod.subAnimations[subIdx].id, subIdx);
+    }
+}
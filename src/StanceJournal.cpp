@@ -0,0 +1,311 @@
+﻿#include "StanceJournal.h"
+
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <utility>
+#include "BinaryStream.h"
+#include "Diagnostics.h"
+
+namespace {
+    constexpr std::uint32_t kMagic = 0x524A4D43;  // "CMJR"
+    constexpr std::uint32_t kVersion = 2;  // 2: IDs das sub-animações e do alvo das trocas
+
+    void WriteAnimation(BinaryWriter& writer, const StanceStore::Animation& animation) {
+        writer.WriteString(animation.sourceModName);
+        writer.WriteString(animation.sourceSubName);
+        writer.Write(animation.sourceModId);
+        writer.Write(animation.sourceSubId);
+        writer.Write(animation.flags);
+        writer.Write(static_cast<std::uint8_t>(animation.selected));
+    }
+
+    StanceStore::Animation ReadAnimation(BinaryReader& reader) {
+        StanceStore::Animation animation;
+        animation.sourceModName = reader.ReadString<char>();
+        animation.sourceSubName = reader.ReadString<char>();
+        animation.sourceModId = reader.Read<std::uint64_t>();
+        animation.sourceSubId = reader.Read<std::uint64_t>();
+        animation.flags = reader.Read<std::uint16_t>();
+        animation.selected = reader.Read<std::uint8_t>() != 0;
+        return animation;
+    }
+
+    void WriteMoveset(BinaryWriter& writer, const StanceStore::Moveset& moveset) {
+        writer.WriteString(moveset.name);
+        writer.Write(moveset.id);
+        writer.Write(static_cast<std::uint8_t>(moveset.userMoveset));
+        writer.Write(static_cast<std::uint8_t>(moveset.selected));
+        writer.Write(static_cast<std::uint32_t>(moveset.animations.size()));
+        for (const auto& animation : moveset.animations) WriteAnimation(writer, animation);
+    }
+
+    StanceStore::Moveset ReadMoveset(BinaryReader& reader) {
+        StanceStore::Moveset moveset;
+        moveset.name = reader.ReadString<char>();
+        moveset.id = reader.Read<std::uint64_t>();
+        moveset.userMoveset = reader.Read<std::uint8_t>() != 0;
+        moveset.selected = reader.Read<std::uint8_t>() != 0;
+        const auto count = reader.Read<std::uint32_t>();
+        for (std::uint32_t i = 0; i < count && reader.Ok(); ++i) moveset.animations.push_back(ReadAnimation(reader));
+        return moveset;
+    }
+}
+
+StanceJournal::Op StanceJournal::Inverse(const Op& op) {
+    Op inverse = op;
+    switch (op.type) {
+        case OpType::SwapMovesets:
+            // O moveset de `movesetId` foi parar em `target`: a volta parte de lá.
+            inverse.moveset = op.target;
+            inverse.target = op.moveset;
+            break;
+        case OpType::SwapAnimations:
+            // A mesma troca desfaz a anterior, mas as posições agora guardam os itens uma da outra.
+            inverse.animationId = op.targetId;
+            inverse.targetId = op.animationId;
+            break;
+        case OpType::SetMovesetSelected:
+        case OpType::SetAnimationSelected:
+        case OpType::SetAnimationFlags:
+            inverse.before = op.after;
+            inverse.after = op.before;
+            break;
+        case OpType::InsertMoveset:
+            inverse.type = OpType::RemoveMoveset;
+            break;
+        case OpType::RemoveMoveset:
+            inverse.type = OpType::InsertMoveset;
+            break;
+        case OpType::InsertAnimation:
+            inverse.type = OpType::RemoveAnimation;
+            break;
+        case OpType::RemoveAnimation:
+            inverse.type = OpType::InsertAnimation;
+            break;
+    }
+    return inverse;
+}
+
+bool StanceJournal::Apply(StanceStore::Instance& movesets, const Op& op) {
+    if (op.type == OpType::InsertMoveset) {
+        // A única operação que não exige um moveset já na posição.
+        if (op.moveset > movesets.size()) return false;
+        movesets.insert(movesets.begin() + op.moveset, op.movesetData);
+        return true;
+    }
+    // ID 0 no store: moveset gravado antes dos LibraryIds, sem conferência.
+    if (op.moveset >= movesets.size()) return false;
+    auto& moveset = movesets[op.moveset];
+    if (moveset.id != 0 && moveset.id != op.movesetId) return false;
+    auto& animations = moveset.animations;
+    // A posição só vale se ainda guarda a mesma sub-animação (ID 0: registro antigo, sem ID gravado).
+    auto animationMatches = [&](std::uint32_t index, std::uint64_t id) {
+        return index < animations.size() && (id == 0 || animations[index].sourceSubId == 0 ||
+                                              animations[index].sourceSubId == id);
+    };
+    switch (op.type) {
+        case OpType::SwapMovesets: {
+            if (op.target >= movesets.size()) return false;
+            const auto targetId = movesets[op.target].id;
+            if (op.targetId != 0 && targetId != 0 && targetId != op.targetId) return false;
+            std::swap(movesets[op.moveset], movesets[op.target]);
+            return true;
+        }
+        case OpType::SwapAnimations:
+            if (!animationMatches(op.animation, op.animationId) || !animationMatches(op.target, op.targetId)) {
+                return false;
+            }
+            std::swap(animations[op.animation], animations[op.target]);
+            return true;
+        case OpType::SetMovesetSelected:
+            moveset.selected = op.after != 0;
+            return true;
+        case OpType::SetAnimationSelected:
+            if (!animationMatches(op.animation, op.animationId)) return false;
+            animations[op.animation].selected = op.after != 0;
+            return true;
+        case OpType::SetAnimationFlags:
+            if (!animationMatches(op.animation, op.animationId)) return false;
+            animations[op.animation].flags = op.after;
+            return true;
+        case OpType::RemoveMoveset:
+            movesets.erase(movesets.begin() + op.moveset);
+            return true;
+        case OpType::InsertAnimation:
+            if (op.animation > animations.size()) return false;
+            animations.insert(animations.begin() + op.animation, op.animationData);
+            return true;
+        case OpType::RemoveAnimation:
+            if (!animationMatches(op.animation, op.animationData.sourceSubId)) return false;
+            animations.erase(animations.begin() + op.animation);
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool StanceJournal::Apply(StanceStore::StanceMap& stances, const Op& op) {
+    if (op.instance >= StanceStore::kInstanceCount) return false;
+    // Categoria que nunca teve stance não está no snapshot: a primeira inserção a cria.
+    const auto [category, inserted] = stances.try_emplace(op.category);
+    if (Apply(category->second[op.instance], op)) return true;
+    if (inserted) stances.erase(category);
+    return false;
+}
+
+std::vector<StanceJournal::Op> StanceJournal::Replay(StanceStore::StanceMap& stances, std::vector<Op> ops,
+                                                     std::size_t* brokenInstances) {
+    std::set<std::pair<std::string, std::uint8_t>> broken;
+    std::vector<Op> applied;
+    applied.reserve(ops.size());
+    for (auto& op : ops) {
+        auto key = std::make_pair(op.category, op.instance);
+        if (broken.contains(key)) continue;
+        if (!Apply(stances, op)) {
+            broken.insert(std::move(key));
+            continue;
+        }
+        applied.push_back(std::move(op));
+    }
+    if (brokenInstances) *brokenInstances = broken.size();
+    return applied;
+}
+
+std::string StanceJournal::Header(std::uint64_t snapshotHash) {
+    BinaryWriter writer;
+    writer.Write(kMagic);
+    writer.Write(kVersion);
+    writer.Write(snapshotHash);
+    return std::string(writer.Data().begin(), writer.Data().end());
+}
+
+std::string StanceJournal::Encode(const Op& op) {
+    BinaryWriter body;
+    body.Write(op.type);
+    body.WriteString(op.category);
+    body.Write(op.instance);
+    body.Write(op.moveset);
+    body.Write(op.movesetId);
+    switch (op.type) {
+        case OpType::SwapMovesets:
+            body.Write(op.target);
+            body.Write(op.targetId);
+            break;
+        case OpType::SwapAnimations:
+            body.Write(op.animation);
+            body.Write(op.target);
+            body.Write(op.animationId);
+            body.Write(op.targetId);
+            break;
+        case OpType::SetMovesetSelected:
+            body.Write(op.before);
+            body.Write(op.after);
+            break;
+        case OpType::SetAnimationSelected:
+        case OpType::SetAnimationFlags:
+            body.Write(op.animation);
+            body.Write(op.before);
+            body.Write(op.after);
+            body.Write(op.animationId);
+            break;
+        case OpType::InsertMoveset:
+        case OpType::RemoveMoveset:
+            WriteMoveset(body, op.movesetData);
+            break;
+        case OpType::InsertAnimation:
+        case OpType::RemoveAnimation:
+            body.Write(op.animation);
+            WriteAnimation(body, op.animationData);
+            break;
+    }
+
+    BinaryWriter record;
+    record.Write(static_cast<std::uint32_t>(body.Data().size()));
+    std::string encoded(record.Data().begin(), record.Data().end());
+    encoded.append(body.Data().begin(), body.Data().end());
+    return encoded;
+}
+
+std::optional<std::vector<StanceJournal::Op>> StanceJournal::Load(std::uint64_t snapshotHash, bool* outdated) {
+    std::ifstream file(kJournalPath, std::ios::binary);
+    Diagnostics::CountFsCalls();
+    if (!file) return std::nullopt;
+    std::vector<char> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    Diagnostics::CountRead(buffer.size());
+
+    BinaryReader reader(buffer);
+    const bool magicOk = reader.Read<std::uint32_t>() == kMagic;
+    const auto version = reader.Read<std::uint32_t>();
+    const bool versionOk = version >= 1 && version <= kVersion;
+    const auto journalSnapshot = reader.Read<std::uint64_t>();
+    if (!reader.Ok() || !magicOk || !versionOk) {
+        SKSE::log::warn("Diário de stances inválido ou de outra versão: {}", kJournalPath);
+        return std::nullopt;
+    }
+    if (journalSnapshot != snapshotHash) {
+        SKSE::log::info("Diário de stances de outro snapshot; o store já contém essas edições.");
+        return std::nullopt;
+    }
+    if (outdated) *outdated = version < kVersion;
+
+    std::vector<Op> ops;
+    while (!reader.AtEnd()) {
+        const auto length = reader.Read<std::uint32_t>();
+        if (!reader.Ok() || reader.Remaining() < length) break;  // Registro cortado
+        const auto recordEnd = reader.Offset() + length;
+
+        Op op;
+        bool knownType = true;
+        op.type = reader.Read<OpType>();
+        op.category = reader.ReadString<char>();
+        op.instance = reader.Read<std::uint8_t>();
+        op.moveset = reader.Read<std::uint32_t>();
+        op.movesetId = reader.Read<std::uint64_t>();
+        switch (op.type) {
+            case OpType::SwapMovesets:
+                op.target = reader.Read<std::uint32_t>();
+                if (version >= 2) op.targetId = reader.Read<std::uint64_t>();
+                break;
+            case OpType::SwapAnimations:
+                op.animation = reader.Read<std::uint32_t>();
+                op.target = reader.Read<std::uint32_t>();
+                if (version >= 2) {
+                    op.animationId = reader.Read<std::uint64_t>();
+                    op.targetId = reader.Read<std::uint64_t>();
+                }
+                break;
+            case OpType::SetMovesetSelected:
+                op.before = reader.Read<std::uint16_t>();
+                op.after = reader.Read<std::uint16_t>();
+                break;
+            case OpType::SetAnimationSelected:
+            case OpType::SetAnimationFlags:
+                op.animation = reader.Read<std::uint32_t>();
+                op.before = reader.Read<std::uint16_t>();
+                op.after = reader.Read<std::uint16_t>();
+                if (version >= 2) op.animationId = reader.Read<std::uint64_t>();
+                break;
+            case OpType::InsertMoveset:
+            case OpType::RemoveMoveset:
+                op.movesetData = ReadMoveset(reader);
+                break;
+            case OpType::InsertAnimation:
+            case OpType::RemoveAnimation:
+                op.animation = reader.Read<std::uint32_t>();
+                op.animationData = ReadAnimation(reader);
+                break;
+            default:
+                knownType = false;
+                break;
+        }
+        if (!knownType || !reader.Ok() || reader.Offset() != recordEnd) {
+            SKSE::log::warn("Registro inválido no diário de stances; {} registros anteriores aproveitados.",
+                            ops.size());
+            break;
+        }
+        ops.push_back(std::move(op));
+    }
+    return ops;
+}
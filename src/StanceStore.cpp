@@ -0,0 +1,347 @@
+﻿#include "StanceStore.h"
+
+#include <cstdio>
+#include <fstream>
+#include <unordered_map>
+#include "AtomicFile.h"
+#include "BinaryStream.h"
+#include "Diagnostics.h"
+#include "ManagedManifest.h"
+#include "rapidjson/document.h"
+#include "rapidjson/filereadstream.h"
+#include "rapidjson/prettywriter.h"
+#include "rapidjson/stringbuffer.h"
+
+namespace {
+    constexpr std::uint32_t kMagic = 0x54534D43;  // "CMST"
+    constexpr std::uint32_t kVersion = 3;  // 2: LibraryId de cada moveset e sub-animação. 3: itens desmarcados
+
+    // Byte de estado de cada moveset. Nas versões 1 e 2 só existia o bit de moveset de usuário.
+    constexpr std::uint8_t kMovesetUser = 1 << 0;
+    constexpr std::uint8_t kMovesetDisabled = 1 << 1;
+
+    // Menor registro possível na versão 1: índice do nome, estado e contagem / índices dos nomes e flags.
+    constexpr std::size_t kMinMovesetSize = sizeof(std::uint32_t) + sizeof(std::uint8_t) + sizeof(std::uint32_t);
+    constexpr std::size_t kMinAnimationSize = 2 * sizeof(std::uint32_t) + sizeof(std::uint16_t);
+
+    // Nomes das flags no JSON, na ordem dos bits.
+    constexpr const char* kFlagNames[] = {"pFront",     "pBack",      "pLeft",     "pRight",  "pFrontRight",
+                                          "pFrontLeft", "pBackRight", "pBackLeft", "pRandom", "pDodge"};
+
+    // Os mesmos nomes de mod e sub-animação se repetem em todas as stances: cada texto é gravado uma vez numa
+    // tabela no início do arquivo e o resto só guarda o índice.
+    class StringTable {
+    public:
+        std::uint32_t Add(const std::string& text) {
+            const auto [it, inserted] = _indexByText.try_emplace(text, static_cast<std::uint32_t>(_texts.size()));
+            if (inserted) _texts.push_back(&it->first);
+            return it->second;
+        }
+        void WriteTo(BinaryWriter& writer) const {
+            writer.Write(static_cast<std::uint32_t>(_texts.size()));
+            for (const auto* text : _texts) writer.WriteString(*text);
+        }
+
+    private:
+        std::unordered_map<std::string, std::uint32_t> _indexByText;
+        std::vector<const std::string*> _texts;
+    };
+
+    bool GetBool(const rapidjson::Value& object, const char* name) {
+        const auto member = object.FindMember(name);
+        return member != object.MemberEnd() && member->value.IsBool() && member->value.GetBool();
+    }
+
+    const char* GetString(const rapidjson::Value& object, const char* name) {
+        const auto member = object.FindMember(name);
+        return member != object.MemberEnd() && member->value.IsString() ? member->value.GetString() : nullptr;
+    }
+}
+
+std::uint16_t StanceStore::PackFlags(const SubAnimationInstance& subInstance) {
+    const bool values[] = {subInstance.pFront,     subInstance.pBack,      subInstance.pLeft,
+                           subInstance.pRight,     subInstance.pFrontRight, subInstance.pFrontLeft,
+                           subInstance.pBackRight, subInstance.pBackLeft,  subInstance.pRandom,
+                           subInstance.pDodge};
+    std::uint16_t flags = 0;
+    for (std::size_t bit = 0; bit < std::size(values); ++bit) {
+        if (values[bit]) flags |= static_cast<std::uint16_t>(1u << bit);
+    }
+    return flags;
+}
+
+void StanceStore::UnpackFlags(std::uint16_t flags, SubAnimationInstance& subInstance) {
+    subInstance.pFront = flags & kFront;
+    subInstance.pBack = flags & kBack;
+    subInstance.pLeft = flags & kLeft;
+    subInstance.pRight = flags & kRight;
+    subInstance.pFrontRight = flags & kFrontRight;
+    subInstance.pFrontLeft = flags & kFrontLeft;
+    subInstance.pBackRight = flags & kBackRight;
+    subInstance.pBackLeft = flags & kBackLeft;
+    subInstance.pRandom = flags & kRandom;
+    subInstance.pDodge = flags & kDodge;
+}
+
+std::optional<StanceStore::StanceMap> StanceStore::Load(std::uint64_t* contentHash, LoadError* error) {
+    auto fail = [error](LoadError reason) -> std::optional<StanceMap> {
+        if (error) *error = reason;
+        return std::nullopt;
+    };
+    std::ifstream file(kStorePath, std::ios::binary);
+    Diagnostics::CountFsCalls();
+    if (!file) {
+        // Sem conseguir nem conferir, vale como existente: é o caso em que nada pode ser gravado por cima.
+        std::error_code existsError;
+        const bool exists = std::filesystem::exists(kStorePath, existsError) || existsError;
+        Diagnostics::CountFsCalls();
+        return fail(exists ? LoadError::Unreadable : LoadError::Missing);
+    }
+    std::vector<char> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    Diagnostics::CountRead(buffer.size());
+    if (contentHash) *contentHash = Fnv1a64(std::string_view(buffer.data(), buffer.size()));
+
+    BinaryReader reader(buffer);
+    const bool magicOk = reader.Read<std::uint32_t>() == kMagic;
+    const auto version = reader.Read<std::uint32_t>();
+    if (magicOk && version > kVersion) {
+        SKSE::log::warn("Arquivo de stances de uma versão mais nova ({}): {}", version, kStorePath);
+        return fail(LoadError::NewerVersion);
+    }
+    if (!magicOk || version < 1) {
+        SKSE::log::warn("Arquivo de stances de outra versão: {}", kStorePath);
+        return fail(LoadError::Unreadable);
+    }
+
+    // Cada contagem é conferida contra o tamanho mínimo dos seus elementos antes de alocar ou iterar.
+    std::vector<std::string> texts(reader.ReadCount(sizeof(std::uint32_t)));
+    for (auto& text : texts) {
+        if (!reader.Ok()) break;
+        text = reader.ReadString<char>();
+    }
+    bool badIndex = false;
+    auto text = [&](std::uint32_t index) -> const std::string& {
+        static const std::string empty;
+        if (index < texts.size()) return texts[index];
+        badIndex = true;
+        return empty;
+    };
+
+    StanceMap stances;
+    const auto categoryCount = reader.ReadCount(sizeof(std::uint32_t) * (1 + kInstanceCount));
+    for (std::uint32_t c = 0; c < categoryCount && reader.Ok(); ++c) {
+        auto& instances = stances[text(reader.Read<std::uint32_t>())];
+        for (auto& instance : instances) {
+            const auto movesetCount = reader.ReadCount(kMinMovesetSize);
+            for (std::uint32_t m = 0; m < movesetCount && reader.Ok(); ++m) {
+                Moveset moveset;
+                moveset.name = text(reader.Read<std::uint32_t>());
+                if (version >= 2) moveset.id = reader.Read<std::uint64_t>();
+                const auto movesetState = reader.Read<std::uint8_t>();
+                moveset.userMoveset = movesetState & kMovesetUser;
+                moveset.selected = !(movesetState & kMovesetDisabled);
+                const auto animationCount = reader.ReadCount(kMinAnimationSize);
+                for (std::uint32_t a = 0; a < animationCount && reader.Ok(); ++a) {
+                    Animation animation;
+                    animation.sourceModName = text(reader.Read<std::uint32_t>());
+                    animation.sourceSubName = text(reader.Read<std::uint32_t>());
+                    if (version >= 2) {
+                        animation.sourceModId = reader.Read<std::uint64_t>();
+                        animation.sourceSubId = reader.Read<std::uint64_t>();
+                    }
+                    animation.flags = reader.Read<std::uint16_t>();
+                    if (version >= 3) animation.selected = reader.Read<std::uint8_t>() == 0;
+                    moveset.animations.push_back(std::move(animation));
+                }
+                instance.push_back(std::move(moveset));
+            }
+        }
+    }
+
+    if (!reader.Ok() || !reader.AtEnd() || badIndex) {
+        SKSE::log::warn("Arquivo de stances corrompido: {}", kStorePath);
+        return fail(LoadError::Unreadable);
+    }
+    return stances;
+}
+
+bool StanceStore::Quarantine() {
+    std::error_code error;
+    std::filesystem::rename(kStorePath, kQuarantinePath, error);
+    Diagnostics::CountFsCalls();
+    if (error) {
+        SKSE::log::error("Não foi possível mover {} para {}: {}", kStorePath, kQuarantinePath, error.message());
+        return false;
+    }
+    return true;
+}
+
+std::string StanceStore::Serialize(const StanceMap& stances) {
+    StringTable table;
+    BinaryWriter body;
+    body.Write(static_cast<std::uint32_t>(stances.size()));
+    for (const auto& [category, instances] : stances) {
+        body.Write(table.Add(category));
+        for (const auto& instance : instances) {
+            body.Write(static_cast<std::uint32_t>(instance.size()));
+            for (const auto& moveset : instance) {
+                body.Write(table.Add(moveset.name));
+                body.Write(moveset.id);
+                body.Write(static_cast<std::uint8_t>((moveset.userMoveset ? kMovesetUser : 0) |
+                                                     (moveset.selected ? 0 : kMovesetDisabled)));
+                body.Write(static_cast<std::uint32_t>(moveset.animations.size()));
+                for (const auto& animation : moveset.animations) {
+                    body.Write(table.Add(animation.sourceModName));
+                    body.Write(table.Add(animation.sourceSubName));
+                    body.Write(animation.sourceModId);
+                    body.Write(animation.sourceSubId);
+                    body.Write(animation.flags);
+                    body.Write(static_cast<std::uint8_t>(!animation.selected));
+                }
+            }
+        }
+    }
+
+    BinaryWriter writer;
+    writer.Write(kMagic);
+    writer.Write(kVersion);
+    table.WriteTo(writer);
+    std::string content(writer.Data().begin(), writer.Data().end());
+    content.append(body.Data().begin(), body.Data().end());
+    return content;
+}
+
+bool StanceStore::ExportJson(const StanceMap& stances, const std::filesystem::path& path) {
+    rapidjson::StringBuffer buffer;
+    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+    writer.StartObject();
+    writer.Key("version");
+    writer.Uint(kVersion);
+    writer.Key("categories");
+    writer.StartArray();
+    for (const auto& [category, instances] : stances) {
+        writer.StartObject();
+        writer.Key("name");
+        writer.String(category.c_str(), static_cast<rapidjson::SizeType>(category.size()));
+        writer.Key("instances");
+        writer.StartArray();
+        for (const auto& instance : instances) {
+            writer.StartArray();
+            for (const auto& moveset : instance) {
+                writer.StartObject();
+                writer.Key("type");
+                writer.String(moveset.userMoveset ? "user_moveset" : "moveset");
+                writer.Key("name");
+                writer.String(moveset.name.c_str(), static_cast<rapidjson::SizeType>(moveset.name.size()));
+                writer.Key("id");
+                writer.Uint64(moveset.id);
+                writer.Key("isSelected");
+                writer.Bool(moveset.selected);
+                writer.Key("animations");
+                writer.StartArray();
+                for (const auto& animation : moveset.animations) {
+                    writer.StartObject();
+                    writer.Key("sourceModName");
+                    writer.String(animation.sourceModName.c_str(),
+                                  static_cast<rapidjson::SizeType>(animation.sourceModName.size()));
+                    writer.Key("sourceSubName");
+                    writer.String(animation.sourceSubName.c_str(),
+                                  static_cast<rapidjson::SizeType>(animation.sourceSubName.size()));
+                    writer.Key("sourceModId");
+                    writer.Uint64(animation.sourceModId);
+                    writer.Key("sourceSubId");
+                    writer.Uint64(animation.sourceSubId);
+                    writer.Key("isSelected");
+                    writer.Bool(animation.selected);
+                    for (std::size_t bit = 0; bit < std::size(kFlagNames); ++bit) {
+                        writer.Key(kFlagNames[bit]);
+                        writer.Bool((animation.flags >> bit) & 1u);
+                    }
+                    writer.EndObject();
+                }
+                writer.EndArray();
+                writer.EndObject();
+            }
+            writer.EndArray();
+        }
+        writer.EndArray();
+        writer.EndObject();
+    }
+    writer.EndArray();
+    writer.EndObject();
+
+    std::filesystem::create_directories(path.parent_path());
+    std::string error;
+    if (!AtomicFileBatch::Write(path, std::string_view(buffer.GetString(), buffer.GetSize()), error)) {
+        SKSE::log::error("Falha ao exportar as stances: {} ({})", path.string(), error);
+        return false;
+    }
+    return true;
+}
+
+std::optional<StanceStore::StanceMap> StanceStore::ImportLegacy(const std::vector<std::string>& categories) {
+    const std::filesystem::path legacyRoot(kLegacyRoot);
+    std::error_code ec;
+    Diagnostics::CountFsCalls();
+    if (!std::filesystem::is_directory(legacyRoot, ec)) return std::nullopt;
+
+    StanceMap stances;
+    std::size_t imported = 0;
+    for (const auto& category : categories) {
+        for (int i = 0; i < kInstanceCount; ++i) {
+            const auto instancePath = legacyRoot / category / ("Instance" + std::to_string(i + 1) + "_Cycle.json");
+            // Sem exists() antes: a própria abertura diz se o arquivo está lá.
+            FILE* fp = nullptr;
+            fopen_s(&fp, instancePath.string().c_str(), "rb");
+            Diagnostics::CountFsCalls();
+            if (!fp) continue;
+
+            char readBuffer[65536];
+            rapidjson::FileReadStream is(fp, readBuffer, sizeof(readBuffer));
+            rapidjson::Document doc;
+            doc.ParseStream(is);
+            fclose(fp);
+            Diagnostics::CountRead(is.Tell());
+
+            if (doc.HasParseError() || !doc.IsObject() || !doc.HasMember("stances") || !doc["stances"].IsArray()) {
+                SKSE::log::warn("Arquivo de stance mal formatado: {}", instancePath.string());
+                continue;
+            }
+
+            auto& instance = stances[category][i];
+            for (const auto& stanceJson : doc["stances"].GetArray()) {
+                if (!stanceJson.IsObject()) continue;
+                const char* name = GetString(stanceJson, "name");
+                if (!name) continue;
+
+                Moveset moveset;
+                moveset.name = name;
+                const char* type = GetString(stanceJson, "type");
+                moveset.userMoveset = type && std::string_view(type) == "user_moveset";
+                if (stanceJson.HasMember("animations") && stanceJson["animations"].IsArray()) {
+                    for (const auto& animJson : stanceJson["animations"].GetArray()) {
+                        if (!animJson.IsObject()) continue;
+                        const char* modName = GetString(animJson, "sourceModName");
+                        const char* subName = GetString(animJson, "sourceSubName");
+                        if (!modName || !subName) continue;
+
+                        Animation animation;
+                        animation.sourceModName = modName;
+                        animation.sourceSubName = subName;
+                        for (std::size_t bit = 0; bit < std::size(kFlagNames); ++bit) {
+                            if (GetBool(animJson, kFlagNames[bit])) {
+                                animation.flags |= static_cast<std::uint16_t>(1u << bit);
+                            }
+                        }
+                        moveset.animations.push_back(std::move(animation));
+                    }
+                }
+                instance.push_back(std::move(moveset));
+            }
+            imported++;
+        }
+    }
+    SKSE::log::info("Importados {} arquivos de stance do formato antigo ({}).", imported, kLegacyRoot);
+    return stances;
+}
@@ -0,0 +1,57 @@
+﻿#include "StateKey.h"
+
+#include <atomic>
+
+namespace {
+    constexpr int kInvalidKey = -1;  // Nenhuma condição gerada compara com valor negativo
+
+    std::atomic<bool> g_enabled{false};
+    std::atomic<int> g_direction{0};
+    std::atomic<int> g_order{0};
+    std::atomic<int> g_published{kInvalidKey};
+
+    // Roda na thread de input e nos eventos do jogo. O valor publicado por último evita chamar o grafo
+    // quando a tecla mudou mas a chave não.
+    void Publish(bool force) {
+        if (!g_enabled.load(std::memory_order_relaxed)) return;
+        auto* player = RE::PlayerCharacter::GetSingleton();
+        if (!player) return;
+
+        float instanceValue = 0.0f;
+        player->GetGraphVariableFloat("cycle_instance", instanceValue);
+        const int instance = static_cast<int>(instanceValue);
+        const int order = g_order.load(std::memory_order_relaxed);
+        const int key = StateKey::CanPack(instance, order)
+                            ? StateKey::Pack(instance, order, g_direction.load(std::memory_order_relaxed))
+                            : kInvalidKey;
+
+        if (g_published.exchange(key) == key && !force) return;
+        static std::atomic<bool> warned{false};
+        const bool published = player->SetGraphVariableFloat(StateKey::kGraphVariable, static_cast<float>(key));
+        if (!published && !warned.exchange(true)) {
+            SKSE::log::warn("Variável {} não existe no behavior; a chave de estado não foi publicada.",
+                            StateKey::kGraphVariable);
+        }
+    }
+}
+
+void StateKey::SetEnabled(bool enabled) {
+    g_enabled = enabled;
+    if (enabled) Publish(true);
+}
+
+bool StateKey::IsEnabled() { return g_enabled.load(std::memory_order_relaxed); }
+
+void StateKey::SetDirection(int direction) {
+    g_direction = direction;
+    Publish(false);
+}
+
+void StateKey::SetPlaylistOrder(int order) {
+    g_order = order;
+    Publish(false);
+}
+
+void StateKey::Refresh() { Publish(true); }
+
+void StateKey::Poll() { Publish(false); }
@@ -0,0 +1,131 @@
+﻿#include "StringPool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+    constexpr std::size_t kBlockSize = 16 * 1024;
+
+    // Blocos de tamanho fixo; o que já foi entregue nunca muda de endereço.
+    class Arena {
+    public:
+        void* Allocate(std::size_t size, std::size_t alignment) {
+            std::size_t offset = (_used + alignment - 1) & ~(alignment - 1);
+            if (_blocks.empty() || offset + size > _blockSize) {
+                _blockSize = std::max(kBlockSize, size);
+                _blocks.push_back(std::make_unique<std::byte[]>(_blockSize));
+                _allocated += _blockSize;
+                offset = 0;
+            }
+            _used = offset + size;
+            return _blocks.back().get() + offset;
+        }
+        std::size_t AllocatedBytes() const { return _allocated; }
+
+    private:
+        std::vector<std::unique_ptr<std::byte[]>> _blocks;
+        std::size_t _blockSize = 0;
+        std::size_t _used = 0;
+        std::size_t _allocated = 0;
+    };
+
+    struct NodeKey {
+        const PathNode* parent;
+        const char* segment;
+        bool operator==(const NodeKey&) const = default;
+    };
+    struct NodeKeyHash {
+        std::size_t operator()(const NodeKey& key) const {
+            return std::hash<const void*>{}(key.parent) * 31 + std::hash<const void*>{}(key.segment);
+        }
+    };
+
+    std::size_t ShardOf(std::size_t hash, std::size_t shardCount) { return (hash >> 7) % shardCount; }
+}
+
+struct StringPool::Shard {
+    mutable std::mutex mutex;
+    Arena arena;
+    std::unordered_set<std::string_view> strings;  // Views para dentro da arena
+    std::unordered_map<NodeKey, const PathNode*, NodeKeyHash> nodes;
+};
+
+StringPool& StringPool::GetSingleton() {
+    static StringPool instance;
+    return instance;
+}
+
+StringPool::StringPool() : _shards(new Shard[kShardCount]) {}
+
+StringPool::~StringPool() { delete[] _shards; }
+
+InternedString StringPool::Intern(std::string_view text) {
+    if (text.empty()) return {};
+    auto& shard = _shards[ShardOf(std::hash<std::string_view>{}(text), kShardCount)];
+    std::lock_guard lock(shard.mutex);
+    auto existing = shard.strings.find(text);
+    if (existing == shard.strings.end()) {
+        auto* data = static_cast<char*>(shard.arena.Allocate(text.size() + 1, 1));
+        std::memcpy(data, text.data(), text.size());
+        data[text.size()] = '\0';
+        existing = shard.strings.insert(std::string_view(data, text.size())).first;
+    }
+    return InternedString(existing->data(), static_cast<std::uint32_t>(existing->size()));
+}
+
+const PathNode* StringPool::InternSegment(const PathNode* parent, std::string_view segmentUtf8) {
+    const auto segment = Intern(segmentUtf8);
+    const NodeKey key{parent, segment.c_str()};
+    auto& shard = _shards[ShardOf(NodeKeyHash{}(key), kShardCount)];
+    std::lock_guard lock(shard.mutex);
+    auto existing = shard.nodes.find(key);
+    if (existing != shard.nodes.end()) return existing->second;
+
+    auto* node = new (shard.arena.Allocate(sizeof(PathNode), alignof(PathNode))) PathNode{parent, segment};
+    shard.nodes.emplace(key, node);
+    return node;
+}
+
+const PathNode* StringPool::InternPath(const std::filesystem::path& path, const PathNode* parent) {
+    for (const auto& component : path) {
+        const auto segment = component.u8string();
+        parent = InternSegment(parent, std::string_view(reinterpret_cast<const char*>(segment.data()), segment.size()));
+    }
+    return parent;
+}
+
+std::filesystem::path StringPool::BuildPath(const PathNode* node) {
+    std::u8string utf8;
+    std::vector<const PathNode*> chain;
+    for (; node; node = node->parent) chain.push_back(node);
+
+    std::filesystem::path result;
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+        const auto segment = (*it)->segment.View();
+        utf8.assign(segment.begin(), segment.end());
+        result /= utf8;
+    }
+    return result;
+}
+
+StringPool::MemoryStats StringPool::GetMemoryStats() const {
+    MemoryStats stats;
+    for (std::size_t i = 0; i < kShardCount; ++i) {
+        const auto& shard = _shards[i];
+        std::lock_guard lock(shard.mutex);
+        stats.strings += shard.strings.size();
+        stats.pathNodes += shard.nodes.size();
+        stats.arenaBytes += shard.arena.AllocatedBytes();
+        // Nó da tabela ~ valor + próximo + hash guardado, mais um ponteiro por bucket.
+        stats.indexBytes += shard.strings.size() * (sizeof(std::string_view) + 2 * sizeof(void*)) +
+                            shard.strings.bucket_count() * sizeof(void*);
+        stats.indexBytes += shard.nodes.size() * (sizeof(NodeKey) + 3 * sizeof(void*)) +
+                            shard.nodes.bucket_count() * sizeof(void*);
+    }
+    return stats;
+}
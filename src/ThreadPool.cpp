@@ -0,0 +1,136 @@
+﻿#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace {
+    // Identifica em qual pool/worker a thread atual está rodando (para Submit local).
+    thread_local const ThreadPool* t_currentPool = nullptr;
+    thread_local std::size_t t_workerIndex = 0;
+}
+
+ThreadPool::ThreadPool(std::size_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+    }
+    _queues.reserve(threadCount);
+    for (std::size_t i = 0; i < threadCount; ++i) {
+        _queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    _threads.reserve(threadCount);
+    for (std::size_t i = 0; i < threadCount; ++i) {
+        _threads.emplace_back([this, i] { WorkerLoop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    Wait();
+    {
+        std::lock_guard lock(_waitMutex);
+        _stopping = true;
+    }
+    _workAvailable.notify_all();
+    for (auto& thread : _threads) {
+        if (thread.joinable()) thread.join();
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+    std::size_t target;
+    if (t_currentPool == this) {
+        target = t_workerIndex;
+    } else {
+        target = _nextQueue.fetch_add(1, std::memory_order_relaxed) % _queues.size();
+    }
+
+    _pending.fetch_add(1, std::memory_order_acq_rel);
+    {
+        std::lock_guard lock(_queues[target]->mutex);
+        _queues[target]->tasks.push_back({std::move(task), Diagnostics::ActivePhase()});
+    }
+    {
+        // Incrementa sob o _waitMutex para não perder o wake-up de um worker que está indo dormir.
+        std::lock_guard lock(_waitMutex);
+        _queued.fetch_add(1, std::memory_order_release);
+    }
+    _workAvailable.notify_one();
+}
+
+void ThreadPool::Wait() {
+    Task task;
+    while (_pending.load(std::memory_order_acquire) > 0) {
+        // Ajuda a esvaziar as filas em vez de só esperar.
+        if (TrySteal(_queues.size(), task)) {
+            RunTask(task);
+            continue;
+        }
+        std::unique_lock lock(_waitMutex);
+        _allDone.wait(lock, [this] {
+            return _pending.load(std::memory_order_acquire) == 0 || _queued.load(std::memory_order_acquire) > 0;
+        });
+    }
+}
+
+bool ThreadPool::TryPopLocal(std::size_t index, Task& out) {
+    auto& queue = *_queues[index];
+    std::lock_guard lock(queue.mutex);
+    if (queue.tasks.empty()) return false;
+    out = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    _queued.fetch_sub(1, std::memory_order_acq_rel);
+    return true;
+}
+
+bool ThreadPool::TrySteal(std::size_t thief, Task& out) {
+    const std::size_t count = _queues.size();
+    for (std::size_t offset = 1; offset <= count; ++offset) {
+        const std::size_t victim = (thief + offset) % count;
+        if (victim == thief) continue;
+        auto& queue = *_queues[victim];
+        std::lock_guard lock(queue.mutex);
+        if (queue.tasks.empty()) continue;
+        out = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        _queued.fetch_sub(1, std::memory_order_acq_rel);
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::RunTask(Task& task) {
+    // O _pending desce mesmo se a tarefa lançar; senão Wait() ficaria preso para sempre.
+    struct PendingGuard {
+        ThreadPool& pool;
+        ~PendingGuard() {
+            if (pool._pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard lock(pool._waitMutex);
+                pool._allDone.notify_all();
+            }
+        }
+    } guard{*this};
+
+    try {
+        Diagnostics::ScopedAttribution attribution(task.phase);
+        task.run();
+    } catch (const std::exception& e) {
+        SKSE::log::error("Exceção não tratada numa tarefa do pool de threads: {}", e.what());
+    } catch (...) {
+        SKSE::log::error("Exceção desconhecida numa tarefa do pool de threads.");
+    }
+    task = {};
+}
+
+void ThreadPool::WorkerLoop(std::size_t index) {
+    t_currentPool = this;
+    t_workerIndex = index;
+
+    Task task;
+    while (true) {
+        if (TryPopLocal(index, task) || TrySteal(index, task)) {
+            RunTask(task);
+            continue;
+        }
+        std::unique_lock lock(_waitMutex);
+        _workAvailable.wait(lock, [this] { return _stopping || _queued.load(std::memory_order_acquire) > 0; });
+        if (_stopping && _queued.load(std::memory_order_acquire) == 0) return;
+    }
+}
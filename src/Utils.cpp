@@ -1,5 +1,7 @@
 #include "RE/A/Actor.h"
+#include "Autosave.h"
 #include "Serialization.h"
+#include "StateKey.h"
 #include "Utils.h"
 
 // A varivel global que voc quer alterar
@@ -17,6 +19,8 @@ RE::BSEventNotifyControl InputListener::ProcessEvent(RE::InputEvent* const* a_ev
     if (!a_event || !*a_event) {
         return RE::BSEventNotifyControl::kContinue;
     }
+    // cycle_instance pode mudar sem passar pelo plugin; a chave  conferida antes de qualquer tecla de ataque.
+    StateKey::Poll();
 
     bool umaTeclaDeMovimentoMudou = false;
 
@@ -117,6 +121,7 @@ void InputListener::UpdateDirectionalState() {
     // Opcional: s imprime no log se o valor mudar, para no poluir o log.
     if (VariavelAnterior != DirecionalCycleMoveset) {
         SKSE::log::info("DirecionalCycleMoveset alterado para: {}", DirecionalCycleMoveset);
+        StateKey::SetDirection(static_cast<int>(DirecionalCycleMoveset));
         // Aqui voc enviaria o valor para sua animao, por exemplo:
         // RE::PlayerCharacter::GetSingleton()->SetGraphVariableFloat("MinhaVariavelDirecional",
         // DirecionalCycleMoveset);
@@ -182,6 +187,7 @@ void GlobalControl::MovesetSink::ProcessEvent(SkyPromptAPI::PromptEvent event) c
 
         case SkyPromptAPI::kDeclined:
             RE::PlayerCharacter::GetSingleton()->SetGraphVariableFloat("testarone", 0);
+            StateKey::SetPlaylistOrder(0);
             break;
 
         case SkyPromptAPI::kUp:
@@ -209,6 +215,7 @@ void GlobalControl::MovesetChangesSink::ProcessEvent(SkyPromptAPI::PromptEvent e
             cycleplayer -= 1.0f;
             logger::info("Variavel Global decrementada para: {}", cycleplayer);
             RE::PlayerCharacter::GetSingleton()->SetGraphVariableFloat("testarone", cycleplayer);
+            StateKey::SetPlaylistOrder(static_cast<int>(cycleplayer));
             RE::DebugNotification(std::format("Variavel: {:.0f}", cycleplayer).c_str());
             break;
 
@@ -216,6 +223,7 @@ void GlobalControl::MovesetChangesSink::ProcessEvent(SkyPromptAPI::PromptEvent e
             cycleplayer += 1.0f;
             logger::info("Variavel Global incrementada para: {}", cycleplayer);
             RE::PlayerCharacter::GetSingleton()->SetGraphVariableFloat("testarone", cycleplayer);
+            StateKey::SetPlaylistOrder(static_cast<int>(cycleplayer));
             RE::DebugNotification(std::format("Variavel: {:.0f}", cycleplayer).c_str());
             break;
 
@@ -224,6 +232,7 @@ void GlobalControl::MovesetChangesSink::ProcessEvent(SkyPromptAPI::PromptEvent e
             logger::info("Variavel Global resetada para 0.");
             RE::DebugNotification(std::format("Variavel: {:.0f}", cycleplayer).c_str());
             RE::PlayerCharacter::GetSingleton()->SetGraphVariableFloat("testarone", cycleplayer);
+            StateKey::SetPlaylistOrder(static_cast<int>(cycleplayer));
             break;
 
     }
@@ -269,6 +278,7 @@ RE::BSEventNotifyControl GlobalControl::ActionEventHandler::ProcessEvent(const S
         if (a_event->type == SKSE::ActionEvent::Type::kBeginDraw) {
             SKSE::log::info("Arma sacada, mostrando o menu.");
             g_isWeaponDrawn = true;  // Define nosso controle como verdadeiro
+            StateKey::Refresh();     // cycle_instance pode ter mudado fora do plugin
         }
         // Jogador terminou de guardar a arma
         else if (a_event->type == SKSE::ActionEvent::Type::kEndSheathe) {
@@ -311,7 +321,13 @@ bool GlobalControl::IsThirdPerson() {
 
 RE::BSEventNotifyControl GlobalControl::MenuOpen::ProcessEvent(const RE::MenuOpenCloseEvent* event,
                                                                RE::BSTEventSource<RE::MenuOpenCloseEvent>*) {
-
+    // Toda sada do jogo passa por um destes menus (Sair no menu de pausa, qqq no console, voltar ao menu
+    // principal). O Autosave grava o que estiver pendente aqui, enquanto o processo ainda est inteiro.
+    if (event && event->opening &&
+        (event->menuName == RE::JournalMenu::MENU_NAME || event->menuName == RE::Console::MENU_NAME ||
+         event->menuName == RE::MainMenu::MENU_NAME)) {
+        Autosave::GetSingleton().Flush();
+    }
 
     if (!IsAnyMenuOpen && IsThirdPerson && g_isWeaponDrawn) {
         SkyPromptAPI::SendPrompt(StancesSink::GetSingleton(), g_clientID);
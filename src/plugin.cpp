@@ -1,4 +1,5 @@
 #include "logger.h"
+#include "Autosave.h"
 #include "Utils.h"
 #include "Events.h"
 #include "Manager.h"
@@ -14,6 +15,11 @@ void OnMessage(SKSE::MessagingInterface::Message* message) {
         
     }
 
+    // O save do jogo e o das stances andam juntos: o que ainda espera o perodo de silncio  gravado agora.
+    if (message->type == SKSE::MessagingInterface::kSaveGame) {
+        Autosave::GetSingleton().Flush();
+    }
+
     if (message->type == SKSE::MessagingInterface::kNewGame || message->type == SKSE::MessagingInterface::kPostLoadGame) {
         // 2. Requisitar um ClientID da API SkyPrompt
         auto* inputDeviceManager = RE::BSInputDeviceManager::GetSingleton();
@@ -61,8 +67,8 @@ SKSEPluginLoad(const SKSE::LoadInterface *skse) {
         SKSE::log::info("Ouvinte de eventos de acao registrado com sucesso!");
     }
 
-     // 1. Escaneia os arquivos de animao para carregar os dados.
-    AnimationManager::GetSingleton().ScanAnimationMods();
+     // 1. Escaneia os arquivos de animao em segundo plano; o menu mostra o progresso at terminar.
+    AnimationManager::GetSingleton().StartLibraryScan();
 
     // 2. ALTERAO AQUI: Chame a funo para registrar o menu no framework.
     UI::RegisterMenu();
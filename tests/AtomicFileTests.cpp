@@ -0,0 +1,208 @@
+﻿#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <thread>
+#include <gtest/gtest.h>
+#include "AtomicFile.h"
+
+#ifdef _WIN32
+    #include <Windows.h>
+#else
+    #include <csignal>
+    #include <sys/wait.h>
+    #include <unistd.h>
+#endif
+
+namespace {
+    namespace fs = std::filesystem;
+
+    constexpr int kTargets = 8;
+
+    fs::path TargetPath(const fs::path& dir, int index) {
+        return dir / ("mod" + std::to_string(index)) / "config.json";
+    }
+
+    fs::path MakeScratchDir(std::string_view name) {
+        const auto dir = fs::temp_directory_path() / name;
+        fs::remove_all(dir);
+        for (int i = 0; i < kTargets; ++i) fs::create_directories(TargetPath(dir, i).parent_path());
+        return dir;
+    }
+
+    std::string ReadAll(const fs::path& path) {
+        std::ifstream file(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(file), {});
+    }
+
+    // Conteúdo verificável: cabeçalho e rodapé com a geração e o miolo todo com a mesma letra, em tamanhos que
+    // variam a cada geração. Um arquivo truncado ou misturado com outra geração não passa em IsIntact.
+    std::string MakeContent(int generation, int index) {
+        std::string content = "BEGIN " + std::to_string(generation) + "\n";
+        const auto size = 20000 + static_cast<std::size_t>((generation * 7919LL + index * 104729LL) % 60000);
+        content.append(size, static_cast<char>('a' + generation % 26));
+        content += "\nEND " + std::to_string(generation) + "\n";
+        return content;
+    }
+
+    bool IsIntact(const std::string& content) {
+        if (!content.starts_with("BEGIN ")) return false;
+        const auto headerEnd = content.find('\n');
+        if (headerEnd == std::string::npos) return false;
+        const auto generation = content.substr(6, headerEnd - 6);
+        const auto footer = "\nEND " + generation + "\n";
+        if (content.size() < headerEnd + footer.size() || !content.ends_with(footer)) return false;
+        const char fill = static_cast<char>('a' + std::atoi(generation.c_str()) % 26);
+        for (auto i = headerEnd + 1; i < content.size() - footer.size(); ++i) {
+            if (content[i] != fill) return false;
+        }
+        return true;
+    }
+
+    // Lotes sem fim sobre os mesmos destinos, até o processo ser morto.
+    [[noreturn]] void WriteForever(const fs::path& dir) {
+        for (int generation = 0;; ++generation) {
+            AtomicFileBatch batch;
+            std::string error;
+            for (int i = 0; i < kTargets; ++i) batch.Stage(TargetPath(dir, i), MakeContent(generation, i), error);
+            batch.Commit();
+        }
+    }
+
+#ifdef _WIN32
+    // No Windows não há fork: o escritor é o próprio executável dos testes, rodando só WriterProcess com a pasta
+    // no ambiente herdado.
+    constexpr const wchar_t* kWriterDirVariable = L"CYCLEMOVESETS_ATOMIC_WRITER_DIR";
+
+    class WriterProcess {
+    public:
+        explicit WriterProcess(const fs::path& dir) {
+            SetEnvironmentVariableW(kWriterDirVariable, dir.c_str());
+            wchar_t executable[MAX_PATH];
+            GetModuleFileNameW(nullptr, executable, MAX_PATH);
+            std::wstring commandLine =
+                L"\"" + std::wstring(executable) + L"\" --gtest_filter=AtomicFileFaultInjection.WriterProcess";
+            STARTUPINFOW startup{};
+            startup.cb = sizeof(startup);
+            _started = CreateProcessW(executable, commandLine.data(), nullptr, nullptr, FALSE, CREATE_NO_WINDOW,
+                                      nullptr, nullptr, &startup, &_process) != 0;
+            SetEnvironmentVariableW(kWriterDirVariable, nullptr);
+        }
+
+        bool Started() const { return _started; }
+
+        void Kill() {
+            TerminateProcess(_process.hProcess, 1);
+            WaitForSingleObject(_process.hProcess, INFINITE);
+            CloseHandle(_process.hThread);
+            CloseHandle(_process.hProcess);
+        }
+
+    private:
+        PROCESS_INFORMATION _process{};
+        bool _started = false;
+    };
+#else
+    class WriterProcess {
+    public:
+        explicit WriterProcess(const fs::path& dir) : _pid(fork()) {
+            if (_pid == 0) WriteForever(dir);
+        }
+
+        bool Started() const { return _pid > 0; }
+
+        void Kill() {
+            kill(_pid, SIGKILL);
+            waitpid(_pid, nullptr, 0);
+        }
+
+    private:
+        pid_t _pid;
+    };
+#endif
+}
+
+TEST(AtomicFile, WriteReplacesContent) {
+    const auto dir = MakeScratchDir("cyclemovesets_atomic_write");
+    const auto target = TargetPath(dir, 0);
+    std::string error;
+    ASSERT_TRUE(AtomicFileBatch::Write(target, "antigo", error)) << error;
+    ASSERT_TRUE(AtomicFileBatch::Write(target, "novo", error)) << error;
+    EXPECT_EQ(ReadAll(target), "novo");
+    EXPECT_FALSE(fs::exists(fs::path(target) += AtomicFileBatch::kTempSuffix));
+    fs::remove_all(dir);
+}
+
+TEST(AtomicFile, UncommittedBatchLeavesTargetsAlone) {
+    const auto dir = MakeScratchDir("cyclemovesets_atomic_uncommitted");
+    const auto target = TargetPath(dir, 0);
+    std::string error;
+    ASSERT_TRUE(AtomicFileBatch::Write(target, "antigo", error)) << error;
+    {
+        AtomicFileBatch batch;
+        ASSERT_TRUE(batch.Stage(target, "novo", error)) << error;
+        EXPECT_EQ(batch.GetStagedCount(), 1u);
+    }
+    EXPECT_EQ(ReadAll(target), "antigo");
+    EXPECT_FALSE(fs::exists(fs::path(target) += AtomicFileBatch::kTempSuffix));
+    fs::remove_all(dir);
+}
+
+TEST(AtomicFile, FailedSwapKeepsOtherTargetsAndDiscardsTemp) {
+    const auto dir = MakeScratchDir("cyclemovesets_atomic_failed");
+    // Uma pasta com conteúdo no lugar do destino: o rename tem que falhar nos dois sistemas.
+    const auto blocked = TargetPath(dir, 0);
+    fs::create_directories(blocked / "ocupado");
+    const auto target = TargetPath(dir, 1);
+
+    AtomicFileBatch batch;
+    std::string error;
+    ASSERT_TRUE(batch.Stage(blocked, "bloqueado", error)) << error;
+    ASSERT_TRUE(batch.Stage(target, "novo", error)) << error;
+    const auto failures = batch.Commit();
+    ASSERT_EQ(failures.size(), 1u);
+    EXPECT_EQ(failures.front().first, blocked);
+    EXPECT_FALSE(failures.front().second.empty());
+    EXPECT_TRUE(fs::is_directory(blocked));
+    EXPECT_FALSE(fs::exists(fs::path(blocked) += AtomicFileBatch::kTempSuffix));
+    EXPECT_EQ(ReadAll(target), "novo");
+    fs::remove_all(dir);
+}
+
+// Um processo grava lotes sem parar e é morto num ponto aleatório, muitas vezes no meio do Commit. Depois de
+// cada morte, todo destino que existe tem que estar inteiro, de uma geração só. Temporários órfãos são aceitos:
+// o próximo Stage do mesmo destino os sobrescreve.
+TEST(AtomicFileFaultInjection, KilledWriterNeverLeavesTornFiles) {
+    const auto dir = MakeScratchDir("cyclemovesets_atomic_kill");
+    std::mt19937 random(13);
+    std::uniform_int_distribution<int> delay(1, 20);
+    int checked = 0;
+    for (int run = 0; run < 60; ++run) {
+        WriterProcess writer(dir);
+        ASSERT_TRUE(writer.Started());
+        std::this_thread::sleep_for(std::chrono::milliseconds(delay(random)));
+        writer.Kill();
+        for (int i = 0; i < kTargets; ++i) {
+            const auto target = TargetPath(dir, i);
+            if (!fs::exists(target)) continue;
+            const auto content = ReadAll(target);
+            EXPECT_TRUE(IsIntact(content)) << "rodada " << run << ", " << target << ", " << content.size() << " bytes";
+            ++checked;
+        }
+    }
+    EXPECT_GT(checked, 0);
+
+    std::string error;
+    EXPECT_TRUE(AtomicFileBatch::Write(TargetPath(dir, 0), MakeContent(0, 0), error)) << error;
+    fs::remove_all(dir);
+}
+
+#ifdef _WIN32
+// O lado escritor do teste acima. Sem a variável de ambiente, não faz nada.
+TEST(AtomicFileFaultInjection, WriterProcess) {
+    const wchar_t* dir = _wgetenv(kWriterDirVariable);
+    if (!dir) GTEST_SKIP() << "Só roda como processo filho de KilledWriterNeverLeavesTornFiles";
+    WriteForever(fs::path(dir));
+}
+#endif
@@ -0,0 +1,150 @@
+﻿#include <random>
+#include <gtest/gtest.h>
+#include "ConditionIR.h"
+#include "Samples.h"
+#include "StateKey.h"
+
+namespace {
+    using ConditionIR::Kind;
+    using ConditionIR::Node;
+
+    // O que o OAR enxerga ao avaliar o bloco: as variáveis do grafo e a arma equipada.
+    struct GraphState {
+        double rightType = 0.0;
+        double leftType = 0.0;
+        int instance = 0;
+        int order = 0;
+        int direction = 0;
+        int random = 0;
+        int disable = 0;
+
+        double Key() const { return StateKey::Pack(instance, order, direction); }
+    };
+
+    bool Evaluate(const Node& node, const GraphState& state) {
+        switch (node.kind) {
+            case Kind::And:
+                return std::ranges::all_of(node.children, [&](const Node& child) { return Evaluate(child, state); });
+            case Kind::Or:
+                return std::ranges::any_of(node.children, [&](const Node& child) { return Evaluate(child, state); });
+            case Kind::ActorBase:
+                return true;
+            case Kind::EquippedRight:
+                return state.rightType == node.value;
+            case Kind::EquippedLeft:
+                return state.leftType == node.value;
+            case Kind::CycleInstance:
+                return state.instance == node.value;
+            case Kind::PlaylistOrder:
+                return state.order == node.value;
+            case Kind::NegatedDirection:
+                return state.direction != node.value;
+            case Kind::Random:
+                return state.random == node.value;
+            case Kind::Direction:
+                return state.direction == node.value;
+            case Kind::KillSwitch:
+                return state.disable == node.value;
+            case Kind::StateEquals:
+                return state.Key() == node.value;
+            case Kind::StateNotEquals:
+                return state.Key() != node.value;
+            case Kind::StateAtLeast:
+                return node.value <= state.Key();
+            case Kind::StateAtMost:
+                return node.value >= state.Key();
+        }
+        return false;
+    }
+
+    // Todas as combinações de variáveis que as configurações dos testes conseguem distinguir.
+    std::vector<GraphState> AllStates() {
+        std::vector<GraphState> states;
+        for (double rightType : {1.0, 2.0}) {
+            for (double leftType : {0.0, 1.0, 2.0}) {
+                for (int instance = 0; instance <= 3; ++instance) {
+                    for (int order = 0; order <= 4; ++order) {
+                        for (int direction = 0; direction <= StateKey::kMaxDirection; ++direction) {
+                            for (int random = 0; random <= 4; ++random) {
+                                states.push_back({rightType, leftType, instance, order, direction, random, 0});
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        return states;
+    }
+
+    ::testing::AssertionResult Equivalent(const Node& expected, const Node& actual) {
+        static const auto states = AllStates();
+        for (const auto& state : states) {
+            if (Evaluate(expected, state) != Evaluate(actual, state)) {
+                return ::testing::AssertionFailure()
+                       << "difere com tipo " << state.rightType << "/" << state.leftType << ", instância "
+                       << state.instance << ", ordem " << state.order << ", direção " << state.direction
+                       << ", random " << state.random;
+            }
+        }
+        return ::testing::AssertionSuccess();
+    }
+}
+
+TEST(ConditionIR, EmptyConfigsBuildKillSwitch) {
+    const auto tree = ConditionIR::BuildTree({});
+    ASSERT_EQ(tree.kind, Kind::Or);
+    ASSERT_EQ(tree.children.size(), 1u);
+    const Node expected{Kind::And, 0.0, {Node{Kind::KillSwitch, 1.0, {}}}};
+    EXPECT_EQ(tree.children.front(), expected);
+}
+
+TEST(ConditionIR, ConfigsWithoutPlaylistOrderBuildNothing) {
+    const auto samples = Samples::MakeConditionConfigs();
+    const std::vector<FileSaveConfig> configs{samples->configs.back()};
+    EXPECT_TRUE(ConditionIR::BuildTree(configs).children.empty());
+}
+
+TEST(ConditionIR, OptimizeKeepsSampleSemantics) {
+    const auto samples = Samples::MakeConditionConfigs();
+    const auto naive = ConditionIR::BuildTree(samples->configs);
+    const auto optimized = ConditionIR::Optimize(naive);
+    EXPECT_TRUE(Equivalent(naive, optimized));
+    EXPECT_EQ(ConditionIR::CountNodes(naive), 32u);
+    EXPECT_EQ(ConditionIR::CountNodes(optimized), 26u);
+}
+
+TEST(ConditionIR, PackedStateKeyKeepsSampleSemantics) {
+    const auto samples = Samples::MakeConditionConfigs();
+    const auto naive = ConditionIR::BuildTree(samples->configs);
+    const auto packed = ConditionIR::Optimize(ConditionIR::BuildTree(samples->configs, true));
+    EXPECT_TRUE(Equivalent(naive, packed));
+    EXPECT_EQ(ConditionIR::CountNodes(packed), 21u);
+}
+
+TEST(ConditionIR, OptimizeIsIdempotent) {
+    const auto samples = Samples::MakeConditionConfigs();
+    const auto optimized = ConditionIR::Optimize(ConditionIR::BuildTree(samples->configs));
+    EXPECT_EQ(ConditionIR::Optimize(optimized), optimized);
+}
+
+TEST(ConditionIR, OptimizeKeepsRandomConfigSemantics) {
+    const auto samples = Samples::MakeConditionConfigs();
+    std::mt19937 random(20);
+    for (int round = 0; round < 300; ++round) {
+        const auto configs = Samples::MakeRandomConfigs(random, samples->sword, samples->dualSword);
+        for (const bool packedStateKey : {false, true}) {
+            const auto naive = ConditionIR::BuildTree(configs, packedStateKey);
+            if (naive.children.empty()) continue;
+            const auto optimized = ConditionIR::Optimize(naive);
+            ASSERT_TRUE(Equivalent(naive, optimized)) << "rodada " << round << (packedStateKey ? ", chave única" : "");
+            EXPECT_LE(ConditionIR::CountNodes(optimized), ConditionIR::CountNodes(naive));
+            // A raiz continua sendo um OR de grupos, como o bloco sempre foi escrito.
+            EXPECT_EQ(optimized.kind, Kind::Or);
+            EXPECT_TRUE(std::ranges::all_of(optimized.children, [](const Node& child) { return child.IsGroup(); }));
+        }
+        const auto packed = ConditionIR::BuildTree(configs, true);
+        if (!packed.children.empty()) {
+            ASSERT_TRUE(Equivalent(ConditionIR::BuildTree(configs), packed)) << "rodada " << round;
+        }
+    }
+}
@@ -0,0 +1,75 @@
+﻿#include <gtest/gtest.h>
+#include "ConditionEmitter.h"
+#include "ConditionTemplate.h"
+#include "rapidjson/prettywriter.h"
+
+namespace {
+    // O mesmo protótipo serializado direto pelo rapidjson, como a geração em DOM fazia.
+    template <class Build>
+    std::string SerializeDom(Build build, char indentChar = ' ', unsigned indentCount = 4) {
+        rapidjson::Document doc;
+        rapidjson::Value conditions(rapidjson::kArrayType);
+        build(conditions, doc.GetAllocator());
+        rapidjson::StringBuffer buffer;
+        rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+        writer.SetIndent(indentChar, indentCount);
+        conditions.Accept(writer);
+        return std::string(buffer.GetString(), buffer.GetSize());
+    }
+}
+
+TEST(ConditionTemplate, CompactRenderFillsSlots) {
+    const auto& templates = ConditionEmitter::GetTemplates().compact;
+    std::string out;
+    templates.equippedRight.Render(out, {2.0});
+    EXPECT_EQ(out, R"({"condition":"IsEquippedType","Type":{"value":2.0},"Left hand":false})");
+    templates.random.Render(out, {3.0, 3.0});
+    EXPECT_EQ(out, R"({"condition":"Random","requiredVersion":"2.3.0.0","State":{"scope":"Local",)"
+                   R"("shouldResetOnLoopOrEcho":true},"Minimum random value":{"value":3.0},)"
+                   R"("Maximum random value":{"value":3.0},"Comparison":"==",)"
+                   R"("Numeric value":{"graphVariable":"CycleMovesetsRandom","graphVariableType":"Float"}})");
+}
+
+TEST(ConditionTemplate, SlotCounts) {
+    const auto& set = ConditionEmitter::GetTemplates();
+    for (const auto* templates : {&set.compact, &set.pretty}) {
+        EXPECT_EQ(templates->actorBase.GetSlotCount(), 0u);
+        EXPECT_EQ(templates->equippedLeft.GetSlotCount(), 1u);
+        EXPECT_EQ(templates->direction.GetSlotCount(), 1u);
+        EXPECT_EQ(templates->random.GetSlotCount(), 2u);
+        EXPECT_EQ(templates->stateAtMost.GetSlotCount(), 1u);
+    }
+}
+
+TEST(ConditionTemplate, PrettyRenderHonorsIndent) {
+    const auto& templates = ConditionEmitter::GetTemplates().pretty;
+    std::string out;
+    templates.actorBase.Render(out, {}, {2, '\t', 1});
+    EXPECT_EQ(out,
+              "{\n\t\t\t\"condition\": \"IsActorBase\",\n\t\t\t\"Actor base\": {\n\t\t\t\t\"pluginName\": "
+              "\"Skyrim.esm\",\n\t\t\t\t\"formID\": \"7\"\n\t\t\t}\n\t\t}");
+}
+
+TEST(ConditionTemplate, EmitMatchesDomSerialization) {
+    const auto& templates = ConditionEmitter::GetTemplates().pretty;
+    for (const auto [indentChar, indentCount] : {std::pair{' ', 4u}, std::pair{'\t', 1u}, std::pair{' ', 2u}}) {
+        rapidjson::StringBuffer buffer;
+        ConfigRewriter::OutputWriter writer(buffer);
+        writer.SetIndent(indentChar, indentCount);
+        std::string scratch;
+        writer.StartArray();
+        templates.direction.Emit(writer, scratch, {5.0});
+        templates.random.Emit(writer, scratch, {2.0, 2.0});
+        templates.stateAtLeast.Emit(writer, scratch, {10010.0});
+        writer.EndArray();
+
+        const auto expected = SerializeDom(
+            [](rapidjson::Value& conditions, rapidjson::Document::AllocatorType& allocator) {
+                ConditionEmitter::AddCompareValuesCondition(conditions, "DirecionalCycleMoveset", 5, allocator);
+                ConditionEmitter::AddRandomCondition(conditions, 2, allocator);
+                ConditionEmitter::AddCompareValuesCondition(conditions, "CycleMovesetState", 10010, allocator, "<=");
+            },
+            indentChar, indentCount);
+        EXPECT_EQ(std::string_view(buffer.GetString(), buffer.GetSize()), expected);
+    }
+}
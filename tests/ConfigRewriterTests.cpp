@@ -0,0 +1,134 @@
+﻿#include <gtest/gtest.h>
+#include "ConditionEmitter.h"
+#include "ConfigRewriter.h"
+#include "Generators.h"
+#include "Samples.h"
+#include "TestFiles.h"
+
+namespace {
+    using Generators::Streaming;
+
+    constexpr int kPriority = 200000000;
+
+    class ConfigRewriterTest : public ::testing::Test {
+    protected:
+        void SetUp() override {
+            _samples = Samples::MakeConditionConfigs();
+            _naive = ConditionIR::BuildTree(_samples->configs);
+            _optimized = ConditionIR::Optimize(_naive);
+        }
+
+        std::unique_ptr<Samples::ConditionConfigs> _samples;
+        ConditionIR::Node _naive;
+        ConditionIR::Node _optimized;
+    };
+}
+
+TEST_F(ConfigRewriterTest, NewDocumentNaive) {
+    EXPECT_TRUE(TestFiles::MatchesGolden("new_document_naive.json", Streaming({}, &_naive, kPriority, false)));
+}
+
+TEST_F(ConfigRewriterTest, NewDocumentOptimized) {
+    EXPECT_TRUE(TestFiles::MatchesGolden("new_document_optimized.json", Streaming({}, &_optimized, kPriority, false)));
+}
+
+TEST_F(ConfigRewriterTest, NewDocumentPacked) {
+    const auto packed = ConditionIR::Optimize(ConditionIR::BuildTree(_samples->configs, true));
+    EXPECT_TRUE(TestFiles::MatchesGolden("new_document_packed.json", Streaming({}, &packed, kPriority, false)));
+}
+
+TEST_F(ConfigRewriterTest, NewDocumentDeepNesting) {
+    // 20 grupos encaixados passam de 40 contêineres abertos: a indentação tem que seguir o writer até o fim.
+    const auto deep = Samples::MakeDeepTree(20);
+    EXPECT_TRUE(TestFiles::MatchesGolden("new_document_deep.json", Streaming({}, &deep, kPriority, false)));
+}
+
+TEST_F(ConfigRewriterTest, KillSwitchPreservesForeignConditions) {
+    const auto content = TestFiles::Read(TestFiles::DataPath("foreign.json"));
+    const auto killSwitch = ConditionIR::BuildTree({});
+    EXPECT_TRUE(
+        TestFiles::MatchesGolden("kill_switch_preserved.json", Streaming(content, &killSwitch, kPriority, true)));
+}
+
+TEST_F(ConfigRewriterTest, ForeignConditionsReplaced) {
+    const auto content = TestFiles::Read(TestFiles::DataPath("foreign.json"));
+    EXPECT_TRUE(
+        TestFiles::MatchesGolden("foreign_replaced.json", Streaming(content, &_optimized, kPriority + 1, false)));
+}
+
+TEST_F(ConfigRewriterTest, ManagedBlockReplacedAndForeignWrapped) {
+    const auto content = TestFiles::Read(TestFiles::DataPath("managed.json"));
+    const auto existing = ConfigRewriter::ScanContent(content);
+    ASSERT_TRUE(existing.valid);
+    EXPECT_EQ(existing.priority, 200000001);
+    ASSERT_EQ(existing.conditions.size(), 3u);
+    EXPECT_EQ(existing.conditions[0], ConfigRewriter::ConditionKind::OldConditions);
+    EXPECT_EQ(existing.conditions[1], ConfigRewriter::ConditionKind::Managed);
+    EXPECT_EQ(existing.conditions[2], ConfigRewriter::ConditionKind::Foreign);
+    EXPECT_EQ(existing.managedBlocks, 1u);
+    EXPECT_TRUE(TestFiles::MatchesGolden("managed_preserved.json", Streaming(content, &_optimized, kPriority, true)));
+}
+
+TEST_F(ConfigRewriterTest, ManagedBlockRemoved) {
+    const auto content = TestFiles::Read(TestFiles::DataPath("managed.json"));
+    EXPECT_TRUE(TestFiles::MatchesGolden("managed_removed.json", Streaming(content, nullptr, kPriority, false)));
+}
+
+TEST_F(ConfigRewriterTest, PreservedOutputKeepsOldConditionsFirst) {
+    const auto content = TestFiles::Read(TestFiles::DataPath("foreign.json"));
+    const auto rescanned = ConfigRewriter::ScanContent(Streaming(content, &_optimized, kPriority, true));
+    const std::vector expected{ConfigRewriter::ConditionKind::OldConditions, ConfigRewriter::ConditionKind::Managed};
+    EXPECT_EQ(rescanned.conditions, expected);
+    EXPECT_EQ(rescanned.managedBlocks, 1u);
+}
+
+TEST_F(ConfigRewriterTest, InvalidJsonIsRecreated) {
+    for (const std::string_view content : {"{ \"priority\": 1, ", "[1, 2]", "", "\"texto\""}) {
+        const auto existing = ConfigRewriter::ScanContent(content);
+        EXPECT_FALSE(existing.valid) << content;
+        EXPECT_TRUE(TestFiles::MatchesGolden("new_document_optimized.json",
+                                             Streaming(content, &_optimized, kPriority, false)))
+            << content;
+    }
+}
+
+TEST_F(ConfigRewriterTest, ConditionsThatAreNotAnArrayAreReplaced) {
+    const auto output = Streaming(R"({"conditions": {"condition": "IsRunning"}, "priority": 3})", &_optimized,
+                                 kPriority, true);
+    const auto rescanned = ConfigRewriter::ScanContent(output);
+    ASSERT_EQ(rescanned.conditions.size(), 1u);
+    EXPECT_EQ(rescanned.conditions.front(), ConfigRewriter::ConditionKind::Managed);
+}
+
+TEST_F(ConfigRewriterTest, FileAndMemoryPassesAgree) {
+    const auto source = TestFiles::DataPath("managed.json");
+    const auto content = TestFiles::Read(source);
+
+    const auto fromFile = ConfigRewriter::Scan(source);
+    const auto fromMemory = ConfigRewriter::ScanContent(content);
+    EXPECT_TRUE(fromFile.exists);
+    EXPECT_EQ(fromFile.valid, fromMemory.valid);
+    EXPECT_EQ(fromFile.bytesRead, content.size());
+    EXPECT_EQ(fromFile.priority, fromMemory.priority);
+    EXPECT_EQ(fromFile.conditions, fromMemory.conditions);
+    EXPECT_EQ(fromFile.managedBlockHash, fromMemory.managedBlockHash);
+
+    std::string scratch;
+    const ConfigRewriter::BlockWriter writeManagedBlock = [&](ConfigRewriter::OutputWriter& writer) {
+        ConditionEmitter::WriteManagedBlock(writer, _optimized, scratch);
+    };
+    rapidjson::StringBuffer fileOutput, memoryOutput;
+    std::string error;
+    ASSERT_TRUE(ConfigRewriter::Rewrite(source, fromFile, kPriority, true, writeManagedBlock, fileOutput, error));
+    ASSERT_TRUE(
+        ConfigRewriter::RewriteContent(content, fromMemory, kPriority, true, writeManagedBlock, memoryOutput, error));
+    EXPECT_EQ(std::string_view(fileOutput.GetString(), fileOutput.GetSize()),
+              std::string_view(memoryOutput.GetString(), memoryOutput.GetSize()));
+}
+
+TEST_F(ConfigRewriterTest, MissingFileScansAsNew) {
+    const auto missing = ConfigRewriter::Scan(TestFiles::DataPath("nao_existe.json"));
+    EXPECT_FALSE(missing.exists);
+    EXPECT_FALSE(missing.valid);
+    EXPECT_TRUE(missing.error.empty());
+}
@@ -0,0 +1,63 @@
+﻿#include <barrier>
+#include <thread>
+#include <gtest/gtest.h>
+#include "Diagnostics.h"
+#include "ThreadPool.h"
+
+using Diagnostics::Phase;
+
+TEST(Diagnostics, ConcurrentPhasesDoNotMix) {
+    // As duas fases ficam abertas ao mesmo tempo; cada uma só pode ver a E/S da sua thread.
+    std::barrier bothOpen(2), bothCounted(2);
+    std::thread saver([&] {
+        Diagnostics::ScopedPhase phase(Phase::StanceSave);
+        bothOpen.arrive_and_wait();
+        Diagnostics::CountWrite(1000, 2);
+        bothCounted.arrive_and_wait();
+    });
+    {
+        Diagnostics::ScopedPhase phase(Phase::StanceLoad);
+        bothOpen.arrive_and_wait();
+        Diagnostics::CountRead(300);
+        bothCounted.arrive_and_wait();
+    }
+    saver.join();
+
+    const auto load = Diagnostics::GetReport(Phase::StanceLoad);
+    EXPECT_EQ(load.fsCalls, 1u);
+    EXPECT_EQ(load.bytesRead, 300u);
+    EXPECT_EQ(load.bytesWritten, 0u);
+    const auto save = Diagnostics::GetReport(Phase::StanceSave);
+    EXPECT_EQ(save.fsCalls, 2u);
+    EXPECT_EQ(save.filesWritten, 2u);
+    EXPECT_EQ(save.bytesRead, 0u);
+}
+
+TEST(Diagnostics, PoolTasksCountForTheSubmittingPhase) {
+    {
+        Diagnostics::ScopedPhase phase(Phase::ManagedFiles);
+        ThreadPool pool(4);
+        for (int i = 0; i < 100; ++i) {
+            pool.Submit([] { Diagnostics::CountRead(10); });
+        }
+        pool.Wait();
+    }
+    const auto report = Diagnostics::GetReport(Phase::ManagedFiles);
+    EXPECT_EQ(report.filesRead, 100u);
+    EXPECT_EQ(report.bytesRead, 1000u);
+    EXPECT_EQ(Diagnostics::ActivePhase(), nullptr);
+}
+
+TEST(Diagnostics, NestedPhasesRecordTheirOwnTotals) {
+    {
+        Diagnostics::ScopedPhase outer(Phase::LibraryScan);
+        Diagnostics::CountFsCalls(3);
+        {
+            Diagnostics::ScopedPhase inner(Phase::ConditionGeneration);
+            Diagnostics::CountFsCalls(5);
+        }
+    }
+    Diagnostics::CountFsCalls(7);  // Fora de qualquer fase
+    EXPECT_EQ(Diagnostics::GetReport(Phase::LibraryScan).fsCalls, 8u);
+    EXPECT_EQ(Diagnostics::GetReport(Phase::ConditionGeneration).fsCalls, 5u);
+}
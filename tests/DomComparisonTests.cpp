@@ -0,0 +1,110 @@
+﻿#include <optional>
+#include <random>
+#include <gtest/gtest.h>
+#include "Generators.h"
+#include "Samples.h"
+#include "TestFiles.h"
+
+// A saída em streaming (templates com o recuo do writer) contra a serialização do DOM inteiro pelo PrettyWriter,
+// que era como o plugin gerava antes. Os mesmos cenários dos goldens têm que bater byte a byte com os dois.
+namespace {
+    constexpr int kPriority = 200000000;
+
+    struct Scenario {
+        const char* golden;
+        const char* data;  // Arquivo em data/, ou nullptr para um config.json que não existia
+        enum class TreeKind { None, Naive, Optimized, Packed, Deep, KillSwitch } tree;
+        int priority;
+        bool preserve;
+    };
+
+    class DomComparisonTest : public ::testing::TestWithParam<Scenario> {};
+
+    ConditionIR::Node MakeTree(Scenario::TreeKind kind, const std::vector<FileSaveConfig>& configs) {
+        using TreeKind = Scenario::TreeKind;
+        switch (kind) {
+            case TreeKind::Naive:
+                return ConditionIR::BuildTree(configs);
+            case TreeKind::Optimized:
+                return ConditionIR::Optimize(ConditionIR::BuildTree(configs));
+            case TreeKind::Packed:
+                return ConditionIR::Optimize(ConditionIR::BuildTree(configs, true));
+            case TreeKind::Deep:
+                return Samples::MakeDeepTree(20);
+            case TreeKind::KillSwitch:
+                return ConditionIR::BuildTree({});
+            case TreeKind::None:
+                break;
+        }
+        return {};
+    }
+}
+
+TEST_P(DomComparisonTest, StreamingMatchesDomAndGolden) {
+    const auto& scenario = GetParam();
+    const auto samples = Samples::MakeConditionConfigs();
+    const auto tree = MakeTree(scenario.tree, samples->configs);
+    const auto* root = scenario.tree == Scenario::TreeKind::None ? nullptr : &tree;
+    std::optional<std::string> content;
+    if (scenario.data) content = TestFiles::Read(TestFiles::DataPath(scenario.data));
+
+    const auto dom = Generators::Dom(content, root, scenario.priority, scenario.preserve);
+    EXPECT_EQ(Generators::Streaming(content, root, scenario.priority, scenario.preserve), dom);
+    EXPECT_TRUE(TestFiles::MatchesGolden(scenario.golden, dom));
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Goldens, DomComparisonTest,
+    ::testing::Values(
+        Scenario{"new_document_naive.json", nullptr, Scenario::TreeKind::Naive, kPriority, false},
+        Scenario{"new_document_optimized.json", nullptr, Scenario::TreeKind::Optimized, kPriority, false},
+        Scenario{"new_document_packed.json", nullptr, Scenario::TreeKind::Packed, kPriority, false},
+        Scenario{"new_document_deep.json", nullptr, Scenario::TreeKind::Deep, kPriority, false},
+        Scenario{"kill_switch_preserved.json", "foreign.json", Scenario::TreeKind::KillSwitch, kPriority, true},
+        Scenario{"foreign_replaced.json", "foreign.json", Scenario::TreeKind::Optimized, kPriority + 1, false},
+        Scenario{"managed_preserved.json", "managed.json", Scenario::TreeKind::Optimized, kPriority, true},
+        Scenario{"managed_removed.json", "managed.json", Scenario::TreeKind::None, kPriority, false}),
+    [](const auto& info) {
+        std::string name = info.param.golden;
+        name.resize(name.find('.'));
+        return name;
+    });
+
+TEST(DomComparison, InvalidJsonIsRecreatedLikeTheDom) {
+    const auto samples = Samples::MakeConditionConfigs();
+    const auto tree = ConditionIR::Optimize(ConditionIR::BuildTree(samples->configs));
+    for (const std::string_view content :
+         {"{ \"priority\": 1, ", "[1, 2]", "", "\"texto\"", R"({"conditions": {"condition": "IsRunning"}})"}) {
+        for (const bool preserve : {false, true}) {
+            EXPECT_EQ(Generators::Streaming(content, &tree, kPriority, preserve),
+                      Generators::Dom(content, &tree, kPriority, preserve))
+                << content;
+        }
+    }
+}
+
+TEST(DomComparison, RandomConfigsMatchTheDom) {
+    const auto samples = Samples::MakeConditionConfigs();
+    const auto foreign = TestFiles::Read(TestFiles::DataPath("foreign.json"));
+    const auto managed = TestFiles::Read(TestFiles::DataPath("managed.json"));
+    std::mt19937 random(14);
+    for (int round = 0; round < 100; ++round) {
+        const auto configs = Samples::MakeRandomConfigs(random, samples->sword, samples->dualSword);
+        for (const bool packedStateKey : {false, true}) {
+            const auto naive = ConditionIR::BuildTree(configs, packedStateKey);
+            const auto optimized = ConditionIR::Optimize(naive);
+            for (const auto* tree : {&naive, &optimized}) {
+                const auto* root = tree->children.empty() ? nullptr : tree;
+                for (const std::optional<std::string_view> content :
+                     {std::optional<std::string_view>{}, std::optional<std::string_view>{foreign},
+                      std::optional<std::string_view>{managed}}) {
+                    for (const bool preserve : {false, true}) {
+                        ASSERT_EQ(Generators::Streaming(content, root, kPriority, preserve),
+                                  Generators::Dom(content, root, kPriority, preserve))
+                            << "rodada " << round;
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,47 @@
+﻿#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include "LibraryScanner.h"
+
+// Travessia das subpastas de um mod com links de pasta no meio.
+namespace {
+    namespace fs = std::filesystem;
+
+    void WriteConfig(const fs::path& dir) {
+        fs::create_directories(dir);
+        std::ofstream(dir / "config.json") << R"({"name": "sub"})";
+    }
+
+    // Mod com "sub/config.json" e "sub/loop" apontando de volta para a pasta do mod. Symlinks podem exigir
+    // privilégio no Windows: sem ele o teste é pulado.
+    bool MakeLoopingMod(const fs::path& modPath) {
+        fs::remove_all(modPath);
+        WriteConfig(modPath);
+        WriteConfig(modPath / "sub");
+        std::error_code error;
+        fs::create_directory_symlink(modPath, modPath / "sub" / "loop", error);
+        return !error;
+    }
+}
+
+TEST(LibraryScanner, DirectoryLinksAreListedButNotFollowed) {
+    const auto modPath = fs::temp_directory_path() / "cyclemovesets_scanner_tests" / "Mod";
+    if (!MakeLoopingMod(modPath)) GTEST_SKIP() << "Sem permissão para criar symlinks";
+
+    SubAnimationDef rootTags;
+    const auto root = LibraryScanner::ListDirectory(modPath, rootTags);
+    std::vector<DirectoryStamp> stamps;
+    std::vector<SubAnimationDef> subAnimations;
+    LibraryScanner::CollectSubAnimations(modPath, StringPool::GetSingleton().InternPath(modPath),
+                                         root.subdirectories, stamps, subAnimations);
+
+    // "sub" e o próprio link, que tem o config.json do mod; nada de "sub/loop/sub/loop/...".
+    std::vector<std::string> paths;
+    for (const auto& stamp : stamps) paths.push_back(fs::path(stamp.relativePath).generic_string());
+    std::ranges::sort(paths);
+    EXPECT_EQ(paths, (std::vector<std::string>{"sub", "sub/loop"}));
+    EXPECT_EQ(subAnimations.size(), 2u);
+
+    fs::remove_all(modPath.parent_path());
+}
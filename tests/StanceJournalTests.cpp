@@ -0,0 +1,199 @@
+﻿#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include "LibraryId.h"
+#include "StanceJournal.h"
+
+// Reaplicação do diário de stances depois que a biblioteca mudou.
+namespace {
+    namespace fs = std::filesystem;
+    using StanceJournal::Op;
+    using StanceJournal::OpType;
+
+    StanceStore::Animation MakeAnimation(const std::string& mod, const std::string& sub) {
+        StanceStore::Animation animation;
+        animation.sourceModName = mod;
+        animation.sourceSubName = sub;
+        animation.sourceModId = LibraryId::FromUtf8(mod);
+        animation.sourceSubId = LibraryId::FromUtf8(mod + "/" + sub);
+        return animation;
+    }
+
+    StanceStore::Moveset MakeMoveset(const std::string& mod) {
+        StanceStore::Moveset moveset;
+        moveset.name = mod;
+        moveset.id = LibraryId::FromUtf8(mod);
+        for (const char* sub : {"A", "B", "C"}) moveset.animations.push_back(MakeAnimation(mod, sub));
+        return moveset;
+    }
+
+    // Lista legível de uma instância: "Mod[sub:flags,...]", com '-' nos itens desmarcados.
+    std::string Describe(const StanceStore::Instance& instance) {
+        std::string text;
+        for (const auto& moveset : instance) {
+            if (!text.empty()) text += ' ';
+            text += (moveset.selected ? "" : "-") + moveset.name + "[";
+            for (std::size_t i = 0; i < moveset.animations.size(); ++i) {
+                const auto& animation = moveset.animations[i];
+                if (i > 0) text += ',';
+                text += (animation.selected ? "" : "-") + animation.sourceSubName + ":" +
+                        std::to_string(animation.flags);
+            }
+            text += "]";
+        }
+        return text;
+    }
+
+    // Operação sobre o moveset em `index` de `instance`, com os IDs que a UI grava.
+    Op MakeOp(OpType type, const StanceStore::StanceMap& stances, const std::string& category, std::uint8_t instance,
+              std::uint32_t index) {
+        Op op;
+        op.type = type;
+        op.category = category;
+        op.instance = instance;
+        op.moveset = index;
+        op.movesetId = stances.at(category)[instance][index].id;
+        return op;
+    }
+
+    Op SwapMovesets(const StanceStore::StanceMap& stances, const std::string& category, std::uint8_t instance,
+                    std::uint32_t from, std::uint32_t to) {
+        auto op = MakeOp(OpType::SwapMovesets, stances, category, instance, from);
+        op.target = to;
+        op.targetId = stances.at(category)[instance][to].id;
+        return op;
+    }
+
+    Op SetFlags(const StanceStore::StanceMap& stances, const std::string& category, std::uint8_t instance,
+                std::uint32_t moveset, std::uint32_t animation, std::uint16_t flags) {
+        auto op = MakeOp(OpType::SetAnimationFlags, stances, category, instance, moveset);
+        const auto& stored = stances.at(category)[instance][moveset].animations[animation];
+        op.animation = animation;
+        op.animationId = stored.sourceSubId;
+        op.before = stored.flags;
+        op.after = flags;
+        return op;
+    }
+
+    // Snapshot com o mod "Removido" na frente de duas instâncias e edições em quatro instâncias de duas
+    // categorias, geradas sobre a lista completa (a da UI quando o mod ainda existia).
+    class StanceJournalReplay : public ::testing::Test {
+    protected:
+        void SetUp() override {
+            _previousDirectory = fs::current_path();
+            _directory = fs::temp_directory_path() / "cyclemovesets_journal_tests";
+            fs::remove_all(_directory);
+            fs::create_directories(_directory / fs::path(StanceJournal::kJournalPath).parent_path());
+            fs::current_path(_directory);
+
+            for (const char* category : {"Sword", "Axe"}) {
+                for (auto& instance : _snapshot[category]) {
+                    for (const char* mod : {"First", "Second", "Third"}) instance.push_back(MakeMoveset(mod));
+                }
+            }
+            _snapshot["Sword"][0].insert(_snapshot["Sword"][0].begin(), MakeMoveset("Removido"));
+            _snapshot["Axe"][2].insert(_snapshot["Axe"][2].begin(), MakeMoveset("Removido"));
+
+            auto state = _snapshot;
+            auto record = [&](Op op) {
+                ASSERT_TRUE(StanceJournal::Apply(state, op));
+                _ops.push_back(std::move(op));
+            };
+            record(SwapMovesets(state, "Sword", 0, 1, 3));
+            record(SetFlags(state, "Axe", 1, 2, 1, StanceStore::kFront | StanceStore::kDodge));
+            record(SetFlags(state, "Sword", 0, 2, 0, StanceStore::kBack));
+            record(SwapMovesets(state, "Axe", 2, 2, 3));
+            auto remove = MakeOp(OpType::RemoveMoveset, state, "Sword", 3, 0);
+            remove.movesetData = state["Sword"][3][0];
+            record(remove);
+            auto select = MakeOp(OpType::SetMovesetSelected, state, "Axe", 2, 1);
+            select.before = 1;
+            select.after = 0;
+            record(select);
+            record(SetFlags(state, "Sword", 0, 1, 2, StanceStore::kRandom));
+            _expected = state;
+
+            std::ofstream journal(StanceJournal::kJournalPath, std::ios::binary);
+            journal << StanceJournal::Header(kSnapshotHash);
+            for (const auto& op : _ops) journal << StanceJournal::Encode(op);
+        }
+
+        void TearDown() override {
+            fs::current_path(_previousDirectory);
+            fs::remove_all(_directory);
+        }
+
+        // O que a UI mostra depois que o mod é desinstalado: os itens dele não resolvem mais.
+        static StanceStore::StanceMap WithoutRemovedMod(StanceStore::StanceMap stances) {
+            for (auto& [name, instances] : stances) {
+                for (auto& instance : instances) {
+                    std::erase_if(instance, [](const StanceStore::Moveset& moveset) {
+                        return moveset.name == "Removido";
+                    });
+                }
+            }
+            return stances;
+        }
+
+        static constexpr std::uint64_t kSnapshotHash = 0x5EED'0000'0000'0025ull;
+        fs::path _previousDirectory;
+        fs::path _directory;
+        StanceStore::StanceMap _snapshot;
+        StanceStore::StanceMap _expected;
+        std::vector<Op> _ops;
+    };
+}
+
+TEST_F(StanceJournalReplay, SnapshotKeepsPositionsAfterModRemoval) {
+    auto ops = StanceJournal::Load(kSnapshotHash);
+    ASSERT_TRUE(ops.has_value());
+    ASSERT_EQ(ops->size(), _ops.size());
+
+    auto stances = _snapshot;
+    std::size_t broken = 0;
+    const auto applied = StanceJournal::Replay(stances, std::move(*ops), &broken);
+    EXPECT_EQ(applied.size(), _ops.size());
+    EXPECT_EQ(broken, 0u);
+    for (const auto& [name, instances] : _expected) {
+        for (int i = 0; i < StanceStore::kInstanceCount; ++i) {
+            EXPECT_EQ(Describe(stances[name][i]), Describe(instances[i])) << name << " " << i;
+        }
+    }
+    // A UI montada depois da reaplicação só deixa de fora o mod removido.
+    const auto visible = WithoutRemovedMod(stances);
+    EXPECT_EQ(Describe(visible.at("Sword")[0]), "Third[A:0,B:0,C:256] Second[A:2,B:0,C:0] First[A:0,B:0,C:0]");
+    EXPECT_EQ(Describe(visible.at("Axe")[2]), "-First[A:0,B:0,C:0] Third[A:0,B:0,C:0] Second[A:0,B:0,C:0]");
+}
+
+TEST_F(StanceJournalReplay, FailedOpOnlyDropsTheRestOfItsInstance) {
+    // Reaplicado sobre a lista sem o mod (a UI), o primeiro registro de Sword/0 e de Axe/2 já não confere.
+    auto stances = WithoutRemovedMod(_snapshot);
+    const auto expected = WithoutRemovedMod(_expected);
+    std::size_t broken = 0;
+    const auto applied = StanceJournal::Replay(stances, _ops, &broken);
+
+    EXPECT_EQ(broken, 2u);
+    EXPECT_EQ(applied.size(), 2u);
+    for (const auto& op : applied) EXPECT_TRUE(op.category == "Axe" ? op.instance == 1 : op.instance == 3);
+    EXPECT_EQ(Describe(stances.at("Axe")[1]), Describe(expected.at("Axe")[1]));
+    EXPECT_EQ(Describe(stances.at("Sword")[3]), Describe(expected.at("Sword")[3]));
+    // As instâncias que pararam ficam como no snapshot, sem edições pela metade.
+    EXPECT_EQ(Describe(stances.at("Sword")[0]), Describe(WithoutRemovedMod(_snapshot).at("Sword")[0]));
+    EXPECT_EQ(Describe(stances.at("Axe")[2]), Describe(WithoutRemovedMod(_snapshot).at("Axe")[2]));
+}
+
+TEST(StanceJournal, InsertCreatesMissingCategory) {
+    StanceStore::StanceMap stances;
+    Op op;
+    op.type = OpType::InsertMoveset;
+    op.category = "Nova";
+    op.instance = 3;
+    op.movesetData = MakeMoveset("First");
+    ASSERT_TRUE(StanceJournal::Apply(stances, op));
+    EXPECT_EQ(Describe(stances.at("Nova")[3]), "First[A:0,B:0,C:0]");
+
+    op.type = OpType::RemoveMoveset;
+    op.category = "Outra";
+    EXPECT_FALSE(StanceJournal::Apply(stances, op));
+    EXPECT_FALSE(stances.contains("Outra"));
+}
@@ -0,0 +1,97 @@
+﻿#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include "BinaryStream.h"
+#include "StanceStore.h"
+
+// Leitura do store quando o arquivo falta, está estragado ou é de uma versão mais nova.
+namespace {
+    namespace fs = std::filesystem;
+
+    class StanceStoreLoad : public ::testing::Test {
+    protected:
+        void SetUp() override {
+            _previousDirectory = fs::current_path();
+            _directory = fs::temp_directory_path() / "cyclemovesets_store_tests";
+            fs::remove_all(_directory);
+            fs::create_directories(_directory / fs::path(StanceStore::kStorePath).parent_path());
+            fs::current_path(_directory);
+        }
+
+        void TearDown() override {
+            fs::current_path(_previousDirectory);
+            fs::remove_all(_directory);
+        }
+
+        static void WriteStore(const std::string& content) {
+            std::ofstream(StanceStore::kStorePath, std::ios::binary)
+                .write(content.data(), static_cast<std::streamsize>(content.size()));
+        }
+
+        static std::string Header(std::uint32_t version) {
+            BinaryWriter writer;
+            writer.Write(std::uint32_t{0x54534D43});  // "CMST"
+            writer.Write(version);
+            return std::string(writer.Data().begin(), writer.Data().end());
+        }
+
+        static StanceStore::Moveset MakeMoveset(std::uint64_t id) {
+            StanceStore::Moveset moveset;
+            moveset.name = "Mod";
+            moveset.id = id;
+            return moveset;
+        }
+
+        fs::path _previousDirectory;
+        fs::path _directory;
+    };
+}
+
+TEST_F(StanceStoreLoad, MissingStore) {
+    auto error = StanceStore::LoadError::Unreadable;
+    EXPECT_FALSE(StanceStore::Load(nullptr, &error).has_value());
+    EXPECT_EQ(error, StanceStore::LoadError::Missing);
+}
+
+TEST_F(StanceStoreLoad, RoundTrip) {
+    StanceStore::StanceMap stances;
+    stances["Sword"][1].push_back(MakeMoveset(7));
+    WriteStore(StanceStore::Serialize(stances));
+    const auto loaded = StanceStore::Load();
+    ASSERT_TRUE(loaded.has_value());
+    ASSERT_EQ(loaded->at("Sword")[1].size(), 1u);
+    EXPECT_EQ(loaded->at("Sword")[1][0].id, 7u);
+}
+
+TEST_F(StanceStoreLoad, CorruptStoreIsUnreadableAndQuarantined) {
+    StanceStore::StanceMap stances;
+    stances["Sword"][0].push_back(MakeMoveset(7));
+    auto content = StanceStore::Serialize(stances);
+    content.resize(content.size() - 3);
+    WriteStore(content);
+
+    auto error = StanceStore::LoadError::Missing;
+    EXPECT_FALSE(StanceStore::Load(nullptr, &error).has_value());
+    EXPECT_EQ(error, StanceStore::LoadError::Unreadable);
+
+    ASSERT_TRUE(StanceStore::Quarantine());
+    EXPECT_FALSE(fs::exists(StanceStore::kStorePath));
+    EXPECT_EQ(fs::file_size(StanceStore::kQuarantinePath), content.size());
+    // O próximo carregamento vê um store ausente, não o mesmo arquivo estragado.
+    EXPECT_FALSE(StanceStore::Load(nullptr, &error).has_value());
+    EXPECT_EQ(error, StanceStore::LoadError::Missing);
+}
+
+TEST_F(StanceStoreLoad, NewerVersionIsNotUnreadable) {
+    WriteStore(Header(99) + std::string(64, '\0'));
+    auto error = StanceStore::LoadError::Missing;
+    EXPECT_FALSE(StanceStore::Load(nullptr, &error).has_value());
+    EXPECT_EQ(error, StanceStore::LoadError::NewerVersion);
+}
+
+TEST_F(StanceStoreLoad, ForeignFileIsUnreadable) {
+    WriteStore("not a stance store");
+    auto error = StanceStore::LoadError::Missing;
+    EXPECT_FALSE(StanceStore::Load(nullptr, &error).has_value());
+    EXPECT_EQ(error, StanceStore::LoadError::Unreadable);
+}
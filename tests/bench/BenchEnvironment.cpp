@@ -0,0 +1,37 @@
+﻿#include "BenchEnvironment.h"
+
+const std::filesystem::path& BenchEnvironment::EnterScratchDirectory() {
+    static const auto scratch = [] {
+        const auto path = std::filesystem::temp_directory_path() / "cyclemovesets_bench";
+        std::filesystem::create_directories(path / "Data/SKSE/Plugins/CycleMovesets");
+        std::filesystem::current_path(path);
+        return path;
+    }();
+    return scratch;
+}
+
+const SyntheticLibrary::Library& BenchEnvironment::GetLibrary() {
+    static const SyntheticLibrary::Library library = [] {
+        const auto& scratch = EnterScratchDirectory();
+        const auto options = SyntheticLibrary::FromEnvironment();
+        auto generated = SyntheticLibrary::Generate(scratch / "OpenAnimationReplacer", options);
+        SKSE::log::info("Biblioteca sintética: {} mods x {} submods x {} hkx, {} arquivos, {} bytes em {}",
+                        options.mods, options.submodsPerMod, options.animationsPerSubmod, generated.files,
+                        generated.bytes, generated.root.string());
+        return generated;
+    }();
+    return library;
+}
+
+void BenchEnvironment::ReportPhase(benchmark::State& state, Diagnostics::Phase phase) {
+    const auto report = Diagnostics::GetReport(phase);
+    state.counters["fs_calls"] = static_cast<double>(report.fsCalls);
+    state.counters["files_read"] = static_cast<double>(report.filesRead);
+    state.counters["bytes_read"] = benchmark::Counter(static_cast<double>(report.bytesRead),
+                                                      benchmark::Counter::kDefaults, benchmark::Counter::kIs1024);
+    state.counters["files_written"] = static_cast<double>(report.filesWritten);
+    state.counters["bytes_written"] = benchmark::Counter(static_cast<double>(report.bytesWritten),
+                                                         benchmark::Counter::kDefaults, benchmark::Counter::kIs1024);
+    state.counters["peak_ws"] = benchmark::Counter(static_cast<double>(report.peakWorkingSet),
+                                                   benchmark::Counter::kDefaults, benchmark::Counter::kIs1024);
+}
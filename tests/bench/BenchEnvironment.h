@@ -0,0 +1,18 @@
+﻿#pragma once
+#include <benchmark/benchmark.h>
+#include "Diagnostics.h"
+#include "SyntheticLibrary.h"
+
+// O que os benchmarks compartilham: a biblioteca sintética e o relatório das fases de Diagnostics.
+namespace BenchEnvironment {
+    // Cria a pasta temporária dos benchmarks, com Data/SKSE/Plugins/CycleMovesets, e entra nela.
+    const std::filesystem::path& EnterScratchDirectory();
+
+    // Gerada na primeira chamada (SyntheticLibrary::FromEnvironment), numa pasta temporária que passa a ser a
+    // pasta atual: os caminhos relativos do plugin ("Data/SKSE/Plugins/...") caem dentro dela.
+    const SyntheticLibrary::Library& GetLibrary();
+
+    // Contadores da última execução de `phase` (chamadas ao disco, arquivos e bytes lidos/escritos, pico de
+    // memória). O tempo já sai no relatório do benchmark.
+    void ReportPhase(benchmark::State& state, Diagnostics::Phase phase);
+}
@@ -0,0 +1,63 @@
+﻿#include <benchmark/benchmark.h>
+#include <cctype>
+#include "SyntheticLibrary.h"
+#include "TagClassifier.h"
+
+// Um milhão de nomes de arquivo pelo classificador de tags, contra a forma que ele substituiu (cópia do nome,
+// cópia em minúsculas e uma busca por padrão), estendida aos mesmos padrões.
+namespace {
+    constexpr std::size_t kFilenameCount = 1'000'000;
+
+    const std::vector<std::string>& GetFilenames() {
+        static const auto filenames = SyntheticLibrary::MakeFilenames(kFilenameCount, 7);
+        return filenames;
+    }
+
+    TagClassifier::TagMask ClassifyByLowercaseCopy(std::string_view name) {
+        std::string filename(name);
+        std::string lowerFilename = filename;
+        std::transform(lowerFilename.begin(), lowerFilename.end(), lowerFilename.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        TagClassifier::TagMask mask = 0;
+        for (const auto& pattern : TagClassifier::kPatterns) {
+            const bool found = pattern.prefix ? lowerFilename.rfind(pattern.text, 0) == 0
+                                              : lowerFilename.find(pattern.text) != std::string::npos;
+            if (found) mask |= TagClassifier::Bit(pattern.tag);
+        }
+        if (mask & TagClassifier::Bit(AnimationTag::Unequip)) mask &= ~TagClassifier::Bit(AnimationTag::Equip);
+        return mask;
+    }
+}
+
+static void BM_TagClassifier(benchmark::State& state) {
+    const auto& filenames = GetFilenames();
+    for (const auto& filename : filenames) {
+        if (TagClassifier::Classify(filename) != ClassifyByLowercaseCopy(filename)) {
+            state.SkipWithError(("Classificação diferente da referência: " + filename).c_str());
+            return;
+        }
+    }
+    for (auto _ : state) {
+        SubAnimationDef tags;
+        for (const auto& filename : filenames) TagClassifier::Accumulate(std::string_view(filename), tags);
+        benchmark::DoNotOptimize(tags.tagCounts);
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * filenames.size()));
+}
+BENCHMARK(BM_TagClassifier)->Unit(benchmark::kMillisecond);
+
+static void BM_TagClassifierLowercaseCopy(benchmark::State& state) {
+    const auto& filenames = GetFilenames();
+    for (auto _ : state) {
+        SubAnimationDef tags;
+        for (const auto& filename : filenames) {
+            const auto mask = ClassifyByLowercaseCopy(filename);
+            for (std::size_t tag = 0; tag < kAnimationTagCount; ++tag) {
+                if (mask & (1u << tag)) ++tags.tagCounts[tag];
+            }
+        }
+        benchmark::DoNotOptimize(tags.tagCounts);
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * filenames.size()));
+}
+BENCHMARK(BM_TagClassifierLowercaseCopy)->Unit(benchmark::kMillisecond);
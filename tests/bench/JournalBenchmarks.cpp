@@ -0,0 +1,193 @@
+﻿#include <benchmark/benchmark.h>
+#include <fstream>
+#include <random>
+#include "BenchEnvironment.h"
+#include "LibraryId.h"
+#include "StanceJournal.h"
+
+// Reaplicação de 100 mil edições do diário de stances sobre o snapshot, como no carregamento depois de uma
+// sessão longa no editor sem compactação.
+namespace {
+    using StanceJournal::Op;
+    using StanceJournal::OpType;
+
+    constexpr std::size_t kOperationCount = 100'000;
+    constexpr std::uint64_t kSnapshotHash = 0x5EED'2025'0000'0025ull;
+    constexpr std::size_t kMinMovesets = 4, kMaxMovesets = 16;
+    constexpr std::size_t kMinAnimations = 2, kMaxAnimations = 12;
+
+    // Gera edições válidas sobre o estado atual, numeradas para que todo moveset e animação novos tenham ID
+    // próprio. Inserções e remoções mantêm as listas entre os limites acima.
+    class EditSession {
+    public:
+        explicit EditSession(unsigned seed) : _random(seed) {}
+
+        StanceStore::Moveset NewMoveset() {
+            StanceStore::Moveset moveset;
+            moveset.name = "Moveset " + std::to_string(_nextId);
+            moveset.id = LibraryId::ForUserMoveset(moveset.name);
+            moveset.userMoveset = true;
+            ++_nextId;
+            const auto count = std::uniform_int_distribution<std::size_t>(kMinAnimations, kMaxAnimations)(_random);
+            for (std::size_t i = 0; i < count; ++i) moveset.animations.push_back(NewAnimation());
+            return moveset;
+        }
+
+        StanceStore::Animation NewAnimation() {
+            StanceStore::Animation animation;
+            animation.sourceModName = "Synthetic Mod " + std::to_string(_nextId % 1500);
+            animation.sourceSubName = std::to_string(700000 + _nextId);
+            animation.sourceModId = LibraryId::FromUtf8(animation.sourceModName);
+            animation.sourceSubId = LibraryId::FromUtf8(animation.sourceModName + "/" + animation.sourceSubName);
+            animation.flags = static_cast<std::uint16_t>(_random() & 0x3FF);
+            ++_nextId;
+            return animation;
+        }
+
+        Op Next(const StanceStore::StanceMap& stances) {
+            auto category = stances.begin();
+            std::advance(category, Pick(stances.size()));
+            Op op;
+            op.category = category->first;
+            op.instance = static_cast<std::uint8_t>(Pick(StanceStore::kInstanceCount));
+            const auto& movesets = category->second[op.instance];
+            op.moveset = static_cast<std::uint32_t>(Pick(movesets.size()));
+            op.movesetId = movesets[op.moveset].id;
+            const auto& animations = movesets[op.moveset].animations;
+
+            switch (Pick(9)) {
+                case 0:
+                    op.type = OpType::SwapMovesets;
+                    op.target = static_cast<std::uint32_t>(Pick(movesets.size()));
+                    op.targetId = movesets[op.target].id;
+                    break;
+                case 1:
+                    op.type = OpType::SwapAnimations;
+                    op.animation = static_cast<std::uint32_t>(Pick(animations.size()));
+                    op.target = static_cast<std::uint32_t>(Pick(animations.size()));
+                    op.animationId = animations[op.animation].sourceSubId;
+                    op.targetId = animations[op.target].sourceSubId;
+                    break;
+                case 2:
+                    op.type = OpType::SetMovesetSelected;
+                    op.before = movesets[op.moveset].selected;
+                    op.after = !op.before;
+                    break;
+                case 3:
+                    op.type = OpType::SetAnimationSelected;
+                    op.animation = static_cast<std::uint32_t>(Pick(animations.size()));
+                    op.animationId = animations[op.animation].sourceSubId;
+                    op.before = animations[op.animation].selected;
+                    op.after = !op.before;
+                    break;
+                case 4:
+                    op.type = OpType::SetAnimationFlags;
+                    op.animation = static_cast<std::uint32_t>(Pick(animations.size()));
+                    op.animationId = animations[op.animation].sourceSubId;
+                    op.before = animations[op.animation].flags;
+                    op.after = static_cast<std::uint16_t>(_random() & 0x3FF);
+                    break;
+                case 5:
+                case 6:
+                    if (movesets.size() > kMinMovesets && (movesets.size() >= kMaxMovesets || Pick(2) == 0)) {
+                        op.type = OpType::RemoveMoveset;
+                        op.movesetData = movesets[op.moveset];
+                    } else {
+                        op.type = OpType::InsertMoveset;
+                        op.moveset = static_cast<std::uint32_t>(Pick(movesets.size() + 1));
+                        op.movesetId = 0;
+                        op.movesetData = NewMoveset();
+                    }
+                    break;
+                default:
+                    if (animations.size() > kMinAnimations && (animations.size() >= kMaxAnimations || Pick(2) == 0)) {
+                        op.type = OpType::RemoveAnimation;
+                        op.animation = static_cast<std::uint32_t>(Pick(animations.size()));
+                        op.animationData = animations[op.animation];
+                    } else {
+                        op.type = OpType::InsertAnimation;
+                        op.animation = static_cast<std::uint32_t>(Pick(animations.size() + 1));
+                        op.animationData = NewAnimation();
+                    }
+                    break;
+            }
+            return op;
+        }
+
+    private:
+        std::size_t Pick(std::size_t count) {
+            return std::uniform_int_distribution<std::size_t>(0, count - 1)(_random);
+        }
+
+        std::mt19937 _random;
+        std::uint64_t _nextId = 1;
+    };
+
+    struct JournalFixture {
+        StanceStore::StanceMap snapshot;
+        std::uint64_t journalBytes = 0;
+    };
+
+    // Snapshot de 8 categorias e o diário com as edições sobre ele, gravado em StanceJournal::kJournalPath.
+    const JournalFixture& GetJournal() {
+        static const JournalFixture fixture = [] {
+            BenchEnvironment::EnterScratchDirectory();
+            EditSession session(25);
+            JournalFixture result;
+            for (int category = 0; category < 8; ++category) {
+                for (auto& instance : result.snapshot["Category " + std::to_string(category)]) {
+                    for (std::size_t i = 0; i < (kMinMovesets + kMaxMovesets) / 2; ++i) {
+                        instance.push_back(session.NewMoveset());
+                    }
+                }
+            }
+            auto state = result.snapshot;
+            std::string journal = StanceJournal::Header(kSnapshotHash);
+            for (std::size_t i = 0; i < kOperationCount; ++i) {
+                const auto op = session.Next(state);
+                StanceJournal::Apply(state, op);
+                journal += StanceJournal::Encode(op);
+            }
+            std::ofstream(StanceJournal::kJournalPath, std::ios::binary)
+                .write(journal.data(), static_cast<std::streamsize>(journal.size()));
+            result.journalBytes = journal.size();
+            return result;
+        }();
+        return fixture;
+    }
+}
+
+static void BM_StanceJournalDecode(benchmark::State& state) {
+    const auto& journal = GetJournal();
+    std::size_t decoded = 0;
+    for (auto _ : state) {
+        const auto ops = StanceJournal::Load(kSnapshotHash);
+        decoded = ops ? ops->size() : 0;
+        benchmark::DoNotOptimize(decoded);
+    }
+    state.counters["ops"] = static_cast<double>(decoded);
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * journal.journalBytes));
+}
+BENCHMARK(BM_StanceJournalDecode)->Unit(benchmark::kMillisecond);
+
+// Leitura e reaplicação sobre uma cópia do snapshot, pela mesma StanceJournal::Replay do carregamento. Todas as
+// edições têm que valer: foram geradas sobre o mesmo estado.
+static void BM_StanceJournalReplay(benchmark::State& state) {
+    const auto& journal = GetJournal();
+    std::size_t applied = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto stances = journal.snapshot;
+        state.ResumeTiming();
+        auto ops = StanceJournal::Load(kSnapshotHash);
+        applied = ops ? StanceJournal::Replay(stances, std::move(*ops)).size() : 0;
+        if (applied != kOperationCount) {
+            state.SkipWithError("Edições do diário não reaplicadas");
+            break;
+        }
+        benchmark::DoNotOptimize(stances);
+    }
+    state.counters["ops"] = static_cast<double>(applied);
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * kOperationCount));
+}
+BENCHMARK(BM_StanceJournalReplay)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,143 @@
+﻿#include <benchmark/benchmark.h>
+#include <random>
+#include "LibraryId.h"
+#include "ModNameIndex.h"
+
+// Resolução das 50 mil referências de um carregamento grande de stances (mod + sub-animação por nome ou por
+// LibraryId) pelo ModNameIndex, contra as buscas lineares em _allMods que ele substituiu.
+namespace {
+    constexpr std::size_t kReferenceCount = 50'000;
+
+    struct Reference {
+        std::string modName;
+        std::string subName;
+        LibraryId::Id modId;
+        LibraryId::Id subId;
+    };
+
+    // `mods` mods de 25 sub-animações, como depois do escaneamento, e referências sorteadas entre eles. Uma em
+    // cada 20 aponta para um mod que não existe mais.
+    struct NameLibrary {
+        std::vector<AnimationModDef> mods;
+        std::vector<Reference> references;
+    };
+
+    NameLibrary MakeNameLibrary(std::size_t modCount) {
+        constexpr std::size_t kSubAnimationsPerMod = 25;
+        auto& pool = StringPool::GetSingleton();
+        NameLibrary library;
+        for (std::size_t modIdx = 0; modIdx < modCount; ++modIdx) {
+            AnimationModDef mod;
+            mod.name = "Synthetic Mod " + std::to_string(modIdx);
+            mod.id = LibraryId::FromUtf8(mod.name);
+            for (std::size_t subIdx = 0; subIdx < kSubAnimationsPerMod; ++subIdx) {
+                const auto subName = std::to_string(700000 + modIdx * kSubAnimationsPerMod + subIdx);
+                SubAnimationDef subAnimation;
+                subAnimation.name = pool.Intern(subName);
+                subAnimation.id = LibraryId::FromUtf8(mod.name + "/" + subName);
+                mod.subAnimations.push_back(subAnimation);
+            }
+            library.mods.push_back(std::move(mod));
+        }
+
+        std::mt19937 random(22);
+        std::uniform_int_distribution<std::size_t> pickMod(0, modCount - 1), pickSub(0, kSubAnimationsPerMod - 1);
+        std::bernoulli_distribution missing(0.05);
+        for (std::size_t i = 0; i < kReferenceCount; ++i) {
+            const auto& mod = library.mods[pickMod(random)];
+            const auto& subAnimation = mod.subAnimations[pickSub(random)];
+            Reference reference{mod.name, std::string(subAnimation.name.View()), mod.id, subAnimation.id};
+            if (missing(random)) {
+                reference.modName += " (removido)";
+                reference.modId = LibraryId::FromUtf8(reference.modName);
+            }
+            library.references.push_back(std::move(reference));
+        }
+        return library;
+    }
+
+    std::optional<std::size_t> FindModLinear(const std::vector<AnimationModDef>& mods, const std::string& name) {
+        for (std::size_t i = 0; i < mods.size(); ++i) {
+            if (mods[i].name == name) return i;
+        }
+        return std::nullopt;
+    }
+
+    std::optional<std::size_t> FindSubAnimLinear(const std::vector<AnimationModDef>& mods, std::size_t modIdx,
+                                                 const std::string& name) {
+        const auto& subAnimations = mods[modIdx].subAnimations;
+        for (std::size_t i = 0; i < subAnimations.size(); ++i) {
+            if (subAnimations[i].name == name) return i;
+        }
+        return std::nullopt;
+    }
+
+    // Índice do mod e da sub-animação, ou (mods, 0) quando o mod não existe.
+    std::pair<std::size_t, std::size_t> ResolveIndexed(const ModNameIndex& index, const Reference& reference,
+                                                       std::size_t notFound) {
+        const auto modIdx = index.FindMod(reference.modName);
+        if (!modIdx) return {notFound, 0};
+        return {*modIdx, index.FindSubAnim(*modIdx, reference.subName).value_or(notFound)};
+    }
+
+    std::pair<std::size_t, std::size_t> ResolveLinear(const std::vector<AnimationModDef>& mods,
+                                                      const Reference& reference) {
+        const auto modIdx = FindModLinear(mods, reference.modName);
+        if (!modIdx) return {mods.size(), 0};
+        return {*modIdx, FindSubAnimLinear(mods, *modIdx, reference.subName).value_or(mods.size())};
+    }
+}
+
+static void BM_ModNameIndexBuild(benchmark::State& state) {
+    const auto library = MakeNameLibrary(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        ModNameIndex index;
+        index.Append(library.mods);
+        benchmark::DoNotOptimize(index);
+    }
+}
+BENCHMARK(BM_ModNameIndexBuild)->Arg(1500)->Arg(5000)->Unit(benchmark::kMillisecond);
+
+static void BM_ModNameIndexByName(benchmark::State& state) {
+    const auto library = MakeNameLibrary(static_cast<std::size_t>(state.range(0)));
+    ModNameIndex index;
+    index.Append(library.mods);
+    for (const auto& reference : library.references) {
+        if (ResolveIndexed(index, reference, library.mods.size()) != ResolveLinear(library.mods, reference)) {
+            state.SkipWithError(("Resultado diferente da busca linear: " + reference.modName).c_str());
+            return;
+        }
+    }
+    for (auto _ : state) {
+        for (const auto& reference : library.references) {
+            benchmark::DoNotOptimize(ResolveIndexed(index, reference, library.mods.size()));
+        }
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * library.references.size()));
+}
+BENCHMARK(BM_ModNameIndexByName)->Arg(1500)->Arg(5000)->Unit(benchmark::kMillisecond);
+
+static void BM_ModNameIndexById(benchmark::State& state) {
+    const auto library = MakeNameLibrary(static_cast<std::size_t>(state.range(0)));
+    ModNameIndex index;
+    index.Append(library.mods);
+    for (auto _ : state) {
+        for (const auto& reference : library.references) {
+            const auto modIdx = index.FindModById(reference.modId);
+            if (modIdx) benchmark::DoNotOptimize(index.FindSubAnimById(*modIdx, reference.subId));
+        }
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * library.references.size()));
+}
+BENCHMARK(BM_ModNameIndexById)->Arg(1500)->Arg(5000)->Unit(benchmark::kMillisecond);
+
+static void BM_LinearNameLookup(benchmark::State& state) {
+    const auto library = MakeNameLibrary(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        for (const auto& reference : library.references) {
+            benchmark::DoNotOptimize(ResolveLinear(library.mods, reference));
+        }
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * library.references.size()));
+}
+BENCHMARK(BM_LinearNameLookup)->Arg(1500)->Arg(5000)->Unit(benchmark::kMillisecond);
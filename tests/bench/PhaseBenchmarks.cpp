@@ -0,0 +1,224 @@
+﻿#include <benchmark/benchmark.h>
+#include "AtomicFile.h"
+#include "BenchEnvironment.h"
+#include "ConditionEmitter.h"
+#include "ConfigRewriter.h"
+#include "LibraryCache.h"
+#include "LibraryId.h"
+#include "LibraryScanner.h"
+#include "ManagedManifest.h"
+#include "Samples.h"
+#include "StanceStore.h"
+#include "ThreadPool.h"
+
+// As fases medidas pelo Diagnostics, sobre a biblioteca sintética. O escaneamento chama o mesmo
+// LibraryScanner::ScanLibrary do plugin; as outras funções abaixo repetem o que o AnimationManager faz em cada
+// fase, sem o estado do manager e sem o jogo.
+namespace {
+    using Diagnostics::Phase;
+
+    // Apaga o índice salvo: o próximo ScanLibrary escaneia todo mod, como no primeiro carregamento.
+    void DropLibraryIndex() { std::filesystem::remove(LibraryCache::kIndexPath); }
+
+    // A fase LibraryScan de ScanAnimationMods, pela mesma LibraryScanner::ScanLibrary do plugin. Devolve quantos
+    // submods foram encontrados; `fingerprint` recebe um hash dos nomes na ordem em que saíram.
+    std::size_t ScanLibrary(std::size_t threads = 0, std::uint64_t* fingerprint = nullptr) {
+        Diagnostics::ScopedPhase phase(Phase::LibraryScan);
+        const auto scan = LibraryScanner::ScanLibrary(BenchEnvironment::GetLibrary().root, threads);
+        std::size_t submods = 0;
+        std::uint64_t hash = LibraryId::FromUtf8("");
+        for (const auto& entry : scan.entries) {
+            if (!entry.mod) continue;
+            submods += entry.mod->subAnimations.size();
+            hash = LibraryId::Append(hash, entry.mod->name);
+            for (const auto& subAnimation : entry.mod->subAnimations) {
+                hash = LibraryId::Append(hash, subAnimation.name.View());
+            }
+        }
+        if (fingerprint) *fingerprint = hash;
+        return submods;
+    }
+
+    // ScanManagedFiles: procura o marcador em todos os candidatos, carimba os gerenciados e grava o manifesto.
+    ManagedFileMap ScanManagedFiles(const std::vector<std::filesystem::path>& candidates) {
+        Diagnostics::ScopedPhase phase(Phase::ManagedFiles);
+        std::vector<char> managed(candidates.size(), 0);
+        {
+            ThreadPool pool;
+            for (std::size_t i = 0; i < candidates.size(); ++i) {
+                pool.Submit([&candidates, &managed, i] {
+                    managed[i] = ManagedManifest::ContainsMarker(candidates[i]) ? 1 : 0;
+                });
+            }
+            pool.Wait();
+        }
+        ManagedFileMap managedFiles;
+        for (std::size_t i = 0; i < candidates.size(); ++i) {
+            if (!managed[i]) continue;
+            ManagedFileRecord record;
+            ManagedManifest::Stamp(candidates[i], record);
+            managedFiles[candidates[i]] = record;
+        }
+        ManagedManifest::Save(managedFiles);
+        return managedFiles;
+    }
+
+    // O job de salvamento: PlanConditionFile + ExecuteConditionFilePlan por arquivo, um lote atômico no fim.
+    // Arquivos que já estão na forma pedida são pulados, como no plugin.
+    std::size_t GenerateConditions(const std::vector<std::filesystem::path>& files,
+                                   const std::vector<FileSaveConfig>& configs, int priority) {
+        Diagnostics::ScopedPhase phase(Phase::ConditionGeneration);
+        constexpr bool kPreserveConditions = true;
+        AtomicFileBatch batch;
+        std::atomic<std::size_t> staged{0};
+        {
+            ThreadPool pool;
+            for (std::size_t i = 0; i < files.size(); ++i) {
+                pool.Submit([&, i] {
+                    const auto tree = ConditionIR::Optimize(ConditionIR::BuildTree(configs));
+                    std::string scratch;
+                    rapidjson::StringBuffer compactBlock;
+                    ConditionEmitter::CompactWriter compactWriter(compactBlock);
+                    ConditionEmitter::WriteManagedBlock(compactWriter, tree, scratch);
+                    const auto outputHash = ConditionEmitter::HashManagedOutput(
+                        Fnv1a64(std::string_view(compactBlock.GetString(), compactBlock.GetSize())), priority,
+                        kPreserveConditions);
+
+                    const auto existing = ConfigRewriter::Scan(files[i]);
+                    if (existing.error.empty() &&
+                        ConditionEmitter::MatchesManagedOutput(existing, outputHash, kPreserveConditions)) {
+                        return;
+                    }
+                    const ConfigRewriter::BlockWriter writeManagedBlock = [&](ConfigRewriter::OutputWriter& writer) {
+                        ConditionEmitter::WriteManagedBlock(writer, tree, scratch);
+                    };
+                    rapidjson::StringBuffer buffer;
+                    std::string error;
+                    if (!ConfigRewriter::Rewrite(files[i], existing, priority, kPreserveConditions, writeManagedBlock,
+                                                 buffer, error)) {
+                        return;
+                    }
+                    if (batch.Stage(files[i], std::string_view(buffer.GetString(), buffer.GetSize()), error)) {
+                        ++staged;
+                    }
+                });
+            }
+            pool.Wait();
+        }
+        batch.Commit();
+        return staged;
+    }
+}
+
+// Primeiro carregamento: sem índice salvo, todo mod é listado e tem o cabeçalho lido.
+static void BM_LibraryScan(benchmark::State& state) {
+    BenchEnvironment::GetLibrary();
+    std::size_t submods = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        DropLibraryIndex();
+        state.ResumeTiming();
+        submods = ScanLibrary();
+        benchmark::DoNotOptimize(submods);
+    }
+    state.counters["submods"] = static_cast<double>(submods);
+    BenchEnvironment::ReportPhase(state, Phase::LibraryScan);
+}
+BENCHMARK(BM_LibraryScan)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Carregamento seguinte sem nada mudado: todo mod vem do índice, só com os stats dos carimbos.
+static void BM_LibraryScanCached(benchmark::State& state) {
+    BenchEnvironment::GetLibrary();
+    DropLibraryIndex();
+    std::uint64_t expected = 0, fingerprint = 0;
+    const auto submods = ScanLibrary(0, &expected);
+    for (auto _ : state) {
+        ScanLibrary(0, &fingerprint);
+        if (fingerprint != expected) {
+            state.SkipWithError("O índice devolveu outra biblioteca");
+            break;
+        }
+    }
+    state.counters["submods"] = static_cast<double>(submods);
+    BenchEnvironment::ReportPhase(state, Phase::LibraryScan);
+}
+BENCHMARK(BM_LibraryScanCached)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// O mesmo escaneamento sem índice com 1, 2, 4 e 8 workers: a escala do pool e a prova de que a junção é
+// determinística (a lista de mods e submods tem que sair igual com qualquer número de threads).
+static void BM_LibraryScanThreads(benchmark::State& state) {
+    BenchEnvironment::GetLibrary();
+    const auto threads = static_cast<std::size_t>(state.range(0));
+    std::uint64_t expected = 0, fingerprint = 0;
+    DropLibraryIndex();
+    ScanLibrary(1, &expected);
+    for (auto _ : state) {
+        state.PauseTiming();
+        DropLibraryIndex();
+        state.ResumeTiming();
+        ScanLibrary(threads, &fingerprint);
+        if (fingerprint != expected) {
+            state.SkipWithError("A ordem dos mods mudou com o número de threads");
+            break;
+        }
+    }
+    state.counters["threads"] = static_cast<double>(threads);
+    BenchEnvironment::ReportPhase(state, Phase::LibraryScan);
+}
+BENCHMARK(BM_LibraryScanThreads)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_ManagedFileDetection(benchmark::State& state) {
+    const auto& library = BenchEnvironment::GetLibrary();
+    std::size_t managed = 0;
+    for (auto _ : state) {
+        managed = ScanManagedFiles(library.submodConfigs).size();
+    }
+    state.counters["managed"] = static_cast<double>(managed);
+    BenchEnvironment::ReportPhase(state, Phase::ManagedFiles);
+}
+BENCHMARK(BM_ManagedFileDetection)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// A prioridade alterna a cada iteração para que todo arquivo mude e seja regravado.
+static void BM_ConditionGeneration(benchmark::State& state) {
+    const auto& library = BenchEnvironment::GetLibrary();
+    const auto samples = Samples::MakeConditionConfigs();
+    int iteration = 0;
+    std::size_t written = 0;
+    for (auto _ : state) {
+        written = GenerateConditions(library.submodConfigs, samples->configs, 200000000 + (iteration++ & 1));
+    }
+    state.counters["files_rewritten"] = static_cast<double>(written);
+    BenchEnvironment::ReportPhase(state, Phase::ConditionGeneration);
+}
+BENCHMARK(BM_ConditionGeneration)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Serializa e grava o store, como o SaveStanceConfigurations e o Autosave juntos.
+static void BM_StanceSave(benchmark::State& state) {
+    const auto stances = SyntheticLibrary::MakeStances(BenchEnvironment::GetLibrary(), 8, 12, 8, 25);
+    for (auto _ : state) {
+        Diagnostics::ScopedPhase phase(Phase::StanceSave);
+        std::string error;
+        if (!AtomicFileBatch::Write(StanceStore::kStorePath, StanceStore::Serialize(stances), error)) {
+            state.SkipWithError(error.c_str());
+            break;
+        }
+    }
+    BenchEnvironment::ReportPhase(state, Phase::StanceSave);
+}
+BENCHMARK(BM_StanceSave)->Unit(benchmark::kMillisecond);
+
+static void BM_StanceLoad(benchmark::State& state) {
+    const auto stances = SyntheticLibrary::MakeStances(BenchEnvironment::GetLibrary(), 8, 12, 8, 25);
+    std::string error;
+    if (!AtomicFileBatch::Write(StanceStore::kStorePath, StanceStore::Serialize(stances), error)) {
+        state.SkipWithError(error.c_str());
+        return;
+    }
+    for (auto _ : state) {
+        Diagnostics::ScopedPhase phase(Phase::StanceLoad);
+        auto loaded = StanceStore::Load();
+        benchmark::DoNotOptimize(loaded);
+    }
+    BenchEnvironment::ReportPhase(state, Phase::StanceLoad);
+}
+BENCHMARK(BM_StanceLoad)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,158 @@
+﻿#include "SyntheticLibrary.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include "LibraryId.h"
+#include "ManagedManifest.h"
+
+namespace {
+    constexpr std::string_view kTaggedPrefixes[] = {
+        "bfco_attack", "bfco_powerattack", "mco_sprintattack", "1hm_sprint_attack",
+        "1hm_idle",    "dodge_fwd",        "evade_back",       "1hm_blockidle",
+        "shield_bash", "1hm_equip",        "1hm_unequip",      "weapon_sheathe",
+    };
+    constexpr std::string_view kUntaggedPrefixes[] = {
+        "mt_walkforward", "mt_runforward", "mt_turnleft", "npc_hitframe", "1hm_recoil", "mco_attack", "staggered",
+    };
+
+    std::string RandomCase(std::string_view text, std::mt19937& random) {
+        std::string result(text);
+        std::bernoulli_distribution upper(0.3);
+        for (auto& c : result) {
+            if (c >= 'a' && c <= 'z' && upper(random)) c = static_cast<char>(c - 'a' + 'A');
+        }
+        return result;
+    }
+
+    std::uint64_t WriteFile(const std::filesystem::path& path, const std::string& content) {
+        std::ofstream file(path, std::ios::binary);
+        file.write(content.data(), static_cast<std::streamsize>(content.size()));
+        return content.size();
+    }
+
+    // Condições de terceiros até passar de `bytes`, como os config.json que já vêm nos packs.
+    std::string SubmodConfig(std::size_t index, std::size_t bytes, bool managed, std::mt19937& random) {
+        std::string content = "{\n    \"name\": \"Submod " + std::to_string(index) + "\",\n    \"priority\": " +
+                              std::to_string(100 + index) + ",\n    \"conditions\": [\n";
+        if (managed) {
+            content += "        {\n            \"condition\": \"OR\",\n            \"comment\": \"" +
+                       std::string(ManagedManifest::kMarker) +
+                       "\",\n            \"Conditions\": [{\"condition\": \"CompareValues\"}]\n        },\n";
+        }
+        std::uniform_int_distribution<int> type(1, 9);
+        do {
+            content += "        {\n            \"condition\": \"IsEquippedType\",\n            \"Type\": {\"value\": " +
+                       std::to_string(type(random)) + "},\n            \"Left hand\": false\n        },\n";
+        } while (content.size() < bytes);
+        content += "        {\"condition\": \"IsRunning\", \"negated\": true}\n    ]\n}\n";
+        return content;
+    }
+}
+
+SyntheticLibrary::Options SyntheticLibrary::FromEnvironment() {
+    Options options;
+    const char* value = std::getenv("CYCLEMOVESETS_BENCH_LIBRARY");
+    if (!value) return options;
+    std::size_t* fields[] = {&options.mods, &options.submodsPerMod, &options.animationsPerSubmod,
+                             &options.configBytes};
+    const std::string_view text(value);
+    std::size_t begin = 0;
+    for (auto* field : fields) {
+        const auto end = std::min(text.find(',', begin), text.size());
+        if (end > begin) *field = std::stoul(std::string(text.substr(begin, end - begin)));
+        if (end == text.size()) break;
+        begin = end + 1;
+    }
+    return options;
+}
+
+SyntheticLibrary::Library SyntheticLibrary::Generate(const std::filesystem::path& root, const Options& options) {
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+    std::mt19937 random(options.seed);
+    std::bernoulli_distribution managed(options.managedFraction), nested(0.25);
+
+    Library library;
+    library.root = root;
+    std::size_t submodIndex = 0;
+    for (std::size_t mod = 0; mod < options.mods; ++mod) {
+        const auto modName = "Synthetic Mod " + std::to_string(mod);
+        const auto modPath = root / modName;
+        std::filesystem::create_directories(modPath);
+        library.modNames.push_back(modName);
+        library.bytes += WriteFile(modPath / "config.json", "{\n    \"name\": \"" + modName +
+                                                                "\",\n    \"author\": \"Gerador\",\n    "
+                                                                "\"description\": \"Biblioteca sintética\"\n}\n");
+        ++library.files;
+
+        for (std::size_t sub = 0; sub < options.submodsPerMod; ++sub, ++submodIndex) {
+            // Parte dos submods fica numa pasta intermediária sem config.json, como nos packs organizados por arma.
+            auto submodPath = modPath;
+            if (nested(random)) submodPath /= "Group " + std::to_string(sub % 4);
+            submodPath /= std::to_string(700000 + submodIndex);
+            std::filesystem::create_directories(submodPath);
+            const auto configPath = submodPath / "config.json";
+            library.bytes +=
+                WriteFile(configPath, SubmodConfig(submodIndex, options.configBytes, managed(random), random));
+            library.submodConfigs.push_back(configPath);
+            ++library.files;
+            for (const auto& filename :
+                 MakeFilenames(options.animationsPerSubmod, options.seed + static_cast<unsigned>(submodIndex))) {
+                std::ofstream(submodPath / filename, std::ios::binary);
+                ++library.files;
+            }
+        }
+    }
+    return library;
+}
+
+std::vector<std::string> SyntheticLibrary::MakeFilenames(std::size_t count, unsigned seed) {
+    std::mt19937 random(seed);
+    std::bernoulli_distribution tagged(0.6), upperExtension(0.125);
+    std::uniform_int_distribution<std::size_t> taggedPrefix(0, std::size(kTaggedPrefixes) - 1);
+    std::uniform_int_distribution<std::size_t> untaggedPrefix(0, std::size(kUntaggedPrefixes) - 1);
+    std::uniform_int_distribution<int> variant(1, 40);
+    std::vector<std::string> filenames;
+    filenames.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto prefix =
+            tagged(random) ? kTaggedPrefixes[taggedPrefix(random)] : kUntaggedPrefixes[untaggedPrefix(random)];
+        // O índice entra no nome para que os arquivos de um submod não colidam.
+        filenames.push_back(RandomCase(prefix, random) + std::to_string(variant(random)) + "_" + std::to_string(i) +
+                            (upperExtension(random) ? ".HKX" : ".hkx"));
+    }
+    return filenames;
+}
+
+StanceStore::StanceMap SyntheticLibrary::MakeStances(const Library& library, std::size_t categories,
+                                                     std::size_t movesetsPerInstance,
+                                                     std::size_t animationsPerMoveset, unsigned seed) {
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<std::size_t> pick(0, library.submodConfigs.size() - 1);
+    std::uniform_int_distribution<int> flags(0, 0x3FF);
+    StanceStore::StanceMap stances;
+    for (std::size_t category = 0; category < categories; ++category) {
+        auto& instances = stances["Category " + std::to_string(category)];
+        for (auto& instance : instances) {
+            for (std::size_t moveset = 0; moveset < movesetsPerInstance; ++moveset) {
+                StanceStore::Moveset entry;
+                entry.name = "Moveset " + std::to_string(moveset);
+                entry.id = LibraryId::ForUserMoveset(entry.name);
+                for (std::size_t animation = 0; animation < animationsPerMoveset; ++animation) {
+                    const auto relative =
+                        library.submodConfigs[pick(random)].parent_path().lexically_relative(library.root);
+                    StanceStore::Animation item;
+                    item.sourceModName = relative.begin()->string();
+                    item.sourceSubName = relative.filename().string();
+                    item.sourceModId = LibraryId::FromRelativePath(*relative.begin());
+                    item.sourceSubId = LibraryId::FromRelativePath(relative);
+                    item.flags = static_cast<std::uint16_t>(flags(random));
+                    entry.animations.push_back(std::move(item));
+                }
+                instance.push_back(std::move(entry));
+            }
+        }
+    }
+    return stances;
+}
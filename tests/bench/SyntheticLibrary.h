@@ -0,0 +1,44 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "StanceStore.h"
+
+// Biblioteca do OAR gerada para os benchmarks: mods de topo com config.json, submods com config.json e arquivos
+// .hkx vazios (só o nome importa para o escaneamento). Tudo sai de uma semente: a mesma configuração gera
+// sempre a mesma árvore.
+namespace SyntheticLibrary {
+    struct Options {
+        std::size_t mods = 200;
+        std::size_t submodsPerMod = 20;
+        std::size_t animationsPerSubmod = 40;  // .hkx por submod
+        std::size_t configBytes = 4096;        // Tamanho aproximado do config.json de cada submod
+        double managedFraction = 0.5;          // Submods que já trazem o bloco gerenciado
+        unsigned seed = 9;
+    };
+
+    // Lê CYCLEMOVESETS_BENCH_LIBRARY="mods,submods,hkx,bytes" (campos vazios ficam no padrão).
+    Options FromEnvironment();
+
+    struct Library {
+        std::filesystem::path root;                        // A pasta que faz o papel de OpenAnimationReplacer
+        std::vector<std::filesystem::path> submodConfigs;  // Em ordem de geração
+        std::vector<std::string> modNames;
+        std::uint64_t files = 0;
+        std::uint64_t bytes = 0;
+    };
+
+    // Apaga `root` e gera a biblioteca dentro dela.
+    Library Generate(const std::filesystem::path& root, const Options& options);
+
+    // Nomes de arquivo no formato dos packs de animação: prefixos conhecidos (bfco_attack, sprintattack, idle,
+    // dodge...) e outros sem tag, com caixa e numeração variadas.
+    std::vector<std::string> MakeFilenames(std::size_t count, unsigned seed);
+
+    // Stances de `categories` categorias, cada instância com `movesetsPerInstance` movesets de
+    // `animationsPerMoveset` animações, apontando para submods sorteados de `library`.
+    StanceStore::StanceMap MakeStances(const Library& library, std::size_t categories, std::size_t movesetsPerInstance,
+                                       std::size_t animationsPerMoveset, unsigned seed);
+}
@@ -0,0 +1,56 @@
+﻿// Alvo do libFuzzer para as duas passadas do ConfigRewriter sobre um config.json qualquer. Cada entrada é
+// escaneada e reescrita com e sem preservar as condições de terceiros, e a saída tem que passar nas mesmas
+// verificações de consistência do plugin. Corpus inicial: tests/data.
+#include <cstdlib>
+#include "ConditionEmitter.h"
+#include "ConfigRewriter.h"
+#include "ManagedManifest.h"
+
+namespace {
+    const ConditionIR::Node& Tree() {
+        using ConditionIR::Kind;
+        using ConditionIR::Node;
+        static const Node tree = [] {
+            Node directions{Kind::Or, 0.0, {Node{Kind::Direction, 1.0, {}}, Node{Kind::Random, 2.0, {}}}};
+            Node branch{Kind::And, 0.0, {Node{Kind::ActorBase, 0.0, {}}, Node{Kind::EquippedRight, 1.0, {}}, directions}};
+            return Node{Kind::Or, 0.0, {branch}};
+        }();
+        return tree;
+    }
+
+    void Check(std::string_view content, bool preserveConditions) {
+        constexpr int kPriority = 200000001;
+        const auto existing = ConfigRewriter::ScanContent(content);
+        std::string scratch;
+        rapidjson::StringBuffer compactBlock;
+        ConditionEmitter::CompactWriter compactWriter(compactBlock);
+        ConditionEmitter::WriteManagedBlock(compactWriter, Tree(), scratch);
+        const auto outputHash = ConditionEmitter::HashManagedOutput(
+            Fnv1a64(std::string_view(compactBlock.GetString(), compactBlock.GetSize())), kPriority, preserveConditions);
+
+        const ConfigRewriter::BlockWriter writeManagedBlock = [&](ConfigRewriter::OutputWriter& writer) {
+            ConditionEmitter::WriteManagedBlock(writer, Tree(), scratch);
+        };
+        rapidjson::StringBuffer buffer;
+        std::string error;
+        if (!ConfigRewriter::RewriteContent(content, existing, kPriority, preserveConditions, writeManagedBlock, buffer,
+                                            error)) {
+            // A primeira passada aceitou o conteúdo; a segunda, com o mesmo conteúdo, também tem que aceitar.
+            std::abort();
+        }
+        const auto violation =
+            ConditionEmitter::CheckGeneratedOutput(std::string_view(buffer.GetString(), buffer.GetSize()), existing,
+                                                   kPriority, true, outputHash, preserveConditions);
+        if (!violation.empty()) {
+            SKSE::log::critical("{}", violation);
+            std::abort();
+        }
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size) {
+    const std::string_view content(reinterpret_cast<const char*>(data), size);
+    Check(content, false);
+    Check(content, true);
+    return 0;
+}
@@ -0,0 +1,172 @@
+#include "Generators.h"
+
+#include <gtest/gtest.h>
+#include "ConditionEmitter.h"
+#include "ConfigRewriter.h"
+#include "ManagedManifest.h"
+#include "StateKey.h"
+#include "rapidjson/prettywriter.h"
+
+namespace {
+    using Allocator = rapidjson::Document::AllocatorType;
+
+    void AddEquippedType(rapidjson::Value& conditions, double type, bool leftHand, Allocator& allocator) {
+        rapidjson::Value equippedType(rapidjson::kObjectType);
+        equippedType.AddMember("condition", "IsEquippedType", allocator);
+        rapidjson::Value typeVal(rapidjson::kObjectType);
+        typeVal.AddMember("value", type, allocator);
+        equippedType.AddMember("Type", typeVal, allocator);
+        equippedType.AddMember("Left hand", leftHand, allocator);
+        conditions.PushBack(equippedType, allocator);
+    }
+
+    void AddNode(rapidjson::Value& conditions, const ConditionIR::Node& node, Allocator& allocator) {
+        using ConditionIR::Kind;
+        using ConditionEmitter::AddCompareValuesCondition;
+        using ConditionEmitter::AddNegatedCompareValuesCondition;
+        const int value = static_cast<int>(node.value);
+        switch (node.kind) {
+            case Kind::And:
+            case Kind::Or: {
+                rapidjson::Value group(rapidjson::kObjectType);
+                group.AddMember("condition", node.kind == Kind::And ? "AND" : "OR", allocator);
+                rapidjson::Value children(rapidjson::kArrayType);
+                for (const auto& child : node.children) AddNode(children, child, allocator);
+                group.AddMember("Conditions", children, allocator);
+                conditions.PushBack(group, allocator);
+                break;
+            }
+            case Kind::ActorBase: {
+                rapidjson::Value actorBase(rapidjson::kObjectType);
+                actorBase.AddMember("condition", "IsActorBase", allocator);
+                rapidjson::Value actorBaseParams(rapidjson::kObjectType);
+                actorBaseParams.AddMember("pluginName", "Skyrim.esm", allocator);
+                actorBaseParams.AddMember("formID", "7", allocator);
+                actorBase.AddMember("Actor base", actorBaseParams, allocator);
+                conditions.PushBack(actorBase, allocator);
+                break;
+            }
+            case Kind::EquippedRight:
+                AddEquippedType(conditions, node.value, false, allocator);
+                break;
+            case Kind::EquippedLeft:
+                AddEquippedType(conditions, node.value, true, allocator);
+                break;
+            case Kind::CycleInstance:
+                AddCompareValuesCondition(conditions, "cycle_instance", value, allocator);
+                break;
+            case Kind::PlaylistOrder:
+                AddCompareValuesCondition(conditions, "testarone", value, allocator);
+                break;
+            case Kind::NegatedDirection:
+                AddNegatedCompareValuesCondition(conditions, "DirecionalCycleMoveset", value, allocator);
+                break;
+            case Kind::Random:
+                ConditionEmitter::AddRandomCondition(conditions, value, allocator);
+                break;
+            case Kind::Direction:
+                AddCompareValuesCondition(conditions, "DirecionalCycleMoveset", value, allocator);
+                break;
+            case Kind::KillSwitch:
+                AddCompareValuesCondition(conditions, "CycleMovesetDisable", value, allocator);
+                break;
+            case Kind::StateEquals:
+                AddCompareValuesCondition(conditions, StateKey::kGraphVariable, value, allocator);
+                break;
+            case Kind::StateNotEquals:
+                AddNegatedCompareValuesCondition(conditions, StateKey::kGraphVariable, value, allocator);
+                break;
+            case Kind::StateAtLeast:
+                AddCompareValuesCondition(conditions, StateKey::kGraphVariable, value, allocator, "<=");
+                break;
+            case Kind::StateAtMost:
+                AddCompareValuesCondition(conditions, StateKey::kGraphVariable, value, allocator, ">=");
+                break;
+        }
+    }
+}
+
+std::string Generators::Streaming(std::optional<std::string_view> content, const ConditionIR::Node* tree,
+                                  int priority, bool preserveConditions) {
+    const auto existing = content ? ConfigRewriter::ScanContent(*content) : ConfigRewriter::ExistingConfig{};
+    std::string scratch;
+    rapidjson::StringBuffer compactBlock;
+    ConditionEmitter::CompactWriter compactWriter(compactBlock);
+    if (tree) {
+        ConditionEmitter::WriteManagedBlock(compactWriter, *tree, scratch);
+    } else {
+        compactWriter.Null();
+    }
+    const auto outputHash = ConditionEmitter::HashManagedOutput(
+        Fnv1a64(std::string_view(compactBlock.GetString(), compactBlock.GetSize())), priority, preserveConditions);
+
+    ConfigRewriter::BlockWriter writeManagedBlock;
+    if (tree) {
+        writeManagedBlock = [&](ConfigRewriter::OutputWriter& writer) {
+            ConditionEmitter::WriteManagedBlock(writer, *tree, scratch);
+        };
+    }
+    rapidjson::StringBuffer buffer;
+    std::string error;
+    EXPECT_TRUE(ConfigRewriter::RewriteContent(content.value_or(""), existing, priority, preserveConditions,
+                                               writeManagedBlock, buffer, error))
+        << error;
+    std::string output(buffer.GetString(), buffer.GetSize());
+    EXPECT_EQ(ConditionEmitter::CheckGeneratedOutput(output, existing, priority, tree != nullptr, outputHash,
+                                                     preserveConditions),
+              "");
+    return output;
+}
+
+std::string Generators::Dom(std::optional<std::string_view> content, const ConditionIR::Node* tree, int priority,
+                            bool preserveConditions) {
+    rapidjson::Document doc;
+    if (!content || doc.Parse(content->data(), content->size()).HasParseError()) doc.SetObject();
+    if (!doc.IsObject()) doc.SetObject();
+    auto& allocator = doc.GetAllocator();
+
+    if (doc.HasMember("priority")) {
+        doc["priority"].SetInt(priority);
+    } else {
+        doc.AddMember("priority", priority, allocator);
+    }
+
+    rapidjson::Value oldConditions(rapidjson::kArrayType);
+    if (preserveConditions && doc.HasMember("conditions") && doc["conditions"].IsArray()) {
+        for (auto& cond : doc["conditions"].GetArray()) {
+            if (cond.IsObject() && cond.HasMember("comment") && cond["comment"] == "OAR_CYCLE_MANAGER_CONDITIONS") {
+                continue;
+            }
+            rapidjson::Value copy;
+            copy.CopyFrom(cond, allocator);
+            oldConditions.PushBack(copy, allocator);
+        }
+    }
+    if (doc.HasMember("conditions")) {
+        doc["conditions"].SetArray();
+    } else {
+        doc.AddMember("conditions", rapidjson::Value(rapidjson::kArrayType), allocator);
+    }
+    rapidjson::Value& conditions = doc["conditions"];
+    if (preserveConditions && !oldConditions.Empty()) {
+        rapidjson::Value oldConditionsBlock(rapidjson::kObjectType);
+        oldConditionsBlock.AddMember("condition", "OR", allocator);
+        oldConditionsBlock.AddMember("comment", "Old Conditions", allocator);
+        oldConditionsBlock.AddMember("Conditions", oldConditions, allocator);
+        conditions.PushBack(oldConditionsBlock, allocator);
+    }
+    if (tree) {
+        rapidjson::Value masterOrBlock(rapidjson::kObjectType);
+        masterOrBlock.AddMember("condition", "OR", allocator);
+        masterOrBlock.AddMember("comment", "OAR_CYCLE_MANAGER_CONDITIONS", allocator);
+        rapidjson::Value innerConditions(rapidjson::kArrayType);
+        for (const auto& child : tree->children) AddNode(innerConditions, child, allocator);
+        masterOrBlock.AddMember("Conditions", innerConditions, allocator);
+        conditions.PushBack(masterOrBlock, allocator);
+    }
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+    doc.Accept(writer);
+    return std::string(buffer.GetString(), buffer.GetSize());
+}
@@ -0,0 +1,19 @@
+﻿#pragma once
+#include <optional>
+#include <string>
+#include <string_view>
+#include "ConditionIR.h"
+
+// As duas formas de gerar um config.json a partir de uma árvore de condições. Sem `content`, o arquivo não
+// existia; sem `tree`, o arquivo fica sem bloco gerenciado.
+namespace Generators {
+    // O caminho do PlanConditionFile sem o disco: hash da forma compacta, reescrita em streaming com os templates
+    // e as verificações de consistência, que aqui sempre rodam (falhas viram falhas do teste).
+    std::string Streaming(std::optional<std::string_view> content, const ConditionIR::Node* tree, int priority,
+                          bool preserveConditions);
+
+    // Como o plugin gerava antes da reescrita em streaming e dos templates: o documento inteiro carregado no DOM,
+    // alterado e serializado pelo PrettyWriter. É a referência das comparações com a saída em streaming.
+    std::string Dom(std::optional<std::string_view> content, const ConditionIR::Node* tree, int priority,
+                    bool preserveConditions);
+}
@@ -0,0 +1,67 @@
+﻿#pragma once
+// PCH dos testes e benchmarks: o papel do include/PCH.h sem o jogo. Os headers da biblioteca padrão que o
+// RE/Skyrim.h traria e um SKSE::log que escreve no stderr.
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <format>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace SKSE::log {
+    inline void Write(std::string_view level, const std::string& message) {
+        std::fprintf(stderr, "[%.*s] %s\n", static_cast<int>(level.size()), level.data(), message.c_str());
+    }
+
+    template <class... Args>
+    void trace(std::format_string<Args...> format, Args&&... args) {
+        Write("trace", std::format(format, std::forward<Args>(args)...));
+    }
+    template <class... Args>
+    void debug(std::format_string<Args...> format, Args&&... args) {
+        Write("debug", std::format(format, std::forward<Args>(args)...));
+    }
+    template <class... Args>
+    void info(std::format_string<Args...> format, Args&&... args) {
+        Write("info", std::format(format, std::forward<Args>(args)...));
+    }
+    template <class... Args>
+    void warn(std::format_string<Args...> format, Args&&... args) {
+        Write("warn", std::format(format, std::forward<Args>(args)...));
+    }
+    template <class... Args>
+    void error(std::format_string<Args...> format, Args&&... args) {
+        Write("error", std::format(format, std::forward<Args>(args)...));
+    }
+    template <class... Args>
+    void critical(std::format_string<Args...> format, Args&&... args) {
+        Write("critical", std::format(format, std::forward<Args>(args)...));
+    }
+}
+
+#ifndef _MSC_VER
+// fopen_s só existe no MSVC. Fora dele (os benchmarks no Linux), o código do plugin usa este.
+inline int fopen_s(std::FILE** file, const char* path, const char* mode) {
+    *file = std::fopen(path, mode);
+    return *file ? 0 : errno;
+}
+#endif
+
+namespace logger = SKSE::log;
+using namespace std::literals;
@@ -0,0 +1,52 @@
+#include "Samples.h"
+
+std::unique_ptr<Samples::ConditionConfigs> Samples::MakeConditionConfigs() {
+    auto result = std::make_unique<ConditionConfigs>();
+    result->sword.name = "Sword";
+    result->sword.equippedTypeValue = 1.0;
+    result->dualSword.name = "DualSword";
+    result->dualSword.equippedTypeValue = 1.0;
+    result->dualSword.isDualWield = true;
+
+    const auto* sword = &result->sword;
+    result->configs = {
+        {.instance_index = 1, .order_in_playlist = 1, .category = sword, .isParent = true},
+        {.instance_index = 1, .order_in_playlist = 1, .category = sword, .pFront = true, .pBack = true},
+        {.instance_index = 1, .order_in_playlist = 2, .category = sword, .pLeft = true, .pRandom = true},
+        {.instance_index = 2, .order_in_playlist = 1, .category = &result->dualSword, .isParent = true},
+        {.instance_index = 0, .order_in_playlist = 0, .category = sword},
+    };
+    return result;
+}
+
+std::vector<FileSaveConfig> Samples::MakeRandomConfigs(std::mt19937& random, const WeaponCategory& single,
+                                                       const WeaponCategory& dual) {
+    std::uniform_int_distribution<int> count(0, 8), instance(0, 3), order(0, 4), coin(0, 1);
+    std::vector<FileSaveConfig> configs(static_cast<std::size_t>(count(random)));
+    for (auto& config : configs) {
+        config.instance_index = instance(random);
+        config.order_in_playlist = order(random);
+        config.category = coin(random) ? &single : &dual;
+        config.isParent = coin(random) && coin(random);
+        for (bool* flag : {&config.pFront, &config.pFrontRight, &config.pRight, &config.pBackRight, &config.pBack,
+                           &config.pBackLeft, &config.pLeft, &config.pFrontLeft, &config.pRandom}) {
+            *flag = coin(random) && coin(random);
+        }
+    }
+    return configs;
+}
+
+ConditionIR::Node Samples::MakeDeepTree(int levels) {
+    using ConditionIR::Kind;
+    using ConditionIR::Node;
+    Node node{Kind::Direction, 3.0, {}};
+    for (int level = 0; level < levels; ++level) {
+        std::vector<Node> children;
+        children.push_back(Node{Kind::CycleInstance, static_cast<double>(level), {}});
+        children.push_back(std::move(node));
+        node = Node{level % 2 ? Kind::Or : Kind::And, 0.0, std::move(children)};
+    }
+    Node root{Kind::Or, 0.0, {}};
+    root.children.push_back(std::move(node));
+    return root;
+}
@@ -0,0 +1,27 @@
+﻿#pragma once
+#include <memory>
+#include <random>
+#include <vector>
+#include "ConditionIR.h"
+#include "Settings.h"
+
+// Configurações usadas pelos testes de geração de condições e pelos arquivos em tests/golden.
+namespace Samples {
+    struct ConditionConfigs {
+        WeaponCategory sword;
+        WeaponCategory dualSword;
+        std::vector<FileSaveConfig> configs;  // Apontam para as categorias acima
+    };
+
+    // Uma mãe e duas filhas (direções e random) na instância 1 da espada, uma mãe na instância 2 da espada
+    // dupla e uma configuração sem posição na playlist, que não gera condição.
+    std::unique_ptr<ConditionConfigs> MakeConditionConfigs();
+
+    // Até 8 configurações com instância, ordem, categoria, mãe e direções sorteadas, sem garantia de coerência
+    // com o que a UI deixaria salvar. Apontam para `single` e `dual`.
+    std::vector<FileSaveConfig> MakeRandomConfigs(std::mt19937& random, const WeaponCategory& single,
+                                                  const WeaponCategory& dual);
+
+    // `levels` grupos AND/OR encaixados, cada um com uma folha, bem mais fundo do que a UI costuma gerar.
+    ConditionIR::Node MakeDeepTree(int levels);
+}
@@ -0,0 +1,47 @@
+﻿#include "TestFiles.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+namespace {
+    const std::filesystem::path kTestsDir = CYCLEMOVESETS_TESTS_DIR;
+
+    // Linha `index` (base 0) de `text`, para a mensagem de erro.
+    std::string_view Line(std::string_view text, std::size_t index) {
+        for (; index > 0; --index) {
+            const auto newline = text.find('\n');
+            if (newline == std::string_view::npos) return {};
+            text.remove_prefix(newline + 1);
+        }
+        return text.substr(0, text.find('\n'));
+    }
+}
+
+std::filesystem::path TestFiles::DataPath(std::string_view name) { return kTestsDir / "data" / name; }
+
+std::string TestFiles::Read(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+::testing::AssertionResult TestFiles::MatchesGolden(std::string_view name, std::string_view actual) {
+    const auto path = kTestsDir / "golden" / name;
+    if (std::getenv("CYCLEMOVESETS_UPDATE_GOLDENS")) {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(actual.data(), static_cast<std::streamsize>(actual.size()));
+        if (!file) return ::testing::AssertionFailure() << "não foi possível regravar " << path.string();
+        return ::testing::AssertionSuccess();
+    }
+
+    if (!std::filesystem::exists(path)) return ::testing::AssertionFailure() << path.string() << " não existe";
+    const auto expected = Read(path);
+    if (expected == actual) return ::testing::AssertionSuccess();
+
+    const auto mismatch = std::ranges::mismatch(expected, actual);
+    const auto offset = static_cast<std::size_t>(mismatch.in1 - expected.begin());
+    const auto line = static_cast<std::size_t>(std::count(expected.begin(), mismatch.in1, '\n'));
+    return ::testing::AssertionFailure() << name << " difere na linha " << line + 1 << " (byte " << offset
+                                         << ")\n  esperado: " << Line(expected, line)
+                                         << "\n  gerado:   " << Line(actual, line);
+}
@@ -0,0 +1,15 @@
+﻿#pragma once
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <gtest/gtest.h>
+
+// Arquivos de entrada (tests/data) e saídas esperadas (tests/golden) dos testes.
+namespace TestFiles {
+    std::filesystem::path DataPath(std::string_view name);
+    std::string Read(const std::filesystem::path& path);
+
+    // Compara `actual` byte a byte com tests/golden/<name>. Com a variável de ambiente
+    // CYCLEMOVESETS_UPDATE_GOLDENS definida, regrava o arquivo em vez de comparar; o diff vai para a revisão.
+    ::testing::AssertionResult MatchesGolden(std::string_view name, std::string_view actual);
+}